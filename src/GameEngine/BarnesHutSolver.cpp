@@ -0,0 +1,274 @@
+#include "BarnesHutSolver.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+namespace
+{
+	constexpr uint32_t MAX_DEPTH = 48;
+	constexpr uint32_t STACK_SIZE = MAX_DEPTH * 7 + 8;
+
+	double Milliseconds(std::chrono::high_resolution_clock::time_point const start)
+	{
+		return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+	}
+}
+
+BarnesHutSolver::BarnesHutSolver(double const openingAngle, uint32_t const leafSize) :
+	m_openingAngle(openingAngle),
+	m_leafSize(std::max(leafSize, 1u))
+{
+}
+
+void BarnesHutSolver::Accelerate(GravityBodies const& bodies)
+{
+	m_stats = {};
+
+	auto start = std::chrono::high_resolution_clock::now();
+	Build(bodies);
+	m_stats.buildTime = Milliseconds(start);
+	m_stats.nodes = m_nodes.size();
+
+	start = std::chrono::high_resolution_clock::now();
+
+	std::fill(bodies.ax, bodies.ax + bodies.count, 0.);
+	std::fill(bodies.ay, bodies.ay + bodies.count, 0.);
+	std::fill(bodies.az, bodies.az + bodies.count, 0.);
+
+	uint64_t interactions = 0;
+	for (uint32_t i : m_order)
+		Walk(bodies, i, interactions);
+
+	m_stats.interactions = interactions;
+	m_stats.forceTime = Milliseconds(start);
+}
+
+void BarnesHutSolver::Build(GravityBodies const& bodies)
+{
+	m_nodes.clear();
+	m_order.clear();
+
+	double lower[3] = {INFINITY, INFINITY, INFINITY};
+	double upper[3] = {-INFINITY, -INFINITY, -INFINITY};
+
+	// Massless bodies neither attract nor get attracted in the shader, so they stay out of the tree.
+	for (uint32_t i = 0; i < bodies.count; i++)
+	{
+		if (bodies.mass[i] == 0)
+			continue;
+
+		const double p[3] = {bodies.x[i], bodies.y[i], bodies.z[i]};
+		for (int k = 0; k < 3; k++)
+		{
+			lower[k] = std::min(lower[k], p[k]);
+			upper[k] = std::max(upper[k], p[k]);
+		}
+
+		m_order.push_back(i);
+	}
+
+	if (m_order.empty())
+		return;
+
+	m_scratch.resize(m_order.size());
+
+	Node root{};
+	double half = 0;
+	for (int k = 0; k < 3; k++)
+	{
+		root.center[k] = (lower[k] + upper[k]) * .5;
+		half = std::max(half, (upper[k] - lower[k]) * .5);
+	}
+	root.half = half * (1 + 1e-6) + 1e-12;
+	root.first = 0;
+	root.count = static_cast<uint32_t>(m_order.size());
+
+	m_nodes.reserve(m_order.size() * 2 / m_leafSize + 8);
+	m_nodes.push_back(root);
+
+	Subdivide(bodies, 0, 0);
+}
+
+void BarnesHutSolver::Subdivide(GravityBodies const& bodies, uint32_t const node, uint32_t const depth)
+{
+	const Node cell = m_nodes[node];
+
+	if (cell.count <= m_leafSize || depth >= MAX_DEPTH)
+	{
+		double mass = 0, x = 0, y = 0, z = 0, maxRadius = 0;
+		for (uint32_t k = cell.first; k < cell.first + cell.count; k++)
+		{
+			const uint32_t i = m_order[k];
+			const double m = bodies.mass[i];
+
+			x += bodies.x[i] * m;
+			y += bodies.y[i] * m;
+			z += bodies.z[i] * m;
+			mass += m;
+			maxRadius = std::max(maxRadius, static_cast<double>(bodies.radius[i]) * S_NORM_INV);
+		}
+
+		Node& leaf = m_nodes[node];
+		leaf.com[0] = x / mass;
+		leaf.com[1] = y / mass;
+		leaf.com[2] = z / mass;
+		leaf.mass = mass;
+		leaf.maxRadius = maxRadius;
+		leaf.children = 0;
+		return;
+	}
+
+	// Sort the bodies of this cell into its eight octants
+	auto octant = [&](uint32_t const i)
+	{
+		return (bodies.x[i] > cell.center[0] ? 1u : 0u) |
+			(bodies.y[i] > cell.center[1] ? 2u : 0u) |
+			(bodies.z[i] > cell.center[2] ? 4u : 0u);
+	};
+
+	uint32_t counts[8] = {};
+	for (uint32_t k = cell.first; k < cell.first + cell.count; k++)
+		counts[octant(m_order[k])]++;
+
+	uint32_t offsets[8] = {};
+	for (int o = 1; o < 8; o++)
+		offsets[o] = offsets[o - 1] + counts[o - 1];
+
+	uint32_t cursor[8];
+	std::copy(std::begin(offsets), std::end(offsets), std::begin(cursor));
+	for (uint32_t k = cell.first; k < cell.first + cell.count; k++)
+	{
+		const uint32_t i = m_order[k];
+		m_scratch[cell.first + cursor[octant(i)]++] = i;
+	}
+	std::copy(m_scratch.begin() + cell.first, m_scratch.begin() + cell.first + cell.count,
+	          m_order.begin() + cell.first);
+
+	const auto firstChild = static_cast<uint32_t>(m_nodes.size());
+	uint32_t children = 0;
+	const double half = cell.half * .5;
+
+	for (uint32_t o = 0; o < 8; o++)
+	{
+		if (counts[o] == 0)
+			continue;
+
+		Node child{};
+		child.center[0] = cell.center[0] + (o & 1u ? half : -half);
+		child.center[1] = cell.center[1] + (o & 2u ? half : -half);
+		child.center[2] = cell.center[2] + (o & 4u ? half : -half);
+		child.half = half;
+		child.first = cell.first + offsets[o];
+		child.count = counts[o];
+
+		m_nodes.push_back(child);
+		children++;
+	}
+
+	m_nodes[node].first = firstChild;
+	m_nodes[node].children = children;
+
+	double mass = 0, x = 0, y = 0, z = 0, maxRadius = 0;
+	for (uint32_t c = firstChild; c < firstChild + children; c++)
+	{
+		Subdivide(bodies, c, depth + 1);
+
+		const Node& child = m_nodes[c];
+		x += child.com[0] * child.mass;
+		y += child.com[1] * child.mass;
+		z += child.com[2] * child.mass;
+		mass += child.mass;
+		maxRadius = std::max(maxRadius, child.maxRadius);
+	}
+
+	Node& parent = m_nodes[node];
+	parent.com[0] = x / mass;
+	parent.com[1] = y / mass;
+	parent.com[2] = z / mass;
+	parent.mass = mass;
+	parent.maxRadius = maxRadius;
+}
+
+void BarnesHutSolver::Walk(GravityBodies const& bodies, uint32_t const i, uint64_t& interactions) const
+{
+	const double xi = bodies.x[i], yi = bodies.y[i], zi = bodies.z[i];
+	const double ri = static_cast<double>(bodies.radius[i]) * S_NORM_INV;
+	const double theta2 = m_openingAngle * m_openingAngle;
+
+	double ax = 0, ay = 0, az = 0;
+	bool collision = false;
+
+	uint32_t stack[STACK_SIZE];
+	uint32_t top = 0;
+	stack[top++] = 0;
+
+	while (top > 0)
+	{
+		const Node& node = m_nodes[stack[--top]];
+
+		if (node.children == 0)
+		{
+			for (uint32_t k = node.first; k < node.first + node.count; k++)
+			{
+				const uint32_t j = m_order[k];
+				if (j == i)
+					continue;
+
+				const double dx = bodies.x[j] - xi;
+				const double dy = bodies.y[j] - yi;
+				const double dz = bodies.z[j] - zi;
+				const double r2 = dx * dx + dy * dy + dz * dz;
+
+				const double reach = ri + static_cast<double>(bodies.radius[j]) * S_NORM_INV;
+				if (r2 <= reach * reach)
+					collision = true;
+
+				if (r2 > 0)
+				{
+					const double s = bodies.mass[j] / (r2 * sqrt(r2));
+					ax += dx * s;
+					ay += dy * s;
+					az += dz * s;
+				}
+			}
+
+			interactions += node.count;
+			continue;
+		}
+
+		const double dx = node.com[0] - xi;
+		const double dy = node.com[1] - yi;
+		const double dz = node.com[2] - zi;
+		const double d2 = dx * dx + dy * dy + dz * dz;
+
+		// Distance from the body to the cell box; a cell that may contain an overlapping body is never approximated.
+		const double bx = std::max(std::abs(xi - node.center[0]) - node.half, 0.);
+		const double by = std::max(std::abs(yi - node.center[1]) - node.half, 0.);
+		const double bz = std::max(std::abs(zi - node.center[2]) - node.half, 0.);
+		const double reach = ri + node.maxRadius;
+		const bool overlaps = bx * bx + by * by + bz * bz <= reach * reach;
+
+		const double width = node.half * 2;
+		if (!overlaps && width * width < theta2 * d2)
+		{
+			const double s = node.mass / (d2 * sqrt(d2));
+			ax += dx * s;
+			ay += dy * s;
+			az += dz * s;
+
+			interactions++;
+			continue;
+		}
+
+		for (uint32_t c = node.first; c < node.first + node.children; c++)
+			stack[top++] = c;
+	}
+
+	bodies.ax[i] = ax * G_SCREEN;
+	bodies.ay[i] = ay * G_SCREEN;
+	bodies.az[i] = az * G_SCREEN;
+
+	if (collision)
+		bodies.collision[i] = 1;
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include "GravitySolver.h"
+
+#include <vector>
+
+// Barnes-Hut tree code: the bodies are sorted into an octree every pass and distant cells are replaced by their centre
+// of mass when (cell width / distance) < opening angle. An opening angle of zero opens every cell, which reduces the
+// solver to the exact pairwise sum of ComputeGravityShader. Cells that could hold a body overlapping the current one
+// are always opened, so the collision flags are exact regardless of the opening angle.
+class BarnesHutSolver final : public GravitySolver
+{
+public:
+	explicit BarnesHutSolver(double openingAngle = .5, uint32_t leafSize = 8);
+
+	void Accelerate(GravityBodies const& bodies) override;
+	[[nodiscard]] const char* Name() const override { return "Barnes-Hut"; }
+
+	void SetOpeningAngle(double const openingAngle) { m_openingAngle = openingAngle; }
+	[[nodiscard]] double GetOpeningAngle() const { return m_openingAngle; }
+
+private:
+	struct Node
+	{
+		double center[3]; // geometric centre of the cell
+		double half; // half width of the cell
+		double com[3]; // centre of mass
+		double mass;
+		double maxRadius; // largest body radius inside the cell, screen units
+		uint32_t first; // index of the first child node, or of the first body in m_order for leaves
+		uint32_t count; // number of bodies inside the cell
+		uint32_t children; // number of (non-empty) child nodes, zero for leaves
+	};
+
+	void Build(GravityBodies const& bodies);
+	void Subdivide(GravityBodies const& bodies, uint32_t node, uint32_t depth);
+	void Walk(GravityBodies const& bodies, uint32_t i, uint64_t& interactions) const;
+
+	double m_openingAngle;
+	uint32_t m_leafSize;
+
+	std::vector<Node> m_nodes;
+	std::vector<uint32_t> m_order;
+	std::vector<uint32_t> m_scratch;
+};
@@ -0,0 +1,37 @@
+#include "BodyHandles.h"
+
+BodyHandles::BodyHandles() :
+	m_handles(1, 0),
+	m_positions(1, NONE)
+{
+}
+
+uint32_t BodyHandles::Create()
+{
+	if (!m_free.empty())
+	{
+		const uint32_t handle = m_free.back();
+		m_free.pop_back();
+
+		m_handles[handle & SLOT_INDEX_MASK] = handle;
+		return handle;
+	}
+
+	const auto slot = static_cast<uint32_t>(m_handles.size());
+	m_handles.push_back(slot);
+	m_positions.push_back(NONE);
+	return slot;
+}
+
+void BodyHandles::Release(uint32_t const handle)
+{
+	if (!Valid(handle))
+		return;
+
+	const uint32_t slot = handle & SLOT_INDEX_MASK;
+	const uint32_t generation = (handle >> SLOT_INDEX_BITS) + 1;
+
+	m_handles[slot] = 0;
+	m_positions[slot] = NONE;
+	m_free.push_back(generation << SLOT_INDEX_BITS | slot);
+}
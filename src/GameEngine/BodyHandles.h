@@ -0,0 +1,45 @@
+#pragma once
+
+#include "SlotMap.h"
+
+#include <cstdint>
+#include <vector>
+
+// Issues body ids as generational handles and maps them to positions in the dense body array. A handle is a slot
+// index in the low SLOT_INDEX_BITS bits and the slot's generation above them, the key layout of SlotMap. Releasing a
+// body bumps its slot's generation before the slot is reused, so handles kept elsewhere (the cursor, the selected
+// body, per-body data) stop resolving instead of finding another body; the generation wraps after 256 reuses of a
+// slot. Slot zero is never issued, id 0 stays "no body".
+//
+// Not synchronised: handles are created, released and placed by the thread that owns g_planets, between the passes
+// that look them up.
+class BodyHandles
+{
+public:
+	static constexpr uint32_t NONE = ~0u;
+
+	BodyHandles();
+
+	[[nodiscard]] uint32_t Create();
+	void Release(uint32_t handle);
+
+	[[nodiscard]] bool Valid(uint32_t const handle) const
+	{
+		const uint32_t slot = handle & SLOT_INDEX_MASK;
+		return handle != 0 && slot < m_handles.size() && m_handles[slot] == handle;
+	}
+
+	// Records where the body of handle sits in the dense array.
+	void Place(uint32_t const handle, uint32_t const position) { m_positions[handle & SLOT_INDEX_MASK] = position; }
+
+	// Position of the body of handle in the dense array, NONE if the handle is stale.
+	[[nodiscard]] uint32_t Position(uint32_t const handle) const
+	{
+		return Valid(handle) ? m_positions[handle & SLOT_INDEX_MASK] : NONE;
+	}
+
+private:
+	std::vector<uint32_t> m_handles; // live handle of every slot, 0 while it is free
+	std::vector<uint32_t> m_positions;
+	std::vector<uint32_t> m_free; // handles to issue next, their slots' generations already bumped
+};
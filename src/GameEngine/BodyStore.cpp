@@ -0,0 +1,73 @@
+#include "BodyStore.h"
+
+void BodyStore::Resize(size_t const count)
+{
+	for (auto* values : {&x, &y, &z, &vx, &vy, &vz, &mass, &radius})
+		values->resize(count);
+	for (auto* values : {&ax, &ay, &az})
+		values->resize(count);
+	collision.resize(count);
+}
+
+GravityBodies BodyStore::Gravity()
+{
+	GravityBodies bodies{};
+	bodies.count = Size();
+	bodies.x = x.data();
+	bodies.y = y.data();
+	bodies.z = z.data();
+	bodies.mass = mass.data();
+	bodies.radius = radius.data();
+	bodies.vx = vx.data();
+	bodies.vy = vy.data();
+	bodies.vz = vz.data();
+	bodies.collision = collision.data();
+	bodies.ax = ax.data();
+	bodies.ay = ay.data();
+	bodies.az = az.data();
+	return bodies;
+}
+
+void BodyStore::Drift(double const deltaTime)
+{
+	const auto dt = static_cast<float>(deltaTime);
+	const size_t count = Size();
+
+	for (size_t i = 0; i < count; i++)
+	{
+		if (mass[i] == 0)
+			continue;
+
+		x[i] += vx[i] * dt;
+		y[i] += vy[i] * dt;
+		z[i] += vz[i] * dt;
+	}
+}
+
+void BodyStore::Erase(std::vector<uint8_t> const& erase)
+{
+	const size_t count = Size();
+
+	size_t kept = 0;
+	for (size_t i = 0; i < count; i++)
+	{
+		if (erase[i])
+			continue;
+
+		if (kept != i)
+		{
+			x[kept] = x[i];
+			y[kept] = y[i];
+			z[kept] = z[i];
+			vx[kept] = vx[i];
+			vy[kept] = vy[i];
+			vz[kept] = vz[i];
+			mass[kept] = mass[i];
+			radius[kept] = radius[i];
+			collision[kept] = collision[i];
+		}
+		kept++;
+	}
+
+	Resize(kept);
+}
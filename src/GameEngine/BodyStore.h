@@ -0,0 +1,33 @@
+#pragma once
+
+#include "GravitySolver.h"
+#include "Simd.h"
+
+#include <vector>
+
+// Kinematic state of the simulated bodies as one cache line aligned array per field, so the physics passes only
+// stream the fields they use. Everything else about a body (material, temperature, counters) stays in Planet, which
+// doubles as the GPU instance layout; the store is loaded from and written back to it around the physics passes.
+// Positions and velocities are in screen units, mass in kg and radius in metres, as in Planet.
+struct BodyStore
+{
+	AlignedVector<float> x, y, z;
+	AlignedVector<float> vx, vy, vz;
+	AlignedVector<float> mass, radius;
+	AlignedVector<uint32_t> collision;
+
+	// Scratch for the gravity solvers.
+	AlignedVector<double> ax, ay, az;
+
+	[[nodiscard]] size_t Size() const { return x.size(); }
+	void Resize(size_t count);
+
+	// View handed to a GravitySolver, valid until the next Resize.
+	[[nodiscard]] GravityBodies Gravity();
+
+	// position += velocity * deltaTime for every body with mass, what ComputePositionShader does per instance.
+	void Drift(double deltaTime);
+
+	// Removes the bodies whose flag is set, keeping the order of the others.
+	void Erase(std::vector<uint8_t> const& erase);
+};
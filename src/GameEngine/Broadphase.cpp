@@ -0,0 +1,200 @@
+#include "Broadphase.h"
+
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+namespace
+{
+	// Bodies up to this radius quantile fit the finest grid level.
+	constexpr double FINE_QUANTILE = .99;
+	constexpr size_t BODIES_PER_TASK = 256;
+
+	struct Search
+	{
+		std::vector<CollisionPair> pairs;
+		uint64_t candidates = 0;
+	};
+
+	Search Join(Search a, Search const& b)
+	{
+		a.pairs.insert(a.pairs.end(), b.pairs.begin(), b.pairs.end());
+		a.candidates += b.candidates;
+		return a;
+	}
+
+	void Test(double const x, double const y, double const z, double const r, uint32_t const i, double const ox,
+	          double const oy, double const oz, double const orad, uint32_t const j, Search& search)
+	{
+		const double dx = ox - x, dy = oy - y, dz = oz - z;
+		const double reach = r + orad;
+
+		search.candidates++;
+		if (dx * dx + dy * dy + dz * dz <= reach * reach)
+			search.pairs.push_back({std::min(i, j), std::max(i, j)});
+	}
+}
+
+void Broadphase::Grid::Build(GravityBodies const& bodies, std::vector<uint32_t> const& members, double const cellWidth)
+{
+	const size_t count = members.size();
+
+	width = cellWidth;
+
+	uint64_t buckets = 1;
+	while (buckets < 2 * count)
+		buckets <<= 1;
+	mask = buckets - 1;
+
+	std::vector<int32_t> cells(count * 3);
+	std::vector<uint64_t> keys(count);
+	parallel_for(0, count, BODIES_PER_TASK, [&](size_t const k)
+	{
+		const uint32_t i = members[k];
+		cells[k * 3 + 0] = Coordinate(bodies.x[i]);
+		cells[k * 3 + 1] = Coordinate(bodies.y[i]);
+		cells[k * 3 + 2] = Coordinate(bodies.z[i]);
+		keys[k] = Bucket(cells[k * 3 + 0], cells[k * 3 + 1], cells[k * 3 + 2]);
+	});
+
+	// Counting sort by bucket, stable so the order within a bucket follows the body index.
+	start.assign(buckets + 1, 0);
+	for (uint64_t const key : keys)
+		start[key + 1]++;
+	for (uint64_t b = 0; b < buckets; b++)
+		start[b + 1] += start[b];
+
+	cell.resize(count * 3);
+	x.resize(count);
+	y.resize(count);
+	z.resize(count);
+	r.resize(count);
+	index.resize(count);
+
+	std::vector<uint32_t> cursor(start.begin(), start.end() - 1);
+	for (size_t k = 0; k < count; k++)
+	{
+		const uint32_t i = members[k];
+		const uint32_t p = cursor[keys[k]]++;
+
+		std::copy(&cells[k * 3], &cells[k * 3] + 3, &cell[p * 3]);
+		x[p] = bodies.x[i];
+		y[p] = bodies.y[i];
+		z[p] = bodies.z[i];
+		r[p] = bodies.radius[i] * S_NORM_INV;
+		index[p] = i;
+	}
+}
+
+int32_t Broadphase::Grid::Coordinate(double const value) const
+{
+	const double cellIndex = std::floor(value / width);
+	return static_cast<int32_t>(std::max(std::min(cellIndex, 2147483647.), -2147483648.));
+}
+
+uint64_t Broadphase::Grid::Bucket(int32_t const cx, int32_t const cy, int32_t const cz) const
+{
+	const uint64_t hash = static_cast<uint64_t>(static_cast<uint32_t>(cx)) * 0x9E3779B97F4A7C15 ^
+		static_cast<uint64_t>(static_cast<uint32_t>(cy)) * 0xC2B2AE3D27D4EB4F ^
+		static_cast<uint64_t>(static_cast<uint32_t>(cz)) * 0x165667B19E3779F9;
+
+	return (hash ^ hash >> 29) & mask;
+}
+
+void Broadphase::Execute(GravityBodies const& bodies)
+{
+	const auto start = std::chrono::high_resolution_clock::now();
+
+	m_pairs.clear();
+	m_stats = {};
+
+	std::vector<uint32_t> live;
+	for (uint32_t i = 0; i < bodies.count; i++)
+		if (bodies.mass[i] != 0)
+			live.push_back(i);
+
+	if (live.size() > 1)
+	{
+		std::vector<double> radii(live.size());
+		for (size_t k = 0; k < live.size(); k++)
+			radii[k] = bodies.radius[live[k]] * S_NORM_INV;
+
+		const double maxRadius = *std::max_element(radii.begin(), radii.end());
+		const auto quantile = radii.begin() + static_cast<ptrdiff_t>(FINE_QUANTILE * (radii.size() - 1));
+		std::nth_element(radii.begin(), quantile, radii.end());
+
+		double fineWidth = 2 * *quantile;
+		if (fineWidth <= 0)
+			fineWidth = maxRadius > 0 ? 2 * maxRadius : 1;
+
+		size_t levelCount = 1;
+		while (fineWidth * static_cast<double>(1ull << (levelCount - 1)) < 2 * maxRadius)
+			levelCount++;
+
+		std::vector<std::vector<uint32_t>> members(levelCount);
+		for (uint32_t const i : live)
+		{
+			const double diameter = bodies.radius[i] * S_NORM_INV * 2;
+			size_t level = 0;
+			while (fineWidth * static_cast<double>(1ull << level) < diameter)
+				level++;
+			members[level].push_back(i);
+		}
+
+		m_levels.resize(levelCount);
+		for (size_t level = 0; level < levelCount; level++)
+			m_levels[level].Build(bodies, members[level], fineWidth * static_cast<double>(1ull << level));
+
+		Search found;
+		for (size_t level = 0; level < levelCount; level++)
+		{
+			Grid const& grid = m_levels[level];
+
+			found = Join(std::move(found), parallel_reduce(0, grid.index.size(), BODIES_PER_TASK, Search{},
+				[&](Search search, size_t const k)
+				{
+					const double x = grid.x[k], y = grid.y[k], z = grid.z[k], r = grid.r[k];
+					const uint32_t i = grid.index[k];
+
+					// Within its own cell a body only looks at the ones stored after it, so each pair is tested once.
+					grid.Visit(x, y, z, true, [&](uint32_t const p, bool const same)
+					{
+						if (!same || p > k)
+							Test(x, y, z, r, i, grid.x[p], grid.y[p], grid.z[p], grid.r[p], grid.index[p], search);
+					});
+
+					for (size_t coarser = level + 1; coarser < levelCount; coarser++)
+					{
+						Grid const& other = m_levels[coarser];
+						if (other.index.empty())
+							continue;
+
+						other.Visit(x, y, z, false, [&](uint32_t const p, bool)
+						{
+							Test(x, y, z, r, i, other.x[p], other.y[p], other.z[p], other.r[p], other.index[p], search);
+						});
+					}
+
+					return search;
+				}, Join));
+		}
+
+		std::sort(found.pairs.begin(), found.pairs.end(), [](CollisionPair const& a, CollisionPair const& b)
+		{
+			return a.a != b.a ? a.a < b.a : a.b < b.b;
+		});
+
+		m_pairs = std::move(found.pairs);
+		m_stats.candidates = found.candidates;
+		m_stats.levels = levelCount;
+		m_stats.oversized = live.size() - members[0].size();
+	}
+
+	for (CollisionPair const& pair : m_pairs)
+		bodies.collision[pair.a] = bodies.collision[pair.b] = 1;
+
+	m_stats.pairs = m_pairs.size();
+	m_stats.time = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
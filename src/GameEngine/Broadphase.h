@@ -0,0 +1,88 @@
+#pragma once
+
+#include "GravitySolver.h"
+
+#include <cstdint>
+#include <vector>
+
+// Two bodies whose spheres touch, a < b.
+struct CollisionPair
+{
+	uint32_t a;
+	uint32_t b;
+};
+
+struct BroadphaseStats
+{
+	double time = 0; // ms
+	uint64_t candidates = 0; // sphere tests performed
+	size_t pairs = 0;
+	size_t levels = 0;
+	size_t oversized = 0; // bodies above the finest level
+};
+
+// Collision detection independent of the gravity solver: every pass lists the overlapping pairs of bodies with mass,
+// using the same test as the gravity kernels, distance <= (Ri + Rj) / S_NORM. Bodies are hashed into a hierarchy of
+// uniform grids: the finest level's cells are as wide as the diameter of all but the largest one percent of bodies and
+// every further level doubles the width, each body going into the first level its diameter fits. Touching bodies then
+// always lie in neighbouring cells of the coarser one's level, so a body searches the 27 cells around it in its own
+// level and all coarser ones. The search runs in parallel and is linear in the number of bodies for any realistic
+// radius distribution; the few large bodies (stars, giants) only cost a handful of extra levels.
+class Broadphase
+{
+public:
+	// Lists the overlapping pairs and raises bodies.collision for every body in one.
+	void Execute(GravityBodies const& bodies);
+
+	// Pairs of the last pass, sorted, as indices into the bodies passed to Execute.
+	[[nodiscard]] std::vector<CollisionPair> const& Pairs() const { return m_pairs; }
+	[[nodiscard]] BroadphaseStats const& Stats() const { return m_stats; }
+
+private:
+	// Spatial hash over a subset of the bodies, stored in bucket order.
+	struct Grid
+	{
+		double width = 1;
+		uint64_t mask = 0;
+		std::vector<uint32_t> start; // bodies of bucket b are [start[b], start[b + 1])
+		std::vector<int32_t> cell; // three coordinates per body
+		std::vector<double> x, y, z, r;
+		std::vector<uint32_t> index; // body index in GravityBodies
+
+		void Build(GravityBodies const& bodies, std::vector<uint32_t> const& members, double width);
+		[[nodiscard]] int32_t Coordinate(double value) const;
+		[[nodiscard]] uint64_t Bucket(int32_t x, int32_t y, int32_t z) const;
+
+		// Calls f(p, same cell) with the position of every body in the 27 cells around the point, or with forward only
+		// in the point's cell and the 13 neighbours after it, which covers every neighbouring pair of cells once.
+		template <typename F>
+		void Visit(double px, double py, double pz, bool forward, F const& f) const;
+	};
+
+	std::vector<Grid> m_levels;
+	std::vector<CollisionPair> m_pairs;
+	BroadphaseStats m_stats;
+};
+
+template <typename F>
+void Broadphase::Grid::Visit(double const px, double const py, double const pz, bool const forward, F const& f) const
+{
+	const int32_t cx = Coordinate(px), cy = Coordinate(py), cz = Coordinate(pz);
+
+	for (int32_t dz = -1; dz <= 1; dz++)
+		for (int32_t dy = -1; dy <= 1; dy++)
+			for (int32_t dx = -1; dx <= 1; dx++)
+			{
+				if (forward && (dz < 0 || (dz == 0 && (dy < 0 || (dy == 0 && dx < 0)))))
+					continue;
+
+				const bool same = dx == 0 && dy == 0 && dz == 0;
+				const uint64_t bucket = Bucket(cx + dx, cy + dy, cz + dz);
+				for (uint32_t p = start[bucket]; p < start[bucket + 1]; p++)
+				{
+					// Other cells hash into the same bucket.
+					if (cell[p * 3] == cx + dx && cell[p * 3 + 1] == cy + dy && cell[p * 3 + 2] == cz + dz)
+						f(p, same);
+				}
+			}
+}
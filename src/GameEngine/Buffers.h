@@ -52,6 +52,71 @@ namespace Buffers
 		}
 	};
 
+	// Values in an upload buffer, read by compute shaders as a StructuredBuffer bound to a root shader resource view at
+	// Location. The buffer grows on demand, which moves Location.
+	template <typename T>
+	class StructuredBuffer
+	{
+	public:
+		explicit StructuredBuffer(size_t const capacity)
+		{
+			Create(capacity);
+		}
+
+		ComPtr<ID3D12Resource> Buffer;
+		size_t Capacity = 0;
+		UINT BufferSize = 0;
+
+		D3D12_GPU_VIRTUAL_ADDRESS Location = 0;
+
+		// Makes room for count values, at least doubling the capacity when it falls short. Returns whether the buffer
+		// was recreated, its new Location must then be bound in place of the old.
+		bool Reserve(size_t const count)
+		{
+			if (count <= Capacity)
+				return false;
+
+			Create(std::max(count, Capacity * 2));
+			return true;
+		}
+
+		// Writes the first count values, at most Capacity; the shader is told how many are valid.
+		void Write(T const* data, size_t const count)
+		{
+			CD3DX12_RANGE readRange(0, 0);
+			void* map = nullptr;
+			DX::ThrowIfFailed(Buffer->Map(0, &readRange, &map));
+
+			memcpy(map, data, sizeof(T) * std::min(count, Capacity));
+
+			Buffer->Unmap(0, nullptr);
+		}
+
+	private:
+		void Create(size_t const capacity)
+		{
+			ID3D12Device* device = g_device_resources->GetD3DDevice();
+
+			auto rd = CD3DX12_RESOURCE_DESC::Buffer(static_cast<UINT64>(sizeof(T) * capacity));
+			auto hp = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
+
+			ComPtr<ID3D12Resource> buffer;
+			DX::ThrowIfFailed(device->CreateCommittedResource(
+				&hp,
+				D3D12_HEAP_FLAG_NONE,
+				&rd,
+				D3D12_RESOURCE_STATE_GENERIC_READ,
+				nullptr,
+				IID_PPV_ARGS(buffer.GetAddressOf())
+			));
+
+			Buffer = buffer;
+			Capacity = capacity;
+			BufferSize = static_cast<UINT>(sizeof(T) * capacity);
+			Location = Buffer->GetGPUVirtualAddress();
+		}
+	};
+
 	struct XMDOUBLE3
 	{
 		double x;
@@ -139,6 +204,19 @@ namespace Buffers
 	{
 		float systemMass;
 		DirectX::XMFLOAT3 centerOfMass;
+		float quadrantSize; // screen units
+		uint32_t quadrantCount; // valid values in the Quadrant buffer of ComputePositionShader
+	};
+
+	// Far field of one occupied quadrant, from QuadrantMoments, with G_SCREEN folded into the mass and quadrupole so the
+	// shader works in float without overflow.
+	struct Quadrant
+	{
+		DirectX::XMINT3 cell;
+		float mass;
+		DirectX::XMFLOAT3 center; // screen units
+		DirectX::XMFLOAT3 diagonal; // quadrupole xx, yy, zz
+		DirectX::XMFLOAT3 offDiagonal; // quadrupole xy, xz, yz
 	};
 
 	struct Material
@@ -0,0 +1,143 @@
+#include "CollisionResolver.h"
+
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+namespace
+{
+	constexpr size_t CLUSTERS_PER_TASK = 16;
+}
+
+uint32_t CollisionResolver::Find(uint32_t body)
+{
+	while (m_parent[body] != body)
+	{
+		m_parent[body] = m_parent[m_parent[body]];
+		body = m_parent[body];
+	}
+
+	return body;
+}
+
+void CollisionResolver::Union(uint32_t const a, uint32_t const b)
+{
+	const uint32_t rootA = Find(a), rootB = Find(b);
+
+	// The lower index becomes the root, so the roots do not depend on the order of the pairs.
+	if (rootA < rootB)
+		m_parent[rootB] = rootA;
+	else if (rootB < rootA)
+		m_parent[rootA] = rootB;
+}
+
+void CollisionResolver::Execute(BodyStore& bodies, std::vector<CollisionPair> const& pairs)
+{
+	const auto start = std::chrono::high_resolution_clock::now();
+
+	m_clusters.clear();
+	m_members.clear();
+	m_stats = {};
+
+	for (CollisionPair const& pair : pairs)
+	{
+		m_members.push_back(pair.a);
+		m_members.push_back(pair.b);
+	}
+
+	std::sort(m_members.begin(), m_members.end());
+	m_members.erase(std::unique(m_members.begin(), m_members.end()), m_members.end());
+
+	m_parent.resize(bodies.Size());
+	for (uint32_t const body : m_members)
+		m_parent[body] = body;
+
+	for (CollisionPair const& pair : pairs)
+		Union(pair.a, pair.b);
+
+	// Group the members by root, keeping body order within each group.
+	std::vector<uint32_t> roots(m_members.size());
+	for (size_t k = 0; k < m_members.size(); k++)
+		roots[k] = Find(m_members[k]);
+
+	std::vector<uint32_t> order(m_members.size());
+	for (uint32_t k = 0; k < order.size(); k++)
+		order[k] = k;
+	std::stable_sort(order.begin(), order.end(), [&](uint32_t const a, uint32_t const b) { return roots[a] < roots[b]; });
+
+	std::vector<uint32_t> grouped(m_members.size());
+	for (size_t k = 0; k < order.size(); k++)
+	{
+		grouped[k] = m_members[order[k]];
+
+		if (k == 0 || roots[order[k]] != roots[order[k - 1]])
+			m_clusters.push_back({0, static_cast<uint32_t>(k), 0});
+		m_clusters.back().count++;
+	}
+	m_members = std::move(grouped);
+
+	parallel_for(0, m_clusters.size(), CLUSTERS_PER_TASK, [&](size_t const c)
+	{
+		Merge(bodies, m_clusters[c], &m_members[m_clusters[c].first]);
+	});
+
+	m_stats.clusters = m_clusters.size();
+	for (MergeCluster const& cluster : m_clusters)
+	{
+		m_stats.absorbed += cluster.count - 1;
+		m_stats.largest = std::max<size_t>(m_stats.largest, cluster.count);
+	}
+	m_stats.time = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+void CollisionResolver::Merge(BodyStore& bodies, MergeCluster& cluster, uint32_t const* members)
+{
+	uint32_t survivor = members[0];
+	double mass = 0, x = 0, y = 0, z = 0, vx = 0, vy = 0, vz = 0;
+
+	for (uint32_t k = 0; k < cluster.count; k++)
+	{
+		const uint32_t i = members[k];
+		const double m = bodies.mass[i];
+
+		if (m > bodies.mass[survivor])
+			survivor = i;
+
+		mass += m;
+		x += bodies.x[i] * m;
+		y += bodies.y[i] * m;
+		z += bodies.z[i] * m;
+		vx += bodies.vx[i] * m;
+		vy += bodies.vy[i] * m;
+		vz += bodies.vz[i] * m;
+	}
+
+	cluster.survivor = survivor;
+
+	// The survivor keeps its mean density, radius ~ cbrt(mass).
+	const double radius = bodies.radius[survivor] * std::cbrt(mass / bodies.mass[survivor]);
+
+	for (uint32_t k = 0; k < cluster.count; k++)
+	{
+		const uint32_t i = members[k];
+
+		bodies.collision[i] = 0;
+		if (i == survivor)
+			continue;
+
+		bodies.mass[i] = 0;
+		bodies.x[i] = bodies.y[i] = bodies.z[i] = 0;
+		bodies.vx[i] = bodies.vy[i] = bodies.vz[i] = 0;
+	}
+
+	bodies.x[survivor] = static_cast<float>(x / mass);
+	bodies.y[survivor] = static_cast<float>(y / mass);
+	bodies.z[survivor] = static_cast<float>(z / mass);
+	bodies.vx[survivor] = static_cast<float>(vx / mass);
+	bodies.vy[survivor] = static_cast<float>(vy / mass);
+	bodies.vz[survivor] = static_cast<float>(vz / mass);
+	bodies.mass[survivor] = static_cast<float>(mass);
+	bodies.radius[survivor] = static_cast<float>(radius);
+}
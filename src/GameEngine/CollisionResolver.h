@@ -0,0 +1,54 @@
+#pragma once
+
+#include "BodyStore.h"
+#include "Broadphase.h"
+
+#include <cstdint>
+#include <vector>
+
+// Bodies connected through overlapping pairs, merged into their heaviest member.
+struct MergeCluster
+{
+	uint32_t survivor; // body index
+	uint32_t first; // members are CollisionResolver::Members()[first, first + count), in ascending body order
+	uint32_t count;
+};
+
+struct CollisionStats
+{
+	double time = 0; // ms
+	size_t clusters = 0;
+	size_t absorbed = 0; // bodies that lost their mass to a survivor
+	size_t largest = 0; // members of the largest cluster
+};
+
+// Resolves the pairs of a Broadphase pass on the CPU, replacing the collision shader whose threads wrote both bodies of
+// a pair and raced on pileups. Pairs are joined into clusters with union-find, so a chain of touching bodies merges in
+// one step no matter how many pairs it took. Each cluster keeps its heaviest member (the lowest index on ties), which
+// takes the total mass, the momentum conserving velocity, the centre of mass and the radius its density gives for the
+// new mass, as the shader did. The others are left massless for the clean pass.
+//
+// Clusters are resolved in parallel and every sum runs over the members in body order, so the result is bit-identical
+// for any thread count. Properties outside the BodyStore (compositions, profiles, counters) are merged by the caller
+// from Clusters() and Members() the same way.
+class CollisionResolver
+{
+public:
+	void Execute(BodyStore& bodies, std::vector<CollisionPair> const& pairs);
+
+	// Clusters of the last pass, ordered by their lowest member.
+	[[nodiscard]] std::vector<MergeCluster> const& Clusters() const { return m_clusters; }
+	[[nodiscard]] std::vector<uint32_t> const& Members() const { return m_members; }
+	[[nodiscard]] CollisionStats const& Stats() const { return m_stats; }
+
+private:
+	uint32_t Find(uint32_t body);
+	void Union(uint32_t a, uint32_t b);
+
+	static void Merge(BodyStore& bodies, MergeCluster& cluster, uint32_t const* members);
+
+	std::vector<uint32_t> m_parent;
+	std::vector<MergeCluster> m_clusters;
+	std::vector<uint32_t> m_members;
+	CollisionStats m_stats;
+};
@@ -0,0 +1,256 @@
+#pragma once
+
+#include "Lanes.h"
+
+#include <array>
+#include <cstddef>
+#include <type_traits>
+
+struct Planet;
+
+namespace DirectX
+{
+	namespace SimpleMath
+	{
+		struct Vector4;
+	}
+}
+
+// Mass of every element in a body or layer, in kg, one field per element by atomic number. The fields are padded to
+// a whole number of AVX registers (112 lanes) and aligned to one, so the arithmetic runs on whole registers; the
+// padding is kept zero. Mixed precision operands are converted, never reinterpreted, and nothing is heap allocated.
+// Composition<float> is also the GPU layout of Composition in Models.hlsli.
+template <typename T>
+struct alignas(32) Composition
+{
+	static constexpr size_t ELEMENTS = 109;
+	static constexpr size_t LANES = 112;
+
+	T Hydrogen;
+	T Helium;
+	T Lithium;
+	T Beryllium;
+	T Boron;
+	T Carbon;
+	T Nitrogen;
+	T Oxygen;
+	T Fluorine;
+	T Neon;
+	T Sodium;
+	T Magnesium;
+	T Aluminum;
+	T Silicon;
+	T Phosphorus;
+	T Sulfur;
+	T Chlorine;
+	T Argon;
+	T Potassium;
+	T Calcium;
+	T Scandium;
+	T Titanium;
+	T Vanadium;
+	T Chromium;
+	T Manganese;
+	T Iron;
+	T Cobalt;
+	T Nickel;
+	T Copper;
+	T Zinc;
+	T Gallium;
+	T Germanium;
+	T Arsenic;
+	T Selenium;
+	T Bromine;
+	T Krypton;
+	T Rubidium;
+	T Strontium;
+	T Yttrium;
+	T Zirconium;
+	T Niobium;
+	T Molybdenum;
+	T Technetium;
+	T Ruthenium;
+	T Rhodium;
+	T Palladium;
+	T Silver;
+	T Cadmium;
+	T Indium;
+	T Tin;
+	T Antimony;
+	T Tellurium;
+	T Iodine;
+	T Xenon;
+	T Cesium;
+	T Barium;
+	T Lanthanum;
+	T Cerium;
+	T Praseodymium;
+	T Neodymium;
+	T Promethium;
+	T Samarium;
+	T Europium;
+	T Gadolinium;
+	T Terbium;
+	T Dysprosium;
+	T Holmium;
+	T Erbium;
+	T Thulium;
+	T Ytterbium;
+	T Lutetium;
+	T Hafnium;
+	T Tantalum;
+	T Tungsten;
+	T Rhenium;
+	T Osmium;
+	T Iridium;
+	T Platinum;
+	T Gold;
+	T Mercury;
+	T Thallium;
+	T Lead;
+	T Bismuth;
+	T Polonium;
+	T Astatine;
+	T Radon;
+	T Francium;
+	T Radium;
+	T Actinium;
+	T Thorium;
+	T Protactinium;
+	T Uranium;
+	T Neptunium;
+	T Plutonium;
+	T Americium;
+	T Curium;
+	T Berkelium;
+	T Californium;
+	T Einsteinium;
+	T Fermium;
+	T Mendelevium;
+	T Nobelium;
+	T Lawrencium;
+	T Rutherfordium;
+	T Dubnium;
+	T Seaborgium;
+	T Bohrium;
+	T Hassium;
+	T Meitnerium;
+
+	T padding[LANES - ELEMENTS]{};
+
+	void Randomize(const Planet& planet);
+	[[nodiscard]] DirectX::SimpleMath::Vector4 GetColor() const;
+
+	T* data() const { return (T*)this; }
+	static constexpr size_t size() { return ELEMENTS; }
+
+	T sum() const { return Lanes::Sum(data(), LANES); }
+
+	template <typename A>
+	[[nodiscard]] Composition<A> As() const
+	{
+		Composition<A> a;
+		Lanes::Convert(a.data(), data(), LANES);
+		return a;
+	}
+
+	template <typename A>
+	Composition<T>& operator=(const Composition<A>& value)
+	{
+		Lanes::Convert(data(), value.data(), LANES);
+		return *this;
+	}
+
+	template <typename A, size_t S>
+	Composition<T>& operator=(const std::array<A, S>& value)
+	{
+		static_assert(S <= ELEMENTS, "More values than elements");
+		for (size_t i = 0; i < S; i++)
+			data()[i] = static_cast<T>(value[i]);
+
+		return *this;
+	}
+
+	Composition<T>& operator=(const T& value)
+	{
+		Lanes::Fill(data(), value, ELEMENTS);
+		return *this;
+	}
+
+	template <typename A>
+	Composition<T>& operator+=(const Composition<A>& value)
+	{
+		if constexpr (std::is_same_v<A, T>)
+			Lanes::Add(data(), value.data(), LANES);
+		else
+			Lanes::Add(data(), value.template As<T>().data(), LANES);
+
+		return *this;
+	}
+
+	template <typename A>
+	friend Composition<T> operator+(Composition<T> lhs, const Composition<A>& rhs)
+	{
+		lhs += rhs;
+		return lhs;
+	}
+
+	template <typename A>
+	Composition<T>& operator-=(const Composition<A>& value)
+	{
+		if constexpr (std::is_same_v<A, T>)
+			Lanes::Subtract(data(), value.data(), LANES);
+		else
+			Lanes::Subtract(data(), value.template As<T>().data(), LANES);
+
+		return *this;
+	}
+
+	template <typename A>
+	friend Composition<T> operator-(Composition<T> lhs, const Composition<A>& rhs)
+	{
+		lhs -= rhs;
+		return lhs;
+	}
+
+	template <typename A>
+	Composition<T>& operator*=(const A& value)
+	{
+		Lanes::Multiply(data(), static_cast<T>(value), LANES);
+		ClearPadding();
+		return *this;
+	}
+
+	template <typename A>
+	friend Composition<T> operator*(Composition<T> lhs, const A& rhs)
+	{
+		lhs *= rhs;
+		return lhs;
+	}
+
+	template <typename A>
+	Composition<T>& operator/=(const A& value)
+	{
+		Lanes::Divide(data(), static_cast<T>(value), LANES);
+		ClearPadding();
+		return *this;
+	}
+
+	template <typename A>
+	friend Composition<T> operator/(Composition<T> lhs, const A& rhs)
+	{
+		lhs /= rhs;
+		return lhs;
+	}
+
+private:
+	// A zero or non-finite factor would leave NaNs in the padding, which sum() adds up.
+	void ClearPadding()
+	{
+		for (T& lane : padding)
+			lane = 0;
+	}
+};
+
+static_assert(sizeof(Composition<float>) == Composition<float>::LANES * sizeof(float), "Composition has holes");
+static_assert(sizeof(Composition<double>) == Composition<double>::LANES * sizeof(double), "Composition has holes");
@@ -0,0 +1,167 @@
+#include "CompositionStore.h"
+
+#include <algorithm>
+#include <array>
+
+bool SparseComposition::Assign(Composition<float> const& dense)
+{
+	const size_t elements = Composition<float>::size();
+	float const* values = dense.data();
+
+	std::array<uint8_t, Composition<float>::ELEMENTS> order{};
+	for (size_t e = 0; e < elements; e++)
+		order[e] = static_cast<uint8_t>(e);
+
+	std::nth_element(order.begin(), order.begin() + CAPACITY, order.end(),
+	                 [values](uint8_t const a, uint8_t const b) { return values[a] > values[b]; });
+	std::sort(order.begin(), order.begin() + CAPACITY);
+
+	const float total = dense.sum();
+	float kept = 0;
+	for (size_t k = 0; k < CAPACITY; k++)
+		kept += std::max(values[order[k]], 0.f);
+
+	const float rest = std::max(total - kept, 0.f);
+	if (rest > TOLERANCE * total)
+		return false;
+
+	count = 0;
+	for (size_t k = 0; k < CAPACITY; k++)
+	{
+		if (values[order[k]] <= 0)
+			continue;
+
+		element[count] = order[k];
+		mass[count] = values[order[k]];
+		count++;
+	}
+	for (size_t k = count; k < CAPACITY; k++)
+		mass[k] = 0;
+
+	remainder = rest;
+	return true;
+}
+
+Composition<float> SparseComposition::Dense() const
+{
+	Composition<float> dense{};
+	dense = 0.f;
+
+	const float spread = Spread();
+	for (size_t k = 0; k < count; k++)
+		dense.data()[element[k]] = mass[k] * spread;
+
+	return dense;
+}
+
+float SparseComposition::Element(size_t const e) const
+{
+	for (size_t k = 0; k < count; k++)
+	{
+		if (element[k] == e)
+			return mass[k] * Spread();
+	}
+
+	return 0;
+}
+
+float SparseComposition::Spread() const
+{
+	float kept = 0;
+	for (size_t k = 0; k < count; k++)
+		kept += mass[k];
+
+	return kept > 0 ? (kept + remainder) / kept : 1.f;
+}
+
+float SparseComposition::sum() const
+{
+	float total = remainder;
+	for (size_t k = 0; k < count; k++)
+		total += mass[k];
+
+	return total;
+}
+
+void SparseComposition::Scale(float const factor)
+{
+	for (size_t k = 0; k < count; k++)
+		mass[k] *= factor;
+	remainder *= factor;
+}
+
+Composition<float> CompositionStore::Get(uint32_t const id) const
+{
+	if (SparseComposition const* sparse = m_sparse.Find(id))
+		return sparse->Dense();
+	if (Composition<float> const* dense = m_dense.Find(id))
+		return *dense;
+
+	Composition<float> none{};
+	none = 0.f;
+	return none;
+}
+
+float CompositionStore::Element(uint32_t const id, size_t const element) const
+{
+	if (SparseComposition const* sparse = m_sparse.Find(id))
+		return sparse->Element(element);
+	if (Composition<float> const* dense = m_dense.Find(id))
+		return dense->data()[element];
+
+	return 0;
+}
+
+float CompositionStore::Sum(uint32_t const id) const
+{
+	if (SparseComposition const* sparse = m_sparse.Find(id))
+		return sparse->sum();
+	if (Composition<float> const* dense = m_dense.Find(id))
+		return dense->sum();
+
+	return 0;
+}
+
+void CompositionStore::Set(uint32_t const id, Composition<float> const& composition)
+{
+	SparseComposition sparse;
+	if (sparse.Assign(composition))
+	{
+		m_sparse.Insert(id, sparse);
+		m_dense.Erase(id);
+	}
+	else
+	{
+		m_dense.Insert(id, composition);
+		m_sparse.Erase(id);
+	}
+}
+
+void CompositionStore::Add(uint32_t const id, Composition<double> const& value)
+{
+	Composition<float> composition = Get(id);
+	composition += value;
+	Set(id, composition);
+}
+
+void CompositionStore::Scale(uint32_t const id, float const factor)
+{
+	if (SparseComposition* sparse = m_sparse.Find(id))
+		sparse->Scale(factor);
+	else if (Composition<float>* dense = m_dense.Find(id))
+		*dense *= factor;
+}
+
+void CompositionStore::Clear(uint32_t const id)
+{
+	if (SparseComposition* sparse = m_sparse.Find(id))
+		*sparse = SparseComposition{};
+	else if (Composition<float>* dense = m_dense.Find(id))
+		*dense = 0.f;
+}
+
+size_t CompositionStore::Bytes() const
+{
+	return m_sparse.Size() * (sizeof(SparseComposition) + sizeof(uint32_t)) +
+		m_dense.Size() * (sizeof(Composition<float>) + sizeof(uint32_t));
+}
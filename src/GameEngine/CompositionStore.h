@@ -0,0 +1,75 @@
+#pragma once
+
+#include "Composition.h"
+#include "SlotMap.h"
+
+#include <cstddef>
+#include <cstdint>
+
+// The dominant elements of a composition as (element, mass) pairs sorted by element, plus the mass of all others
+// lumped into a remainder with no identity. A body drawn by Composition::Randomize has a handful of elements holding
+// nearly all its mass, which this keeps in 68 bytes instead of 448.
+struct SparseComposition
+{
+	static constexpr size_t CAPACITY = 12;
+
+	// Largest remainder, as a fraction of the total mass, a composition may have and stay sparse.
+	static constexpr float TOLERANCE = 1e-3f;
+
+	uint8_t count = 0;
+	uint8_t element[CAPACITY] = {};
+	float mass[CAPACITY] = {};
+	float remainder = 0;
+
+	// Keeps the CAPACITY heaviest elements of dense and returns true, or false without changing anything if the
+	// other elements hold more than TOLERANCE of the mass.
+	bool Assign(Composition<float> const& dense);
+
+	// The remainder is spread over the kept elements in proportion to their mass, so the total is conserved.
+	[[nodiscard]] Composition<float> Dense() const;
+
+	// Mass of element e as Dense() has it, the remainder spread included.
+	[[nodiscard]] float Element(size_t e) const;
+	[[nodiscard]] float sum() const;
+	void Scale(float factor);
+
+private:
+	// Factor taking a kept mass to its share of the total.
+	[[nodiscard]] float Spread() const;
+};
+
+// Compositions of the bodies by id, each sparse while its spectrum is narrow and dense once it gets broad, switching
+// whenever one is stored. Lookups and changes that keep the form (Scale, Clear) may run concurrently for different
+// ids; Set and Add can move a body between forms and must not.
+class CompositionStore
+{
+public:
+	[[nodiscard]] bool Contains(uint32_t const id) const { return m_sparse.Contains(id) || m_dense.Contains(id); }
+	[[nodiscard]] bool IsSparse(uint32_t const id) const { return m_sparse.Contains(id); }
+
+	// Dense copy of the composition of id, zero if it has none.
+	[[nodiscard]] Composition<float> Get(uint32_t id) const;
+	[[nodiscard]] float Element(uint32_t id, size_t element) const;
+	[[nodiscard]] float Sum(uint32_t id) const;
+
+	void Set(uint32_t id, Composition<float> const& composition);
+	void Add(uint32_t id, Composition<double> const& value);
+	void Scale(uint32_t id, float factor);
+	void Clear(uint32_t id);
+
+	// Drops the compositions of bodies not among items and orders the rest like them, see SlotMap::Align.
+	template <typename Items, typename KeyOf>
+	void Align(Items const& items, KeyOf const& keyOf)
+	{
+		m_sparse.Align(items, keyOf);
+		m_dense.Align(items, keyOf);
+	}
+
+	[[nodiscard]] size_t SparseCount() const { return m_sparse.Size(); }
+	[[nodiscard]] size_t DenseCount() const { return m_dense.Size(); }
+	[[nodiscard]] size_t Bytes() const;
+
+private:
+	SlotMap<SparseComposition> m_sparse;
+	SlotMap<Composition<float>> m_dense;
+};
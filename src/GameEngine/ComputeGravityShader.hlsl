@@ -13,6 +13,8 @@ cbuffer SystemBuffer : register(b2)
 {
 float systemMass;
 float3 centerOfMass;
+float quadrantSize;
+uint quadrantCount;
 };
 
 [numthreads(1, 1, 1)]
@@ -28,16 +30,13 @@ void main(
 	Instance body = instances[current];
 	Instance r_body = instances[reference];
 
-	if (current != reference && body.mass != 0 && r_body.mass != 0)
-	{
-		float radius = (float)toReal(distance(body.center, r_body.center));
-
-		// perform basic collision detection. Handled further by the ComputeCollisionShader
-		if (radius <= (body.radius + r_body.radius))
-		{
-			body.collision = 1;
-		}
+	// Only bodies in neighbouring quadrants attract each other here, ComputePositionShader adds the cells beyond them
+	// from their moments.
+	const float3 offset = abs(round(body.center / quadrantSize) - round(r_body.center / quadrantSize));
 
+	if (current != reference && body.mass != 0 && r_body.mass != 0 && all(offset <= 1))
+	{
+		// Collisions are found by the CPU broadphase.
 		double3 acceleration = GravitationalAcceleration(body, r_body, deltaTime);
 		body.velocity += (float3)acceleration;
 
@@ -6,7 +6,6 @@
 #include "Planet.h"
 
 template class ComputePipeline<Planet>;
-template class ComputePipeline<PlanetDescription>;
 
 template <typename T>
 ComputePipeline<T>::ComputePipeline(const size_t size) :
@@ -59,6 +58,12 @@ void ComputePipeline<T>::SetConstantBuffers(std::initializer_list<D3D12_CONSTANT
 		m_constantBuffers.emplace_back(buffer);
 }
 
+template <typename T>
+void ComputePipeline<T>::SetShaderResources(std::initializer_list<D3D12_GPU_VIRTUAL_ADDRESS> resources)
+{
+	m_shaderResources.assign(resources.begin(), resources.end());
+}
+
 template <typename T>
 void ComputePipeline<T>::CreatePipeline()
 {
@@ -85,7 +90,7 @@ void ComputePipeline<T>::CreatePipeline()
 
 	// Create root parameters and initialize first (constants)
 	std::vector<CD3DX12_ROOT_PARAMETER> rootParameters = std::vector<CD3DX12_ROOT_PARAMETER>(
-		m_constantBuffers.size() + 2);
+		m_constantBuffers.size() + 2 + m_shaderResources.size());
 
 	size_t length = m_constantBuffers.size();
 	for (int i = 0; i < length; i++)
@@ -100,6 +105,10 @@ void ComputePipeline<T>::CreatePipeline()
 		                                                 D3D12_DESCRIPTOR_RANGE_TYPE_SAMPLER, 1, 0),
 	                                                 D3D12_SHADER_VISIBILITY_ALL);
 
+	// Structured buffers after the tables
+	for (size_t i = 0; i < m_shaderResources.size(); i++)
+		rootParameters[length + 2 + i].InitAsShaderResourceView(static_cast<UINT>(i), 0, D3D12_SHADER_VISIBILITY_ALL);
+
 	// Root parameter descriptor
 	CD3DX12_ROOT_SIGNATURE_DESC rsigDesc = {};
 	rsigDesc.Init(
@@ -199,12 +208,11 @@ template <typename T>
 void ComputePipeline<T>::Execute(const std::vector<T*>& data, const UINT threadX, const UINT threadY,
                                  const UINT threadZ)
 {
-	std::vector<T> values = {};
-	for (T* item : data)
-		values.push_back(*item);
-
-	ZeroMemory(m_data, sizeof(T) * m_size);
-	memcpy(m_data, values.data(), sizeof(T) * values.size());
+	// Straight into the upload buffer, only the unused tail needs clearing.
+	for (size_t i = 0; i < data.size(); i++)
+		memcpy(static_cast<T*>(m_data) + i, data[i], sizeof(T));
+	if (data.size() < m_size)
+		ZeroMemory(static_cast<T*>(m_data) + data.size(), sizeof(T) * (m_size - data.size()));
 
 	const uint32_t totalThreads = threadX * threadY * threadZ;
 	const uint32_t maxThreads = 1000000;
@@ -233,6 +241,9 @@ void ComputePipeline<T>::Execute(const std::vector<T*>& data, const UINT threadX
 		m_commandList->SetDescriptorHeaps(1, m_uavDescriptorHeap.GetAddressOf());
 		m_commandList->SetComputeRootDescriptorTable(length, m_uavDescriptorHeap->GetGPUDescriptorHandleForHeapStart());
 
+		for (size_t i = 0; i < m_shaderResources.size(); i++)
+			m_commandList->SetComputeRootShaderResourceView(static_cast<UINT>(length + 2 + i), m_shaderResources[i]);
+
 		m_commandList->Dispatch(threadX, threadY - cursor > step ? step : threadY - cursor, threadZ);
 
 		DX::ThrowIfFailed(m_commandList->Close());
@@ -20,12 +20,17 @@ public:
 		m_fenceValue(self.m_fenceValue),
 		m_computeShader(self.m_computeShader),
 		m_constantBuffers(self.m_constantBuffers),
+		m_shaderResources(self.m_shaderResources),
 		m_data(self.m_data)
 	{
 	}
 
 	void LoadShader(char* compute);
 	void SetConstantBuffers(std::initializer_list<D3D12_CONSTANT_BUFFER_VIEW_DESC> buffers);
+
+	// Buffers bound as root shader resource views t0, t1, ... for StructuredBuffer reads. The root signature holds as
+	// many as were set before CreatePipeline, later calls may only move them to other buffers.
+	void SetShaderResources(std::initializer_list<D3D12_GPU_VIRTUAL_ADDRESS> resources);
 	ID3D12GraphicsCommandList* GetCommandList() { return m_commandList.Get(); }
 
 	void CreatePipeline();
@@ -53,6 +58,7 @@ private:
 
 	D3D12_SHADER_BYTECODE m_computeShader;
 	std::vector<D3D12_CONSTANT_BUFFER_VIEW_DESC> m_constantBuffers;
+	std::vector<D3D12_GPU_VIRTUAL_ADDRESS> m_shaderResources;
 	Buffers::ConstantBuffer<uint32_t> m_cursor;
 
 	void* m_data;
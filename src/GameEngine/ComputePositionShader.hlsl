@@ -1,6 +1,7 @@
 #include "Globals.hlsli"
 
 RWStructuredBuffer<Instance> instances : register(u0);
+StructuredBuffer<Quadrant> quadrants : register(t0);
 
 cbuffer CursorBuffer : register(b0) { uint cursor; };
 cbuffer EnvironmentBuffer : register(b1)
@@ -13,6 +14,8 @@ cbuffer SystemBuffer : register(b2)
 {
 float systemMass;
 float3 centerOfMass;
+float quadrantSize;
+uint quadrantCount;
 };
 
 [numthreads(1, 1, 1)]
@@ -30,16 +33,32 @@ void main(
 	{
 		//body.center -= centerOfMass;
 
-		if (body.quadrantMass > 0)
+		// The quadrants beyond the 27 around the body, whose pairs ComputeGravityShader summed, act through their
+		// monopole and quadrupole as in QuadrantIndex::FarField:
+		// a = -M d / r^3 + Q d / r^5 - 5/2 (d Q d) d / r^7, d pointing from the cell to the body.
+		const int3 cell = (int3)round(body.center / quadrantSize);
+		float3 far = float3(0, 0, 0);
+		for (uint c = 0; c < quadrantCount; c++)
 		{
-			Instance r_body;
-			r_body.center = float3(0, 0, 0);
-			r_body.mass = (systemMass - body.quadrantMass);
+			const Quadrant quadrant = quadrants[c];
+			if (all(abs(quadrant.cell - cell) <= 1))
+				continue;
 
-			double3 acceleration = GravitationalAcceleration(body, r_body, deltaTime);
-			body.velocity += (float3)acceleration;
+			const float3 d = body.center - quadrant.center;
+			const float inv = rsqrt(dot(d, d));
+			const float inv2 = inv * inv;
+			const float inv5 = inv2 * inv2 * inv;
+
+			const float3 o = quadrant.offDiagonal;
+			const float3 q = quadrant.diagonal * d +
+				float3(o.x * d.y + o.y * d.z, o.x * d.x + o.z * d.z, o.y * d.x + o.z * d.y);
+			const float radial = -quadrant.mass * inv2 * inv - 2.5f * dot(d, q) * inv5 * inv2;
+
+			far += radial * d + q * inv5;
 		}
 
+		body.velocity += far * deltaTime;
+
 		body.center += lerp(float3(0, 0, 0), body.velocity, deltaTime);
 		//body.direction += lerp(float3(0, 0, 0), body.angular, deltaTime);
 
@@ -0,0 +1,353 @@
+#include "DirectSumSolver.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+namespace
+{
+	// Bodies used to pad the last tile: massless, without radius and far away from everything else.
+	constexpr double PADDING_POSITION = 1e30;
+
+	struct TileData
+	{
+		const double* x;
+		const double* y;
+		const double* z;
+		const double* m;
+		const double* r;
+		double* ax;
+		double* ay;
+		double* az;
+		uint8_t* hit;
+	};
+
+	double Milliseconds(std::chrono::high_resolution_clock::time_point const start)
+	{
+		return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+	}
+
+	void PairScalar(TileData const& d, uint32_t const i0, uint32_t const i1, uint32_t const j0, uint32_t const j1)
+	{
+		for (uint32_t i = i0; i < i1; i++)
+		{
+			const double xi = d.x[i], yi = d.y[i], zi = d.z[i], mi = d.m[i], ri = d.r[i];
+			double ax = 0, ay = 0, az = 0;
+
+			for (uint32_t j = std::max(j0, i + 1); j < j1; j++)
+			{
+				const double dx = d.x[j] - xi;
+				const double dy = d.y[j] - yi;
+				const double dz = d.z[j] - zi;
+				const double r2 = dx * dx + dy * dy + dz * dz;
+
+				const double reach = ri + d.r[j];
+				if (r2 <= reach * reach)
+					d.hit[i] = d.hit[j] = 1;
+
+				if (r2 > 0)
+				{
+					const double inv = 1 / sqrt(r2);
+					const double inv3 = inv * inv * inv;
+					const double sj = d.m[j] * inv3;
+					const double si = mi * inv3;
+
+					ax += dx * sj;
+					ay += dy * sj;
+					az += dz * sj;
+					d.ax[j] -= dx * si;
+					d.ay[j] -= dy * si;
+					d.az[j] -= dz * si;
+				}
+			}
+
+			d.ax[i] += ax;
+			d.ay[i] += ay;
+			d.az[i] += az;
+		}
+	}
+
+#ifdef SIMD_X86
+	SIMD_TARGET("avx2,fma")
+	double Sum(__m256d const v)
+	{
+		const __m128d low = _mm256_castpd256_pd128(v);
+		const __m128d high = _mm256_extractf128_pd(v, 1);
+		const __m128d pair = _mm_add_pd(low, high);
+		return _mm_cvtsd_f64(_mm_add_sd(pair, _mm_unpackhi_pd(pair, pair)));
+	}
+
+	// j0 and j1 must be multiples of 4 and the tiles must not overlap.
+	SIMD_TARGET("avx2,fma")
+	void PairAvx2(TileData const& d, uint32_t const i0, uint32_t const i1, uint32_t const j0, uint32_t const j1)
+	{
+		const __m256d zero = _mm256_setzero_pd();
+		const __m256d one = _mm256_set1_pd(1.);
+
+		for (uint32_t i = i0; i < i1; i++)
+		{
+			const __m256d xi = _mm256_set1_pd(d.x[i]);
+			const __m256d yi = _mm256_set1_pd(d.y[i]);
+			const __m256d zi = _mm256_set1_pd(d.z[i]);
+			const __m256d mi = _mm256_set1_pd(d.m[i]);
+			const __m256d ri = _mm256_set1_pd(d.r[i]);
+
+			__m256d ax = zero, ay = zero, az = zero;
+
+			for (uint32_t j = j0; j < j1; j += 4)
+			{
+				const __m256d dx = _mm256_sub_pd(_mm256_load_pd(d.x + j), xi);
+				const __m256d dy = _mm256_sub_pd(_mm256_load_pd(d.y + j), yi);
+				const __m256d dz = _mm256_sub_pd(_mm256_load_pd(d.z + j), zi);
+				const __m256d r2 = _mm256_fmadd_pd(dx, dx, _mm256_fmadd_pd(dy, dy, _mm256_mul_pd(dz, dz)));
+
+				const __m256d reach = _mm256_add_pd(_mm256_load_pd(d.r + j), ri);
+				const int overlap = _mm256_movemask_pd(_mm256_cmp_pd(r2, _mm256_mul_pd(reach, reach), _CMP_LE_OQ));
+				if (overlap != 0)
+				{
+					d.hit[i] = 1;
+					for (int lane = 0; lane < 4; lane++)
+						if (overlap & (1 << lane)) d.hit[j + lane] = 1;
+				}
+
+				const __m256d inv = _mm256_div_pd(one, _mm256_sqrt_pd(r2));
+				__m256d inv3 = _mm256_mul_pd(_mm256_mul_pd(inv, inv), inv);
+				inv3 = _mm256_and_pd(inv3, _mm256_cmp_pd(r2, zero, _CMP_GT_OQ));
+
+				const __m256d sj = _mm256_mul_pd(_mm256_load_pd(d.m + j), inv3);
+				const __m256d si = _mm256_mul_pd(mi, inv3);
+
+				ax = _mm256_fmadd_pd(dx, sj, ax);
+				ay = _mm256_fmadd_pd(dy, sj, ay);
+				az = _mm256_fmadd_pd(dz, sj, az);
+
+				_mm256_store_pd(d.ax + j, _mm256_fnmadd_pd(dx, si, _mm256_load_pd(d.ax + j)));
+				_mm256_store_pd(d.ay + j, _mm256_fnmadd_pd(dy, si, _mm256_load_pd(d.ay + j)));
+				_mm256_store_pd(d.az + j, _mm256_fnmadd_pd(dz, si, _mm256_load_pd(d.az + j)));
+			}
+
+			d.ax[i] += Sum(ax);
+			d.ay[i] += Sum(ay);
+			d.az[i] += Sum(az);
+		}
+	}
+
+	// Through memory, _mm512_reduce_add_pd extracts from an undefined register that GCC warns about.
+	SIMD_TARGET("avx512f")
+	double Sum(__m512d const v)
+	{
+		alignas(64) double lanes[8];
+		_mm512_store_pd(lanes, v);
+		return ((lanes[0] + lanes[1]) + (lanes[2] + lanes[3])) + ((lanes[4] + lanes[5]) + (lanes[6] + lanes[7]));
+	}
+
+	// j0 and j1 must be multiples of 8 and the tiles must not overlap.
+	SIMD_TARGET("avx512f")
+	void PairAvx512(TileData const& d, uint32_t const i0, uint32_t const i1, uint32_t const j0, uint32_t const j1)
+	{
+		const __m512d zero = _mm512_setzero_pd();
+		const __m512d one = _mm512_set1_pd(1.);
+
+		for (uint32_t i = i0; i < i1; i++)
+		{
+			const __m512d xi = _mm512_set1_pd(d.x[i]);
+			const __m512d yi = _mm512_set1_pd(d.y[i]);
+			const __m512d zi = _mm512_set1_pd(d.z[i]);
+			const __m512d mi = _mm512_set1_pd(d.m[i]);
+			const __m512d ri = _mm512_set1_pd(d.r[i]);
+
+			__m512d ax = zero, ay = zero, az = zero;
+
+			for (uint32_t j = j0; j < j1; j += 8)
+			{
+				const __m512d dx = _mm512_sub_pd(_mm512_load_pd(d.x + j), xi);
+				const __m512d dy = _mm512_sub_pd(_mm512_load_pd(d.y + j), yi);
+				const __m512d dz = _mm512_sub_pd(_mm512_load_pd(d.z + j), zi);
+				const __m512d r2 = _mm512_fmadd_pd(dx, dx, _mm512_fmadd_pd(dy, dy, _mm512_mul_pd(dz, dz)));
+
+				const __m512d reach = _mm512_add_pd(_mm512_load_pd(d.r + j), ri);
+				const __mmask8 overlap = _mm512_cmp_pd_mask(r2, _mm512_mul_pd(reach, reach), _CMP_LE_OQ);
+				if (overlap != 0)
+				{
+					d.hit[i] = 1;
+					for (int lane = 0; lane < 8; lane++)
+						if (overlap & (1 << lane)) d.hit[j + lane] = 1;
+				}
+
+				const __mmask8 valid = _mm512_cmp_pd_mask(r2, zero, _CMP_GT_OQ);
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+				// _mm512_sqrt_pd passes _mm512_undefined_pd as the unused merge source.
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+				const __m512d inv = _mm512_div_pd(one, _mm512_sqrt_pd(r2));
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+				const __m512d inv3 = _mm512_maskz_mul_pd(valid, _mm512_mul_pd(inv, inv), inv);
+
+				const __m512d sj = _mm512_mul_pd(_mm512_load_pd(d.m + j), inv3);
+				const __m512d si = _mm512_mul_pd(mi, inv3);
+
+				ax = _mm512_fmadd_pd(dx, sj, ax);
+				ay = _mm512_fmadd_pd(dy, sj, ay);
+				az = _mm512_fmadd_pd(dz, sj, az);
+
+				_mm512_store_pd(d.ax + j, _mm512_fnmadd_pd(dx, si, _mm512_load_pd(d.ax + j)));
+				_mm512_store_pd(d.ay + j, _mm512_fnmadd_pd(dy, si, _mm512_load_pd(d.ay + j)));
+				_mm512_store_pd(d.az + j, _mm512_fnmadd_pd(dz, si, _mm512_load_pd(d.az + j)));
+			}
+
+			d.ax[i] += Sum(ax);
+			d.ay[i] += Sum(ay);
+			d.az[i] += Sum(az);
+		}
+	}
+#endif
+}
+
+DirectSumSolver::DirectSumSolver(uint32_t const tileSize) :
+	m_tileSize(std::max<uint32_t>((tileSize + 7) & ~7u, 8)),
+	m_simd(SimdLevel::Scalar),
+	m_name(nullptr)
+{
+	SetSimdLevel(::GetSimdLevel());
+}
+
+void DirectSumSolver::SetSimdLevel(SimdLevel const level)
+{
+	m_simd = std::min(level, ::GetSimdLevel());
+
+	switch (m_simd)
+	{
+	case SimdLevel::AVX512: m_name = "Direct Sum (AVX-512)";
+		break;
+	case SimdLevel::AVX2: m_name = "Direct Sum (AVX2)";
+		break;
+	default: m_name = "Direct Sum (Scalar)";
+		break;
+	}
+}
+
+void DirectSumSolver::Accelerate(GravityBodies const& bodies)
+{
+	m_stats = {};
+
+	auto start = std::chrono::high_resolution_clock::now();
+	Gather(bodies);
+	m_stats.buildTime = Milliseconds(start);
+
+	start = std::chrono::high_resolution_clock::now();
+
+	const auto tiles = static_cast<uint32_t>(m_x.size() / m_tileSize);
+
+	parallel_for(0, tiles, 1, [this](size_t const tile) { DiagonalTile(static_cast<uint32_t>(tile)); });
+
+	// Circle method: slot `slots - 1` stays fixed while the others rotate, which pairs every tile with every other
+	// tile exactly once over slots - 1 rounds without any tile appearing twice within a round.
+	const uint32_t slots = tiles + (tiles & 1);
+	for (uint32_t round = 0; round + 1 < slots; round++)
+	{
+		parallel_for(0, slots / 2, 1, [this, slots, tiles, round](size_t const k)
+		{
+			uint32_t a, b;
+			if (k == 0)
+			{
+				a = slots - 1;
+				b = round;
+			}
+			else
+			{
+				a = (round + static_cast<uint32_t>(k)) % (slots - 1);
+				b = (round + slots - 1 - static_cast<uint32_t>(k)) % (slots - 1);
+			}
+
+			if (a < tiles && b < tiles)
+				PairTile(std::min(a, b), std::max(a, b));
+		});
+	}
+
+	std::fill(bodies.ax, bodies.ax + bodies.count, 0.);
+	std::fill(bodies.ay, bodies.ay + bodies.count, 0.);
+	std::fill(bodies.az, bodies.az + bodies.count, 0.);
+
+	for (size_t k = 0; k < m_count; k++)
+	{
+		const uint32_t i = m_order[k];
+
+		bodies.ax[i] = m_ax[k] * G_SCREEN;
+		bodies.ay[i] = m_ay[k] * G_SCREEN;
+		bodies.az[i] = m_az[k] * G_SCREEN;
+
+		if (m_collision[k])
+			bodies.collision[i] = 1;
+	}
+
+	m_stats.forceTime = Milliseconds(start);
+	m_stats.interactions = static_cast<uint64_t>(m_count) * (m_count > 0 ? m_count - 1 : 0) / 2;
+	m_stats.gflops = m_stats.forceTime > 0
+		                 ? static_cast<double>(m_stats.interactions) * FLOPS_PER_PAIR / (m_stats.forceTime * 1e6)
+		                 : 0;
+}
+
+void DirectSumSolver::Gather(GravityBodies const& bodies)
+{
+	// Massless bodies neither attract nor get attracted in the shader.
+	m_order.clear();
+	for (uint32_t i = 0; i < bodies.count; i++)
+		if (bodies.mass[i] != 0) m_order.push_back(i);
+
+	m_count = m_order.size();
+	const size_t padded = (m_count + m_tileSize - 1) / m_tileSize * m_tileSize;
+
+	for (auto* values : {&m_x, &m_y, &m_z})
+		values->assign(padded, PADDING_POSITION);
+	for (auto* values : {&m_mass, &m_radius, &m_ax, &m_ay, &m_az})
+		values->assign(padded, 0.);
+	m_collision.assign(padded, 0);
+
+	for (size_t k = 0; k < m_count; k++)
+	{
+		const uint32_t i = m_order[k];
+
+		m_x[k] = bodies.x[i];
+		m_y[k] = bodies.y[i];
+		m_z[k] = bodies.z[i];
+		m_mass[k] = bodies.mass[i];
+		m_radius[k] = static_cast<double>(bodies.radius[i]) * S_NORM_INV;
+	}
+}
+
+void DirectSumSolver::DiagonalTile(uint32_t const tile)
+{
+	const TileData data = {
+		m_x.data(), m_y.data(), m_z.data(), m_mass.data(), m_radius.data(),
+		m_ax.data(), m_ay.data(), m_az.data(), m_collision.data()
+	};
+
+	const uint32_t begin = tile * m_tileSize;
+	PairScalar(data, begin, begin + m_tileSize, begin, begin + m_tileSize);
+}
+
+void DirectSumSolver::PairTile(uint32_t const a, uint32_t const b)
+{
+	const TileData data = {
+		m_x.data(), m_y.data(), m_z.data(), m_mass.data(), m_radius.data(),
+		m_ax.data(), m_ay.data(), m_az.data(), m_collision.data()
+	};
+
+	const uint32_t i0 = a * m_tileSize, j0 = b * m_tileSize;
+
+	switch (m_simd)
+	{
+#ifdef SIMD_X86
+	case SimdLevel::AVX512: PairAvx512(data, i0, i0 + m_tileSize, j0, j0 + m_tileSize);
+		break;
+	case SimdLevel::AVX2: PairAvx2(data, i0, i0 + m_tileSize, j0, j0 + m_tileSize);
+		break;
+#endif
+	default: PairScalar(data, i0, i0 + m_tileSize, j0, j0 + m_tileSize);
+		break;
+	}
+}
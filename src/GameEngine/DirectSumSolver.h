@@ -0,0 +1,40 @@
+#pragma once
+
+#include "GravitySolver.h"
+#include "Simd.h"
+
+// Exact O(N^2) gravity on the CPU. Every pair is evaluated once and applied to both bodies (Newton's third law). The
+// bodies are split into tiles small enough for two of them to stay in L1; each symmetric tile pair is one task, and
+// the tile pairs are scheduled in rounds (circle method) in which no two tasks share a tile, so the accumulators need
+// no locking and the result does not depend on the number of threads. Arithmetic and accumulation are in double, the
+// kernels use AVX-512 or AVX2 when the CPU supports it.
+class DirectSumSolver final : public GravitySolver
+{
+public:
+	explicit DirectSumSolver(uint32_t tileSize = 128);
+
+	void Accelerate(GravityBodies const& bodies) override;
+	[[nodiscard]] const char* Name() const override { return m_name; }
+
+	void SetSimdLevel(SimdLevel level);
+	[[nodiscard]] SimdLevel GetSimdLevel() const { return m_simd; }
+
+	// Floating point operations counted per pair interaction (sqrt and division count as one each).
+	static constexpr double FLOPS_PER_PAIR = 26;
+
+private:
+	void Gather(GravityBodies const& bodies);
+	void DiagonalTile(uint32_t tile);
+	void PairTile(uint32_t a, uint32_t b);
+
+	uint32_t m_tileSize;
+	SimdLevel m_simd;
+	const char* m_name;
+
+	// Live bodies only, padded to a whole number of tiles with massless bodies far outside the system.
+	size_t m_count = 0;
+	std::vector<uint32_t> m_order;
+	AlignedVector<double> m_x, m_y, m_z, m_mass, m_radius;
+	AlignedVector<double> m_ax, m_ay, m_az;
+	std::vector<uint8_t> m_collision;
+};
@@ -0,0 +1,265 @@
+#include "EscapeEngine.h"
+
+#include "Lanes.h"
+#include "PhysicalConstants.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+	using Lane = Composition<double>;
+
+	// Speeds in units of the most probable one the tables are integrated over, midpoints of [0, SPEED_MAX]. The
+	// Maxwell-Boltzmann density is below 1e-26 past it.
+	constexpr size_t SAMPLES = 4096;
+	constexpr double SPEED_MAX = 8;
+
+	constexpr double TABLE_SCALE = EscapeEngine::TABLE / EscapeEngine::LAMBDA_MAX;
+
+	// One layer's part of a step. current holds the element masses the layer started the step with, up and down are
+	// the layers next to it, null at the ends of the profile. escape is v_esc^2 / (pressure * volume) of the layer.
+	// Returns the mass that left through the top of the profile.
+	struct LayerStep
+	{
+		double const* lambda;
+		double const* rise;
+		double const* fall;
+		double const* current;
+		double* layer;
+		double* up;
+		double* down;
+		double escape;
+		double rate;
+	};
+
+	double Interpolate(double const* table, double const lambda)
+	{
+		const double t = std::min((lambda > 0 ? lambda : 0) * TABLE_SCALE, static_cast<double>(EscapeEngine::TABLE));
+		const auto i = static_cast<size_t>(t);
+		return table[i] + (table[i + 1] - table[i]) * (t - static_cast<double>(i));
+	}
+
+	// One element's part of the step, in the operation order of TransferAvx2. Returns the mass that left through the
+	// top of the profile.
+	double TransferElement(LayerStep const& s, size_t const i)
+	{
+		const double mass = s.current[i];
+		if (!(mass > 0))
+			return 0;
+
+		const double lambda = (s.lambda[i] * s.escape) * (mass * mass);
+		double rise = Interpolate(s.rise, lambda) * s.rate;
+		double fall = s.down != nullptr ? Interpolate(s.fall, lambda) * s.rate : 0;
+
+		// As _mm256_max_pd, a NaN total leaves the shares unscaled.
+		const double total = rise + fall;
+		const double scale = 1 / (total > 1 ? total : 1.);
+		rise *= scale;
+		fall *= scale;
+
+		const double up = mass * rise, down = mass * fall;
+		double lost = 0;
+		if (s.up != nullptr)
+			s.up[i] += up;
+		else lost = up;
+
+		if (s.down != nullptr)
+			s.down[i] += down;
+
+		s.layer[i] -= up + down;
+		return lost;
+	}
+
+	// The elements past the last whole register of the vector path, summed in order.
+	double TransferTail(LayerStep const& s, size_t const begin, size_t const end)
+	{
+		double lost = 0;
+		for (size_t i = begin; i < end; i++)
+			lost += TransferElement(s, i);
+
+		return lost;
+	}
+
+	// Sums the escaped mass in four lanes reduced like TransferAvx2's, so both paths give bit-identical results.
+	double TransferScalar(LayerStep const& s, size_t const count)
+	{
+		double lanes[4] = {};
+		const size_t whole = count - count % 4;
+		for (size_t i = 0; i < whole; i++)
+			lanes[i % 4] += TransferElement(s, i);
+
+		return TransferTail(s, whole, count) + ((lanes[0] + lanes[1]) + (lanes[2] + lanes[3]));
+	}
+
+#ifdef SIMD_X86
+	SIMD_TARGET("avx2")
+	__m256d InterpolateAvx2(double const* table, __m256d const lambda)
+	{
+		// A NaN lambda reads as 0, _mm256_max_pd returns its second operand then.
+		const __m256d t = _mm256_min_pd(_mm256_mul_pd(_mm256_max_pd(lambda, _mm256_setzero_pd()),
+		                                              _mm256_set1_pd(TABLE_SCALE)),
+		                                _mm256_set1_pd(static_cast<double>(EscapeEngine::TABLE)));
+		// The masked gathers start from zero, the plain ones from an undefined register.
+		const __m128i index = _mm256_cvttpd_epi32(t);
+		const __m256d all = _mm256_castsi256_pd(_mm256_set1_epi64x(-1));
+		const __m256d low = _mm256_mask_i32gather_pd(_mm256_setzero_pd(), table, index, all, 8);
+		const __m256d high = _mm256_mask_i32gather_pd(_mm256_setzero_pd(), table + 1, index, all, 8);
+		return _mm256_add_pd(low, _mm256_mul_pd(_mm256_sub_pd(high, low), _mm256_sub_pd(t, _mm256_cvtepi32_pd(index))));
+	}
+
+	SIMD_TARGET("avx2")
+	double TransferAvx2(LayerStep const& s, size_t const count)
+	{
+		const __m256d zero = _mm256_setzero_pd(), one = _mm256_set1_pd(1.);
+		const __m256d escape = _mm256_set1_pd(s.escape), rate = _mm256_set1_pd(s.rate);
+
+		__m256d lost = zero;
+		const size_t whole = count - count % 4;
+		for (size_t i = 0; i < whole; i += 4)
+		{
+			const __m256d mass = _mm256_loadu_pd(s.current + i);
+			const __m256d valid = _mm256_cmp_pd(mass, zero, _CMP_GT_OQ);
+			if (_mm256_movemask_pd(valid) == 0)
+				continue;
+
+			const __m256d lambda = _mm256_mul_pd(_mm256_mul_pd(_mm256_loadu_pd(s.lambda + i), escape),
+			                                     _mm256_mul_pd(mass, mass));
+			__m256d rise = _mm256_mul_pd(InterpolateAvx2(s.rise, lambda), rate);
+			__m256d fall = s.down != nullptr ? _mm256_mul_pd(InterpolateAvx2(s.fall, lambda), rate) : zero;
+
+			const __m256d scale = _mm256_div_pd(one, _mm256_max_pd(_mm256_add_pd(rise, fall), one));
+			rise = _mm256_mul_pd(rise, scale);
+			fall = _mm256_mul_pd(fall, scale);
+
+			const __m256d up = _mm256_and_pd(valid, _mm256_mul_pd(mass, rise));
+			const __m256d down = _mm256_and_pd(valid, _mm256_mul_pd(mass, fall));
+
+			if (s.up != nullptr)
+				_mm256_storeu_pd(s.up + i, _mm256_add_pd(_mm256_loadu_pd(s.up + i), up));
+			else lost = _mm256_add_pd(lost, up);
+
+			if (s.down != nullptr)
+				_mm256_storeu_pd(s.down + i, _mm256_add_pd(_mm256_loadu_pd(s.down + i), down));
+
+			_mm256_storeu_pd(s.layer + i, _mm256_sub_pd(_mm256_loadu_pd(s.layer + i), _mm256_add_pd(up, down)));
+		}
+
+		alignas(32) double lanes[4];
+		_mm256_store_pd(lanes, lost);
+		return TransferTail(s, whole, count) + ((lanes[0] + lanes[1]) + (lanes[2] + lanes[3]));
+	}
+#endif
+
+	double Transfer(LayerStep const& s, size_t const count)
+	{
+#ifdef SIMD_X86
+		if (EscapeEngine::Level() == SimdLevel::AVX2)
+			return TransferAvx2(s, count);
+#endif
+		return TransferScalar(s, count);
+	}
+}
+
+EscapeEngine::EscapeEngine(double const* weights) :
+	m_lambda(Lane::LANES, 0.),
+	m_rise(TABLE + 2, 0.),
+	m_fall(TABLE + 2, 0.)
+{
+	// v_rms = sqrt(3 kB (weight / Na) / R * pressure * volume) / mass and v_p^2 = 2/3 v_rms^2.
+	for (size_t i = 0; i < Lane::size(); i++)
+		m_lambda[i] = 1.5 / (3 * kB * (weights[i] / Na) / R);
+
+	std::vector<double> density(SAMPLES);
+	const double dx = SPEED_MAX / SAMPLES;
+	for (size_t k = 0; k < SAMPLES; k++)
+	{
+		const double x = (static_cast<double>(k) + .5) * dx;
+		density[k] = 4 / std::sqrt(PI) * x * x * std::exp(-x * x) * dx;
+	}
+
+	// The share of a particle at speed v is sqrt((v - v_esc) / v) above the escape velocity and
+	// sqrt((v_esc - v) / v_esc) below it, their expectations are integrated in units of v_p.
+	for (size_t n = 0; n < TABLE; n++)
+	{
+		const double escape = std::sqrt(static_cast<double>(n) / TABLE_SCALE);
+
+		double rise = 0, fall = 0;
+		for (size_t k = 0; k < SAMPLES; k++)
+		{
+			const double x = (static_cast<double>(k) + .5) * dx;
+			if (x > escape)
+				rise += density[k] * std::sqrt((x - escape) / x);
+			else
+				fall += density[k] * std::sqrt((escape - x) / escape);
+		}
+
+		m_rise[n] = rise;
+		m_fall[n] = fall;
+	}
+
+	// At LAMBDA_MAX the tail is below 1e-26, so nothing rises any more and whatever is not bound falls.
+	m_rise[TABLE] = m_rise[TABLE + 1] = 0;
+	m_fall[TABLE] = m_fall[TABLE + 1] = m_fall[TABLE - 1];
+}
+
+SimdLevel EscapeEngine::Level()
+{
+#ifdef SIMD_X86
+	if (GetSimdLevel() != SimdLevel::Scalar)
+		return SimdLevel::AVX2;
+#endif
+	return SimdLevel::Scalar;
+}
+
+double EscapeEngine::Evolve(ProfileLayers const& profile, double const deltaTime) const
+{
+	constexpr size_t lanes = Lane::LANES;
+	if (profile.Empty() || profile.elements != lanes)
+		return 0;
+
+	// Only element masses move between layers and each layer only feeds its neighbours, so the masses a layer starts
+	// with are kept for it and the one above instead of copying the whole profile.
+	alignas(32) double current[lanes], above[lanes];
+	std::copy_n(profile.Elements(0), lanes, current);
+
+	LayerStep step{};
+	step.lambda = m_lambda.data();
+	step.rise = m_rise.data();
+	step.fall = m_fall.data();
+	step.current = current;
+	step.rate = deltaTime / 3600.;
+
+	double lost = 0;
+	double insideMass = 0;
+	for (size_t j = 0; j < profile.count; j++)
+	{
+		if (j + 1 < profile.count)
+			std::copy_n(profile.Elements(j + 1), lanes, above);
+
+		insideMass += profile.mass[j];
+
+		step.layer = profile.Elements(j);
+		step.up = j + 1 < profile.count ? profile.Elements(j + 1) : nullptr;
+		step.down = j > 0 ? profile.Elements(j - 1) : nullptr;
+		step.escape = (2 * G * insideMass) / (profile.radius[j] * profile.pressure[j] * profile.volume[j]);
+
+		lost += Transfer(step, lanes);
+
+		std::copy_n(above, lanes, current);
+	}
+
+	for (size_t j = profile.count - 1; j > 0; j--)
+	{
+		double* layer = profile.Elements(j);
+		for (size_t i = 0; i < lanes; i++)
+		{
+			if (!(layer[i] >= 0))
+				layer[i] = 0;
+		}
+
+		profile.mass[j] = Lanes::Sum(layer, lanes);
+	}
+
+	return lost;
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include "Composition.h"
+#include "ProfileArena.h"
+#include "Simd.h"
+
+#include <vector>
+
+// The thermal escape model of the density profiles: every element of every layer moves a share of its mass to the
+// layer above as far as its particles outrun the escape velocity there, and to the layer below as far as they fall
+// short, with the top layer losing to space. The particle speeds follow a Maxwell-Boltzmann distribution and the
+// shares are its expectation, read from tables indexed by the escape parameter lambda = v_esc^2 / v_p^2 with v_p the
+// most probable speed, so a step is deterministic. The per-element constants are tabled once, a layer is worked on
+// four elements at a time with AVX2 when GetSimdLevel() allows it, and bodies touch only their own layers, so any
+// number of profiles can evolve in parallel. The scalar path keeps the vector path's operation order and its four
+// partial sums of the escaped mass, so results don't depend on the machine.
+class EscapeEngine
+{
+public:
+	// Tabled lambdas, uniformly spaced over [0, LAMBDA_MAX]. Beyond it no particle escapes.
+	static constexpr size_t TABLE = 1024;
+	static constexpr double LAMBDA_MAX = 64;
+
+	// weights: molar mass of every element in g/mol, in Composition's field order.
+	explicit EscapeEngine(double const* weights);
+
+	// One step of deltaTime seconds for a whole profile. When an element's shares up and down add up to more than it
+	// has they are scaled to all of it, so long steps drain a layer instead of overshooting. Afterwards every layer but
+	// the innermost has no negative element masses and its mass is the sum of them. Returns the mass in kg that escaped
+	// the top layer.
+	double Evolve(ProfileLayers const& profile, double deltaTime) const;
+
+	// The layer kernels Evolve runs: AVX2 or Scalar, never wider.
+	[[nodiscard]] static SimdLevel Level();
+
+private:
+	// lambda of every element per unit of v_esc^2 / (pressure * volume) and per kg^2 of the element in the layer,
+	// 3/2 over the squared thermal speed constant sqrt(3 kB (weight / Na) / R). Zero in the padding lanes.
+	AlignedVector<double> m_lambda;
+
+	// TABLE + 2 entries, the last one repeating LAMBDA_MAX so interpolation at the end reads inside.
+	std::vector<double> m_rise;
+	std::vector<double> m_fall;
+};
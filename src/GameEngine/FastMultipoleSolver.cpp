@@ -0,0 +1,659 @@
+#include "FastMultipoleSolver.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+
+namespace
+{
+	typedef std::complex<double> Complex;
+
+	// Bits per axis of the Morton keys, which limits the depth of the tree.
+	constexpr uint32_t KEY_BITS = 21;
+	constexpr uint32_t MAX_LEVEL = 16;
+	constexpr uint32_t CELLS_PER_TASK = 16;
+
+	constexpr int Terms(int const order) { return (order + 1) * (order + 2) / 2; }
+	constexpr int MAX_TERMS = Terms(FastMultipoleSolver::MAX_ORDER);
+	constexpr int FULL_TERMS = (FastMultipoleSolver::MAX_ORDER + 1) * (FastMultipoleSolver::MAX_ORDER + 1);
+
+	// Offsets between a cell and the cells of its interaction list, in cells of the same level.
+	constexpr size_t TRANSFER_OFFSETS = 7 * 7 * 7;
+
+	size_t Transfer(int const dx, int const dy, int const dz)
+	{
+		return static_cast<size_t>(((dz + 3) * 7 + dy + 3) * 7 + dx + 3);
+	}
+
+	double Milliseconds(std::chrono::high_resolution_clock::time_point const start)
+	{
+		return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+	}
+
+	uint64_t Spread(uint64_t v)
+	{
+		v &= 0x1fffff;
+		v = (v | v << 32) & 0x1f00000000ffff;
+		v = (v | v << 16) & 0x1f0000ff0000ff;
+		v = (v | v << 8) & 0x100f00f00f00f00f;
+		v = (v | v << 4) & 0x10c30c30c30c30c3;
+		v = (v | v << 2) & 0x1249249249249249;
+		return v;
+	}
+
+	int64_t Compact(uint64_t v)
+	{
+		v &= 0x1249249249249249;
+		v = (v ^ v >> 2) & 0x10c30c30c30c30c3;
+		v = (v ^ v >> 4) & 0x100f00f00f00f00f;
+		v = (v ^ v >> 8) & 0x1f0000ff0000ff;
+		v = (v ^ v >> 16) & 0x1f00000000ffff;
+		v = (v ^ v >> 32) & 0x1fffff;
+		return static_cast<int64_t>(v);
+	}
+
+	uint64_t Encode(uint64_t const x, uint64_t const y, uint64_t const z)
+	{
+		return Spread(x) | Spread(y) << 1 | Spread(z) << 2;
+	}
+
+	template <typename F>
+	void ForEachCell(size_t const count, F const& f)
+	{
+		parallel_for(0, count, CELLS_PER_TASK, f);
+	}
+
+	// The expansions are stored for m >= 0 only, the other half follows from X_n^-m = (-1)^m conj(X_n^m).
+	int Index(int const n, int const m) { return n * (n + 1) / 2 + m; }
+
+	// Index into an expansion unpacked to -n <= m <= n, see Unpack.
+	int FullIndex(int const n, int const m) { return n * (n + 1) + m; }
+
+	void Unpack(const Complex* h, int const order, Complex* full)
+	{
+		for (int n = 0; n <= order; n++)
+		{
+			full[FullIndex(n, 0)] = h[Index(n, 0)];
+			for (int m = 1; m <= n; m++)
+			{
+				const Complex value = h[Index(n, m)];
+				full[FullIndex(n, m)] = value;
+				full[FullIndex(n, -m)] = m & 1 ? -std::conj(value) : std::conj(value);
+			}
+		}
+	}
+
+	// Plain complex product, std::complex multiplication checks for infinities on some compilers.
+	Complex Multiply(Complex const a, Complex const b)
+	{
+		return {a.real() * b.real() - a.imag() * b.imag(), a.real() * b.imag() + a.imag() * b.real()};
+	}
+
+	// a * conj(b)
+	Complex MultiplyConj(Complex const a, Complex const b)
+	{
+		return {a.real() * b.real() + a.imag() * b.imag(), a.imag() * b.real() - a.real() * b.imag()};
+	}
+
+	// Regular solid harmonics R_n^m = r^n P_n^m(cos theta) e^(i m phi) / (n + m)!, without the Condon-Shortley phase.
+	void Regular(double const x, double const y, double const z, int const order, Complex* out)
+	{
+		const double r2 = x * x + y * y + z * z;
+		const Complex w(x, y);
+
+		out[0] = 1;
+		for (int m = 0; m <= order; m++)
+		{
+			if (m > 0)
+				out[Index(m, m)] = Multiply(out[Index(m - 1, m - 1)], w) / (2. * m);
+
+			for (int n = m + 1; n <= order; n++)
+			{
+				Complex value = (2. * n - 1) * z * out[Index(n - 1, m)];
+				if (n - 2 >= m)
+					value -= r2 * out[Index(n - 2, m)];
+				out[Index(n, m)] = value / static_cast<double>((n + m) * (n - m));
+			}
+		}
+	}
+
+	// Irregular solid harmonics I_n^m = (n - m)! P_n^m(cos theta) e^(i m phi) / r^(n + 1). Together with the regular
+	// ones 1 / |x - y| = sum conj(R_n^m(y)) I_n^m(x) for |y| < |x|.
+	void Irregular(double const x, double const y, double const z, int const order, Complex* out)
+	{
+		const double r2 = x * x + y * y + z * z;
+		const double inv2 = 1 / r2;
+		const Complex w(x, y);
+
+		out[0] = sqrt(inv2);
+		for (int m = 0; m <= order; m++)
+		{
+			if (m > 0)
+				out[Index(m, m)] = Multiply(out[Index(m - 1, m - 1)], w) * ((2. * m - 1) * inv2);
+
+			for (int n = m + 1; n <= order; n++)
+			{
+				Complex value = (2. * n - 1) * z * out[Index(n - 1, m)];
+				if (n - 2 >= m)
+					value -= static_cast<double>((n + m - 1) * (n - m - 1)) * out[Index(n - 2, m)];
+				out[Index(n, m)] = value * inv2;
+			}
+		}
+	}
+
+	// Multipole expansion about the child's centre to one about the parent's, d = child - parent.
+	void MultipoleToMultipole(const Complex* child, const double* d, int const order, Complex* parent)
+	{
+		Complex packed[MAX_TERMS], r[FULL_TERMS], m[FULL_TERMS];
+		Regular(d[0], d[1], d[2], order, packed);
+		Unpack(packed, order, r);
+		Unpack(child, order, m);
+
+		for (int n = 0; n <= order; n++)
+			for (int o = 0; o <= n; o++)
+			{
+				Complex sum = 0;
+				for (int k = 0; k <= n; k++)
+					for (int l = std::max(-k, o - n + k); l <= std::min(k, o + n - k); l++)
+						sum += MultiplyConj(m[FullIndex(n - k, o - l)], r[FullIndex(k, l)]);
+				parent[Index(n, o)] += sum;
+			}
+	}
+
+	// Multipole expansion of a source cell to a local expansion about a target cell. Both the multipole and the
+	// irregular harmonics of (target - source) are unpacked.
+	void MultipoleToLocal(const Complex* multipole, const Complex* irregular, int const order, Complex* local)
+	{
+		for (int n = 0; n <= order; n++)
+			for (int o = 0; o <= n; o++)
+			{
+				Complex sum = 0;
+				for (int k = 0; k <= order - n; k++)
+					for (int l = -k; l <= k; l++)
+						sum += Multiply(multipole[FullIndex(k, l)], irregular[FullIndex(n + k, l - o)]);
+				local[Index(n, o)] += (n + o) & 1 ? -sum : sum;
+			}
+	}
+
+	// Local expansion about the parent's centre to one about the child's, d = child - parent.
+	void LocalToLocal(const Complex* parent, const double* d, int const order, Complex* child)
+	{
+		Complex packed[MAX_TERMS], r[FULL_TERMS], p[FULL_TERMS];
+		Regular(d[0], d[1], d[2], order, packed);
+		Unpack(packed, order, r);
+		Unpack(parent, order, p);
+
+		for (int n = 0; n <= order; n++)
+			for (int o = 0; o <= n; o++)
+			{
+				Complex sum = 0;
+				for (int k = 0; k <= order - n; k++)
+					for (int l = -k; l <= k; l++)
+						sum += Multiply(p[FullIndex(n + k, o + l)], r[FullIndex(k, l)]);
+				child[Index(n, o)] += sum;
+			}
+	}
+
+	// Gradient of the local expansion at offset d from its centre, i.e. its first order terms translated to d.
+	void LocalToGradient(const Complex* local, const double* d, int const order, double* gradient)
+	{
+		Complex packed[MAX_TERMS], r[FULL_TERMS], l[FULL_TERMS];
+		Regular(d[0], d[1], d[2], order - 1, packed);
+		Unpack(packed, order - 1, r);
+		Unpack(local, order, l);
+
+		Complex g0 = 0, g1 = 0;
+		for (int k = 0; k < order; k++)
+			for (int o = -k; o <= k; o++)
+			{
+				const Complex rko = r[FullIndex(k, o)];
+				g0 += Multiply(l[FullIndex(k + 1, o)], rko);
+				g1 += Multiply(l[FullIndex(k + 1, o + 1)], rko);
+			}
+
+		gradient[0] = g1.real();
+		gradient[1] = -g1.imag();
+		gradient[2] = g0.real();
+	}
+}
+
+FastMultipoleSolver::FastMultipoleSolver(int const order, uint32_t const leafSize) :
+	m_order(0),
+	m_leafSize(std::max(leafSize, 1u)),
+	m_name()
+{
+	SetOrder(order);
+}
+
+void FastMultipoleSolver::SetOrder(int const order)
+{
+	m_order = std::clamp(order, 1, MAX_ORDER);
+	snprintf(m_name, sizeof m_name, "Fast Multipole (p=%d)", m_order);
+}
+
+void FastMultipoleSolver::Accelerate(GravityBodies const& bodies)
+{
+	m_stats = {};
+
+	auto start = std::chrono::high_resolution_clock::now();
+	Build(bodies);
+	m_stats.buildTime = Milliseconds(start);
+
+	start = std::chrono::high_resolution_clock::now();
+
+	if (!m_index.empty())
+	{
+		Upward();
+		Downward();
+		Evaluate();
+	}
+
+	std::fill(bodies.ax, bodies.ax + bodies.count, 0.);
+	std::fill(bodies.ay, bodies.ay + bodies.count, 0.);
+	std::fill(bodies.az, bodies.az + bodies.count, 0.);
+
+	for (size_t k = 0; k < m_index.size(); k++)
+	{
+		const uint32_t i = m_index[k];
+
+		bodies.ax[i] = m_ax[k] * G_SCREEN;
+		bodies.ay[i] = m_ay[k] * G_SCREEN;
+		bodies.az[i] = m_az[k] * G_SCREEN;
+
+		if (m_collision[k])
+			bodies.collision[i] = 1;
+	}
+
+	m_stats.forceTime = Milliseconds(start);
+
+	for (Level const& level : m_levels)
+		m_stats.nodes += level.cells.size();
+
+	MeasureAccuracy();
+}
+
+void FastMultipoleSolver::Build(GravityBodies const& bodies)
+{
+	double lower[3] = {INFINITY, INFINITY, INFINITY};
+	double upper[3] = {-INFINITY, -INFINITY, -INFINITY};
+
+	// Massless bodies neither attract nor get attracted in the shader, so they stay out of the tree.
+	m_scratch.clear();
+	for (uint32_t i = 0; i < bodies.count; i++)
+	{
+		if (bodies.mass[i] == 0)
+			continue;
+
+		const double p[3] = {bodies.x[i], bodies.y[i], bodies.z[i]};
+		for (int axis = 0; axis < 3; axis++)
+		{
+			lower[axis] = std::min(lower[axis], p[axis]);
+			upper[axis] = std::max(upper[axis], p[axis]);
+		}
+
+		m_scratch.emplace_back(0, i);
+	}
+
+	m_levels.clear();
+	m_oversized.clear();
+	m_index.clear();
+
+	const size_t count = m_scratch.size();
+	if (count == 0)
+		return;
+
+	m_size = std::max({upper[0] - lower[0], upper[1] - lower[1], upper[2] - lower[2]});
+	m_size = m_size > 0 ? m_size * (1 + 1e-9) : 1;
+	std::copy(lower, lower + 3, m_origin);
+
+	const double scale = (1u << KEY_BITS) / m_size;
+	const uint64_t last = (1u << KEY_BITS) - 1;
+	for (auto& [key, i] : m_scratch)
+	{
+		const auto x = std::min(static_cast<uint64_t>((bodies.x[i] - m_origin[0]) * scale), last);
+		const auto y = std::min(static_cast<uint64_t>((bodies.y[i] - m_origin[1]) * scale), last);
+		const auto z = std::min(static_cast<uint64_t>((bodies.z[i] - m_origin[2]) * scale), last);
+		key = Encode(x, y, z);
+	}
+
+	std::sort(m_scratch.begin(), m_scratch.end());
+
+	m_keys.resize(count);
+	m_index.resize(count);
+	for (auto* values : {&m_x, &m_y, &m_z, &m_mass, &m_radius, &m_ax, &m_ay, &m_az})
+		values->assign(count, 0.);
+	m_collision.assign(count, 0);
+
+	for (size_t k = 0; k < count; k++)
+	{
+		const uint32_t i = m_scratch[k].second;
+
+		m_keys[k] = m_scratch[k].first;
+		m_index[k] = i;
+		m_x[k] = bodies.x[i];
+		m_y[k] = bodies.y[i];
+		m_z[k] = bodies.z[i];
+		m_mass[k] = bodies.mass[i];
+		m_radius[k] = static_cast<double>(bodies.radius[i]) * S_NORM_INV;
+	}
+
+	// The shallowest level whose occupied cells hold no more than m_leafSize bodies on average becomes the leaf level.
+	uint32_t depth = 0;
+	while (depth < MAX_LEVEL)
+	{
+		const uint32_t shift = 3 * (KEY_BITS - depth);
+		size_t cells = 1;
+		for (size_t k = 1; k < count; k++)
+			cells += (m_keys[k] >> shift) != (m_keys[k - 1] >> shift);
+
+		if (count <= cells * m_leafSize)
+			break;
+		depth++;
+	}
+
+	m_levels.resize(depth + 1);
+
+	const size_t terms = Terms(m_order);
+	for (uint32_t level = depth + 1; level-- > 0;)
+	{
+		const uint32_t shift = 3 * (KEY_BITS - level);
+		std::vector<Cell>& cells = m_levels[level].cells;
+
+		// Leaves group the bodies, every other level groups the cells of the level below.
+		const bool leaf = level == depth;
+		const size_t items = leaf ? count : m_levels[level + 1].cells.size();
+
+		for (size_t k = 0; k < items; k++)
+		{
+			const uint64_t key = leaf ? m_keys[k] >> shift : m_levels[level + 1].cells[k].key >> 3;
+			if (cells.empty() || cells.back().key != key)
+				cells.push_back({key, static_cast<uint32_t>(k), 0, 0, {}});
+			cells.back().count++;
+
+			if (!leaf)
+				m_levels[level + 1].cells[k].parent = static_cast<uint32_t>(cells.size() - 1);
+		}
+
+		const double width = m_size / static_cast<double>(1u << level);
+		for (Cell& cell : cells)
+		{
+			cell.center[0] = m_origin[0] + (static_cast<double>(Compact(cell.key)) + .5) * width;
+			cell.center[1] = m_origin[1] + (static_cast<double>(Compact(cell.key >> 1)) + .5) * width;
+			cell.center[2] = m_origin[2] + (static_cast<double>(Compact(cell.key >> 2)) + .5) * width;
+		}
+
+		m_levels[level].multipole.assign(cells.size() * terms, 0.);
+		m_levels[level].local.assign(cells.size() * terms, 0.);
+	}
+
+	// Bodies that overlap only bodies in adjacent leaves are caught by the near field, larger ones are checked against
+	// every body separately.
+	const double leafWidth = m_size / static_cast<double>(1u << depth);
+	for (uint32_t k = 0; k < count; k++)
+		if (2 * m_radius[k] > leafWidth)
+			m_oversized.push_back(k);
+}
+
+void FastMultipoleSolver::Upward()
+{
+	const size_t terms = Terms(m_order);
+	const auto depth = static_cast<uint32_t>(m_levels.size() - 1);
+
+	Level& leaves = m_levels[depth];
+	ForEachCell(leaves.cells.size(), [&](size_t const index)
+	{
+		Cell const& cell = leaves.cells[index];
+		Complex* multipole = &leaves.multipole[index * terms];
+		Complex r[MAX_TERMS];
+
+		for (uint32_t k = cell.first; k < cell.first + cell.count; k++)
+		{
+			Regular(m_x[k] - cell.center[0], m_y[k] - cell.center[1], m_z[k] - cell.center[2], m_order, r);
+			for (size_t t = 0; t < terms; t++)
+				multipole[t] += m_mass[k] * std::conj(r[t]);
+		}
+	});
+
+	for (uint32_t level = depth; level-- > 0;)
+	{
+		Level& parents = m_levels[level];
+		Level const& children = m_levels[level + 1];
+
+		ForEachCell(parents.cells.size(), [&](size_t const index)
+		{
+			Cell const& cell = parents.cells[index];
+			for (uint32_t child = cell.first; child < cell.first + cell.count; child++)
+			{
+				const double* center = children.cells[child].center;
+				const double d[3] = {center[0] - cell.center[0], center[1] - cell.center[1], center[2] - cell.center[2]};
+				MultipoleToMultipole(&children.multipole[child * terms], d, m_order, &parents.multipole[index * terms]);
+			}
+		});
+	}
+}
+
+void FastMultipoleSolver::Downward()
+{
+	const size_t terms = Terms(m_order);
+	const size_t fullTerms = static_cast<size_t>(m_order + 1) * (m_order + 1);
+	std::atomic<uint64_t> interactions{0};
+
+	// Cells on levels 0 and 1 are all adjacent to each other, so the far field starts at level 2.
+	for (uint32_t level = 2; level < m_levels.size(); level++)
+	{
+		Level& target = m_levels[level];
+		Level const& parents = m_levels[level - 1];
+
+		// Interacting cells of one level are at most three cells apart on every axis, so the irregular harmonics of
+		// the offsets between them are shared by all cells of the level.
+		const double width = m_size / static_cast<double>(1u << level);
+		Complex packed[MAX_TERMS];
+		m_transfer.resize(TRANSFER_OFFSETS * fullTerms);
+		for (int dz = -3; dz <= 3; dz++)
+			for (int dy = -3; dy <= 3; dy++)
+				for (int dx = -3; dx <= 3; dx++)
+				{
+					if (std::abs(dx) <= 1 && std::abs(dy) <= 1 && std::abs(dz) <= 1)
+						continue;
+
+					Irregular(dx * width, dy * width, dz * width, m_order, packed);
+					Unpack(packed, m_order, &m_transfer[Transfer(dx, dy, dz) * fullTerms]);
+				}
+
+		m_unpacked.resize(target.cells.size() * fullTerms);
+		ForEachCell(target.cells.size(), [&](size_t const index)
+		{
+			Unpack(&target.multipole[index * terms], m_order, &m_unpacked[index * fullTerms]);
+		});
+
+		ForEachCell(target.cells.size(), [&](size_t const index)
+		{
+			Cell const& cell = target.cells[index];
+			Cell const& parent = parents.cells[cell.parent];
+			Complex* local = &target.local[index * terms];
+
+			const double d[3] = {
+				cell.center[0] - parent.center[0], cell.center[1] - parent.center[1], cell.center[2] - parent.center[2]
+			};
+			LocalToLocal(&parents.local[cell.parent * terms], d, m_order, local);
+
+			const int64_t x = Compact(cell.key), y = Compact(cell.key >> 1), z = Compact(cell.key >> 2);
+			const int64_t px = x >> 1, py = y >> 1, pz = z >> 1;
+
+			// Interaction list: children of the parent's neighbours that are not neighbours themselves.
+			uint64_t count = 0;
+			for (int64_t nz = pz - 1; nz <= pz + 1; nz++)
+				for (int64_t ny = py - 1; ny <= py + 1; ny++)
+					for (int64_t nx = px - 1; nx <= px + 1; nx++)
+					{
+						const int64_t neighbour = Find(level - 1, nx, ny, nz);
+						if (neighbour < 0)
+							continue;
+
+						Cell const& n = parents.cells[neighbour];
+						for (uint32_t s = n.first; s < n.first + n.count; s++)
+						{
+							const uint64_t key = target.cells[s].key;
+							const auto dx = static_cast<int>(x - Compact(key));
+							const auto dy = static_cast<int>(y - Compact(key >> 1));
+							const auto dz = static_cast<int>(z - Compact(key >> 2));
+							if (std::abs(dx) <= 1 && std::abs(dy) <= 1 && std::abs(dz) <= 1)
+								continue;
+
+							MultipoleToLocal(&m_unpacked[s * fullTerms], &m_transfer[Transfer(dx, dy, dz) * fullTerms],
+							                 m_order, local);
+							count++;
+						}
+					}
+
+			interactions.fetch_add(count, std::memory_order_relaxed);
+		});
+	}
+
+	m_stats.interactions += interactions.load();
+}
+
+void FastMultipoleSolver::Evaluate()
+{
+	const size_t terms = Terms(m_order);
+	const auto depth = static_cast<uint32_t>(m_levels.size() - 1);
+	Level const& leaves = m_levels[depth];
+	std::atomic<uint64_t> interactions{0};
+
+	ForEachCell(leaves.cells.size(), [&](size_t const index)
+	{
+		Cell const& cell = leaves.cells[index];
+		const Complex* local = &leaves.local[index * terms];
+		const int64_t x = Compact(cell.key), y = Compact(cell.key >> 1), z = Compact(cell.key >> 2);
+
+		for (uint32_t i = cell.first; i < cell.first + cell.count; i++)
+		{
+			const double d[3] = {m_x[i] - cell.center[0], m_y[i] - cell.center[1], m_z[i] - cell.center[2]};
+			double gradient[3];
+			LocalToGradient(local, d, m_order, gradient);
+
+			m_ax[i] = gradient[0];
+			m_ay[i] = gradient[1];
+			m_az[i] = gradient[2];
+		}
+
+		uint64_t count = 0;
+		for (int64_t nz = z - 1; nz <= z + 1; nz++)
+			for (int64_t ny = y - 1; ny <= y + 1; ny++)
+				for (int64_t nx = x - 1; nx <= x + 1; nx++)
+				{
+					const int64_t neighbour = Find(depth, nx, ny, nz);
+					if (neighbour < 0)
+						continue;
+
+					Cell const& source = leaves.cells[neighbour];
+					count += static_cast<uint64_t>(cell.count) * source.count;
+
+					for (uint32_t i = cell.first; i < cell.first + cell.count; i++)
+					{
+						const double xi = m_x[i], yi = m_y[i], zi = m_z[i], ri = m_radius[i];
+						double ax = 0, ay = 0, az = 0;
+
+						for (uint32_t j = source.first; j < source.first + source.count; j++)
+						{
+							const double dx = m_x[j] - xi;
+							const double dy = m_y[j] - yi;
+							const double dz = m_z[j] - zi;
+							const double r2 = dx * dx + dy * dy + dz * dz;
+
+							const double reach = ri + m_radius[j];
+							if (r2 <= reach * reach && i != j)
+								m_collision[i] = 1;
+
+							if (r2 > 0)
+							{
+								const double inv = 1 / sqrt(r2);
+								const double s = m_mass[j] * inv * inv * inv;
+								ax += dx * s;
+								ay += dy * s;
+								az += dz * s;
+							}
+						}
+
+						m_ax[i] += ax;
+						m_ay[i] += ay;
+						m_az[i] += az;
+					}
+				}
+
+		interactions.fetch_add(count, std::memory_order_relaxed);
+	});
+
+	m_stats.interactions += interactions.load();
+
+	for (uint32_t o : m_oversized)
+		for (uint32_t j = 0; j < m_index.size(); j++)
+		{
+			const double dx = m_x[j] - m_x[o];
+			const double dy = m_y[j] - m_y[o];
+			const double dz = m_z[j] - m_z[o];
+			const double reach = m_radius[o] + m_radius[j];
+
+			if (j != o && dx * dx + dy * dy + dz * dz <= reach * reach)
+				m_collision[o] = m_collision[j] = 1;
+		}
+}
+
+void FastMultipoleSolver::MeasureAccuracy()
+{
+	const size_t count = m_index.size();
+	const size_t samples = std::min(m_samples, count);
+	if (samples == 0)
+		return;
+
+	double error = 0, norm = 0;
+	for (size_t s = 0; s < samples; s++)
+	{
+		const size_t i = (m_sampleOffset + s * count / samples) % count;
+		double exact[3] = {};
+
+		for (size_t j = 0; j < count; j++)
+		{
+			const double dx = m_x[j] - m_x[i];
+			const double dy = m_y[j] - m_y[i];
+			const double dz = m_z[j] - m_z[i];
+			const double r2 = dx * dx + dy * dy + dz * dz;
+
+			if (r2 > 0)
+			{
+				const double inv = 1 / sqrt(r2);
+				const double f = m_mass[j] * inv * inv * inv;
+				exact[0] += dx * f;
+				exact[1] += dy * f;
+				exact[2] += dz * f;
+			}
+		}
+
+		const double e[3] = {m_ax[i] - exact[0], m_ay[i] - exact[1], m_az[i] - exact[2]};
+		error += e[0] * e[0] + e[1] * e[1] + e[2] * e[2];
+		norm += exact[0] * exact[0] + exact[1] * exact[1] + exact[2] * exact[2];
+	}
+
+	m_sampleOffset = (m_sampleOffset + 7919) % count;
+	m_stats.error = norm > 0 ? sqrt(error / norm) : 0;
+}
+
+int64_t FastMultipoleSolver::Find(uint32_t const level, int64_t const x, int64_t const y, int64_t const z) const
+{
+	const int64_t side = int64_t(1) << level;
+	if (x < 0 || y < 0 || z < 0 || x >= side || y >= side || z >= side)
+		return -1;
+
+	const uint64_t key = Encode(x, y, z);
+	std::vector<Cell> const& cells = m_levels[level].cells;
+
+	const auto it = std::lower_bound(cells.begin(), cells.end(), key, [](Cell const& cell, uint64_t const value)
+	{
+		return cell.key < value;
+	});
+
+	return it != cells.end() && it->key == key ? it - cells.begin() : -1;
+}
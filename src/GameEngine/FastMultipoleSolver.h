@@ -0,0 +1,77 @@
+#pragma once
+
+#include "GravitySolver.h"
+
+#include <complex>
+#include <utility>
+#include <vector>
+
+// Fast multipole method on a sparse uniform octree. The bodies are sorted along a Morton curve and binned into the
+// leaves of the deepest level, which is chosen from the body count and the leaf size. Multipole expansions of the
+// configured order are formed at the leaves (P2M) and translated up the tree (M2M), converted into local expansions
+// between well separated cells of the same level (M2L), pushed down the tree (L2L) and evaluated at the bodies (L2P).
+// Bodies in adjacent leaves interact directly (P2P). Every pass runs in parallel over the cells of one level and the
+// work per pass is O(N) for a fixed order.
+class FastMultipoleSolver final : public GravitySolver
+{
+public:
+	explicit FastMultipoleSolver(int order = 4, uint32_t leafSize = 64);
+
+	void Accelerate(GravityBodies const& bodies) override;
+	[[nodiscard]] const char* Name() const override { return m_name; }
+
+	void SetOrder(int order);
+	[[nodiscard]] int GetOrder() const { return m_order; }
+
+	// Number of bodies per pass whose acceleration is compared with direct summation, the relative rms error ends up
+	// in GravityStats::error. The sample moves through the bodies from pass to pass.
+	void SetAccuracySamples(size_t const samples) { m_samples = samples; }
+	[[nodiscard]] size_t GetAccuracySamples() const { return m_samples; }
+
+	static constexpr int MAX_ORDER = 16;
+
+private:
+	struct Cell
+	{
+		uint64_t key; // Morton key relative to the level
+		uint32_t first; // first child in the next level, or first body at the leaf level
+		uint32_t count;
+		uint32_t parent;
+		double center[3];
+	};
+
+	struct Level
+	{
+		std::vector<Cell> cells;
+		std::vector<std::complex<double>> multipole;
+		std::vector<std::complex<double>> local;
+	};
+
+	void Build(GravityBodies const& bodies);
+	void Upward();
+	void Downward();
+	void Evaluate();
+	void MeasureAccuracy();
+	[[nodiscard]] int64_t Find(uint32_t level, int64_t x, int64_t y, int64_t z) const;
+
+	int m_order;
+	uint32_t m_leafSize;
+	size_t m_samples = 16;
+	size_t m_sampleOffset = 0;
+	char m_name[32];
+
+	double m_origin[3] = {};
+	double m_size = 0;
+	std::vector<Level> m_levels;
+	std::vector<uint32_t> m_oversized; // bodies too large for the leaves to catch all of their collisions
+	std::vector<std::complex<double>> m_transfer; // unpacked irregular harmonics per cell offset of the current level
+	std::vector<std::complex<double>> m_unpacked; // unpacked multipoles of the current level
+
+	// Live bodies only, in Morton order.
+	std::vector<uint64_t> m_keys;
+	std::vector<uint32_t> m_index;
+	std::vector<double> m_x, m_y, m_z, m_mass, m_radius;
+	std::vector<double> m_ax, m_ay, m_az;
+	std::vector<uint8_t> m_collision;
+	std::vector<std::pair<uint64_t, uint32_t>> m_scratch;
+};
@@ -0,0 +1,61 @@
+#include "Fft.h"
+#include "PhysicalConstants.h"
+
+#include <cmath>
+#include <stdexcept>
+#include <utility>
+
+Fft::Fft(size_t const size) :
+	m_size(size),
+	m_reverse(size),
+	m_twiddles(size / 2)
+{
+	if (size == 0 || (size & (size - 1)) != 0)
+		throw std::invalid_argument("FFT size must be a power of two");
+
+	uint32_t bits = 0;
+	while (size_t(1) << bits < size)
+		bits++;
+
+	for (size_t i = 0; i < size; i++)
+	{
+		uint32_t reversed = 0;
+		for (uint32_t b = 0; b < bits; b++)
+			reversed |= ((i >> b) & 1) << (bits - 1 - b);
+		m_reverse[i] = reversed;
+	}
+
+	const double step = -2 * PI / static_cast<double>(size);
+	for (size_t k = 0; k < size / 2; k++)
+		m_twiddles[k] = std::polar(1., step * static_cast<double>(k));
+}
+
+void Fft::Transform(std::complex<double>* data, bool const inverse) const
+{
+	for (size_t i = 0; i < m_size; i++)
+		if (i < m_reverse[i])
+			std::swap(data[i], data[m_reverse[i]]);
+
+	const double sign = inverse ? -1 : 1;
+
+	for (size_t length = 2; length <= m_size; length <<= 1)
+	{
+		const size_t half = length / 2;
+		const size_t step = m_size / length;
+
+		for (size_t block = 0; block < m_size; block += length)
+			for (size_t j = 0; j < half; j++)
+			{
+				const std::complex<double> w = m_twiddles[j * step];
+				const double wr = w.real(), wi = w.imag() * sign;
+
+				std::complex<double>& a = data[block + j];
+				std::complex<double>& b = data[block + j + half];
+
+				// Written out, std::complex multiplication checks for infinities on some compilers.
+				const std::complex<double> t(b.real() * wr - b.imag() * wi, b.real() * wi + b.imag() * wr);
+				b = a - t;
+				a += t;
+			}
+	}
+}
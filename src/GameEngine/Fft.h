@@ -0,0 +1,24 @@
+#pragma once
+
+#include <complex>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Iterative radix-2 fast Fourier transform of a fixed power of two size. Twiddle factors and the bit reversal
+// permutation are computed once on construction. The inverse transform is not normalised.
+class Fft
+{
+public:
+	explicit Fft(size_t size = 1);
+
+	[[nodiscard]] size_t Size() const { return m_size; }
+
+	// Transforms Size() contiguous values in place.
+	void Transform(std::complex<double>* data, bool inverse) const;
+
+private:
+	size_t m_size;
+	std::vector<uint32_t> m_reverse;
+	std::vector<std::complex<double>> m_twiddles;
+};
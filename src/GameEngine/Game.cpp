@@ -7,6 +7,8 @@
 #include "Constants.h"
 #include "Globals.h"
 #include "Game.h"
+#include "SolarSystem.h"
+#include "ThreadPool.h"
 
 #include <memory>
 #include <array>
@@ -118,8 +120,12 @@ void Game::Update(DX::StepTimer const& timer)
 	const bool keyComma = m_keyboardButtons.IsKeyPressed(m_keyboard->OemComma);
 	const bool keyTab = m_keyboardButtons.IsKeyPressed(m_keyboard->Tab);
 	const bool keyEscape = m_keyboardButtons.IsKeyPressed(m_keyboard->Escape);
+	const bool keyB = m_keyboardButtons.IsKeyPressed(m_keyboard->B);
 	const bool keyC = m_keyboardButtons.IsKeyPressed(m_keyboard->C);
+	const bool keyG = m_keyboardButtons.IsKeyPressed(m_keyboard->G);
+	const bool keyI = m_keyboardButtons.IsKeyPressed(m_keyboard->I);
 	const bool keyO = m_keyboardButtons.IsKeyPressed(m_keyboard->O);
+	const bool keyT = m_keyboardButtons.IsKeyPressed(m_keyboard->T);
 	const bool key0 = m_keyboardButtons.IsKeyPressed(m_keyboard->D0);
 	const bool key1 = m_keyboardButtons.IsKeyPressed(m_keyboard->D1);
 	const bool key2 = m_keyboardButtons.IsKeyPressed(m_keyboard->D2);
@@ -131,6 +137,31 @@ void Game::Update(DX::StepTimer const& timer)
 	if (keySpace)
 		m_show_grid = !m_show_grid;
 
+	if (keyG)
+	{
+		const int next = (static_cast<int>(g_gravityMethod) + 1) % static_cast<int>(GravityMethod::Count);
+		g_gravityMethod = static_cast<GravityMethod>(next);
+	}
+
+	if (keyI)
+	{
+		const int next = (static_cast<int>(g_integrator) + 1) % static_cast<int>(IntegratorMethod::Count);
+		g_integrator = static_cast<IntegratorMethod>(next);
+	}
+
+	if (keyT)
+	{
+		// Cycle 1, 2, 4, 8 and 16 threads to compare the scaling of the simulation stages.
+		const size_t threads = g_threadPool.Size() >= 16 ? 1 : g_threadPool.Size() * 2;
+		g_threadPool.Resize(threads);
+	}
+
+	if (keyB)
+	{
+		// Cycle the density profile budget from a quarter of the default up to PROFILE_BUDGET_MAX.
+		g_profileBudget = g_profileBudget >= PROFILE_BUDGET_MAX ? PROFILE_BUDGET / 4 : g_profileBudget * 2;
+	}
+
 	if (keyO)
 	{
 		g_coreView = !g_coreView;
@@ -167,10 +198,11 @@ void Game::Update(DX::StepTimer const& timer)
 
 	if ((keyTab || keyEscape || keyC) && !g_planets.empty())
 	{
+		// Planets are stepped through from heaviest to lightest.
 		if (keyTab)
 		{
-			const int limit = static_cast<int>(g_planets.size());
-			int current = static_cast<int>(g_current);
+			const int limit = static_cast<int>(g_massOrder.Size());
+			int current = static_cast<int>(g_massOrder.Rank(g_current));
 
 			if (!kb.LeftShift) current++;
 			else current--;
@@ -180,14 +212,14 @@ void Game::Update(DX::StepTimer const& timer)
 			else if (current >= limit)
 				current %= limit;
 
-			g_current = current;
+			g_current = g_massOrder[current];
 		}
 		else if (keyC)
 		{
-			for (unsigned int i = g_current; i < g_planets.size(); i++)
+			for (size_t rank = g_massOrder.Rank(g_current); rank < g_massOrder.Size(); rank++)
 			{
-				const Composition<float>& composition = g_compositions[g_planets[i].id];
-				if (composition.Hydrogen < static_cast<float>(EPSILON) && g_planets[i].id != g_planets[g_current].id)
+				const unsigned int i = g_massOrder[rank];
+				if (g_compositions.Element(g_planets[i].id, 0) < static_cast<float>(EPSILON) && g_planets[i].id != g_planets[g_current].id)
 				{
 					g_current = i;
 					break;
@@ -199,7 +231,7 @@ void Game::Update(DX::StepTimer const& timer)
 				//}
 			}
 		}
-		else g_current = 0;
+		else g_current = g_massOrder[0];
 	}
 
 	if (g_planets[g_current].id != planet.id)
@@ -290,75 +322,25 @@ void Game::CreateSolarSystem() const
 {
 	const UINT noOfPlanets = 400;
 
-	double totalMass = 0;
-	std::vector<double> masses;
-	for (UINT i = 0; i < noOfPlanets; i++)
-	{
-		double mass;
-		if (rand(0., 1.) < .9)
-			mass = rand(MOON_MASS * .001, EARTH_MASS * 10);
-		else
-			mass = rand(EARTH_MASS * 10, EARTH_MASS * 100.);
-
-		totalMass += mass;
-		masses.push_back(mass);
-	}
-
-	const double sunMass = SYSTEM_MASS;
-	const double sunCoreDensity = 150000;
-	const double sunCoreTemperature = 15000000;
-	//const double sunVelocity = 150000;
-	//Vector3 direction, position;
+	SolarSystem system(g_seed);
 
-	Planet const& star = CreatePlanet(sunMass, sunCoreDensity, sunCoreTemperature, Vector3::Zero, Vector3::Zero, 0);
+	const BodySeed sun = SolarSystem::Star();
+	Planet const& star = CreatePlanet(sun.mass, sun.density, sun.temperature, Vector3::Zero, Vector3::Zero, 0);
 	auto const starRadius = static_cast<double>(star.radius);
-	//CreatePlanet(JUPITER_MASS, Vector3::Left * JUPITER_SUN_DIST, Vector3::Forward, JUPITER_SUN_VELOCITY);
-	//CreatePlanet(EARTH_MASS, Vector3::Left * EARTH_SUN_DIST, Vector3::Forward, EARTH_SUN_VELOCITY);
-
-	//position = Vector3::Left * SUN_DIAMETER * .8;
-	//(-position).Normalize(direction);
-	//direction = Vector3(-direction.z, 0, direction.x);
-	//sunCoreDensity = sqrt(sqrt(sunMass * .5) / rand(6e5, 7e5));
-	//CreatePlanet(sunMass * .5, sunCoreDensity, sunCoreTemperature, position, direction, sunVelocity);
-	//
-	//position = Vector3::Right * SUN_DIAMETER * .8;
-	//(-position).Normalize(direction);
-	//direction = Vector3(-direction.z, 0, direction.x);
-	//sunCoreDensity = sqrt(sqrt(sunMass * .3) / rand(6e5, 7e5));
-	//CreatePlanet(sunMass * .3, sunCoreDensity, sunCoreTemperature, position, direction, sunVelocity);
-
-	const double maxDistance = starRadius * 20.;
 
-	for (UINT i = 0; i < noOfPlanets; i++)
+	for (BodySeed const& planet : system.Planets(noOfPlanets, starRadius))
 	{
-		const double mass = masses[i];
-		const double density = sqrt(sqrt(mass) / (mass > 5e25 ? rand(6e5, 7e5) : rand(1e5, 2e5)));
-		const double temperature = 1;
-		const double velocity = rand(EARTH_SUN_VELOCITY * .01, EARTH_SUN_VELOCITY * 10.);
-
-		double const boundary = starRadius * 1.5;
-		Vector3 position;
-		bool isOutsideBoundery = false;
-		while (!isOutsideBoundery)
-		{
-			double const rotation = rand(0., 2. * PI);
-			double distance = rand(-maxDistance, maxDistance);
-
-			position = XMVector3Transform(randv(-1, 1), XMMatrixRotationAxis(Vector3::UnitY,
-			                                                                 static_cast<float>(rotation))) * distance;
-			position.y = static_cast<float>(rand(-starRadius, starRadius));
+		const Vector3 position(static_cast<float>(planet.position[0]), static_cast<float>(planet.position[1]),
+		                       static_cast<float>(planet.position[2]));
+		const Vector3 direction(static_cast<float>(planet.direction[0]), static_cast<float>(planet.direction[1]),
+		                        static_cast<float>(planet.direction[2]));
 
-			distance = sqrt(pow(position.x, 2) + pow(position.y, 2) + pow(position.z, 2));
-			isOutsideBoundery = distance > boundary;
-		}
-
-		Vector3 direction;
-		(-position).Normalize(direction);
-		direction = Vector3(-direction.z, direction.y, direction.x);
-		direction.y = rand(-.05f, .05f);
-
-		CreatePlanet(mass, density, temperature, position, direction, static_cast<float>(velocity));
+		CreatePlanet(planet.mass, planet.density, planet.temperature, position, direction,
+		             static_cast<float>(planet.velocity));
 	}
+
+	// Rank the new bodies now, the renderer reads the heaviest before the first frame's cleanup.
+	g_massOrder.Update(std::vector<uint8_t>(g_planets.size()), [](size_t const i) { return g_planets[i].mass; });
 }
 
 Planet const& Game::CreatePlanet(double mass, double density, double temperature, Vector3 position, Vector3 direction,
@@ -366,12 +348,15 @@ Planet const& Game::CreatePlanet(double mass, double density, double temperature
 {
 	Planet& p = g_planets.emplace_back(mass, density, temperature, position * static_cast<float>(S_NORM_INV), direction,
 	                                   velocity * static_cast<float>(S_NORM_INV));
+	g_handles.Place(p.id, static_cast<uint32_t>(g_planets.size() - 1));
 
-	g_compositions[p.id] = {};
-	g_compositions[p.id].Randomize(p);
+	Composition<float> composition = {};
+	composition.Randomize(p);
 
 	//if (mass < SUN_MASS / 4.)
-	//    g_compositions[p.id].Degenerate(p);
+	//    composition.Degenerate(p);
+
+	g_compositions.Set(p.id, composition);
 
 	auto newRadius = p.RadiusByDensity();
 	if (newRadius.has_value())
@@ -383,11 +368,9 @@ Planet const& Game::CreatePlanet(double mass, double density, double temperature
 		p.mass = static_cast<float>(newMass.value());
 	else p.mass = 0;
 
-	std::vector<DepthInfo> profile = g_profiles[p.id];
-
-	const size_t nLayers = profile.size();
-	const Composition<double> composition = profile[nLayers - 1].composition;
-	p.material.color = composition.GetColor();
+	ProfileLayers const profile = g_profiles.Find(p.id);
+	if (!profile.Empty())
+		p.material.color = LayerComposition(profile, profile.count - 1).GetColor();
 
 	return p;
 }
@@ -455,14 +438,14 @@ void Game::RenderMain() const
 void Game::RenderInterface() const
 {
 	Planet const planet = g_planets[g_current];
-	Composition<float> composition = g_compositions[planet.id];
+	Composition<float> composition = g_compositions.Get(planet.id);
 	composition /= composition.sum();
 
 	const RECT windowSize = g_device_resources->GetOutputSize();
 	const auto windowWidth = static_cast<float>(windowSize.right - windowSize.left);
 	const auto windowHeight = static_cast<float>(windowSize.bottom - windowSize.top);
 
-	char text[500] = {};
+	char text[1000] = {};
 
 	const double velocity = sqrt(
 		pow(static_cast<double>(planet.velocity.x), 2) + pow(static_cast<double>(planet.velocity.y), 2) + pow(
@@ -472,8 +455,18 @@ void Game::RenderInterface() const
 			static_cast<double>(planet.position.z), 2)) * S_NORM;
 	distance /= EARTH_SUN_DIST;
 
+	GravitySolver const* solver = m_planetRenderer->GetGravitySolver();
+	const char* gravity = solver != nullptr ? solver->Name() : "Shader";
+	const double gravityTime = solver != nullptr ? solver->Stats().buildTime + solver->Stats().forceTime : 0;
+	const double gravityRate = solver != nullptr ? solver->Stats().gflops : 0;
+	const double gravityError = solver != nullptr ? solver->Stats().error : 0;
+	BroadphaseStats const& broadphase = m_planetRenderer->GetBroadphase().Stats();
+	CollisionStats const& merges = m_planetRenderer->GetResolver().Stats();
+	Integrator const& integrator = m_planetRenderer->GetIntegrator();
+	ProfileScheduler const& scheduler = m_planetRenderer->GetScheduler();
+
 	sprintf_s(text,
-	          "No. of Planets:  %u\nSpeed:  %u\nTotal Collisions: %u\nCollisions: %u\nRadius: %g km\nMass: %g kg/m3\nVelocity: %g m/s\nDistance: %g AU\nDelta Time: %g\nTotal Time: %g",
+	          "No. of Planets:  %u\nSpeed:  %u\nTotal Collisions: %u\nCollisions: %u\nRadius: %g km\nMass: %g kg/m3\nVelocity: %g m/s\nDistance: %g AU\nDelta Time: %g\nTotal Time: %g\nGravity: %s (%g ms, %g GFLOP/s, error %.1e)\nIntegrator: %s (%llu bodies evaluated, shortest step 1/%u frame, energy error %.1e)\nBroadphase: %zu pairs, %llu tests, %g ms\nMerges: %zu bodies into %zu (%g ms)\nQuadrants: %zu cells (buffer %zu)\nProfiles: %zu bodies (%g of %g us)\nThreads: %u (%s %.2f, %s %.2f, %s %.2f, %s %.2f, %s %.2f, %s %.2f, %s %.2f, %s %.2f ms)",
 	          static_cast<int>(g_planets.size()),
 	          static_cast<int>(g_speed),
 	          static_cast<int>(g_collisions),
@@ -483,7 +476,35 @@ void Game::RenderInterface() const
 	          velocity,
 	          distance,
 	          static_cast<double>(m_timer_elapsed),
-	          static_cast<double>(m_elapsed) * (1 / 86400.)
+	          static_cast<double>(m_elapsed) * (1 / 86400.),
+	          gravity,
+	          gravityTime,
+	          gravityRate,
+	          gravityError,
+	          solver != nullptr ? integrator.Name() : "Shader",
+	          static_cast<unsigned long long>(integrator.Stats().bodyEvaluations),
+	          1u << integrator.Stats().deepestLevel,
+	          integrator.Stats().energyError,
+	          broadphase.pairs,
+	          static_cast<unsigned long long>(broadphase.candidates),
+	          broadphase.time,
+	          merges.absorbed,
+	          merges.clusters,
+	          merges.time,
+	          m_planetRenderer->GetQuadrants().Cells().size(),
+	          m_planetRenderer->GetQuadrantCapacity(),
+	          scheduler.Scheduled(),
+	          scheduler.Elapsed(),
+	          scheduler.Budget(),
+	          static_cast<unsigned int>(g_threadPool.Size()),
+	          GetStageName(Stage::CenterOfMass), g_stageTimes[Stage::CenterOfMass],
+	          GetStageName(Stage::Quadrants), g_stageTimes[Stage::Quadrants],
+	          GetStageName(Stage::Gravity), g_stageTimes[Stage::Gravity],
+	          GetStageName(Stage::Collision), g_stageTimes[Stage::Collision],
+	          GetStageName(Stage::Drift), g_stageTimes[Stage::Drift],
+	          GetStageName(Stage::Clean), g_stageTimes[Stage::Clean],
+	          GetStageName(Stage::Escape), g_stageTimes[Stage::Escape],
+	          GetStageName(Stage::Vertices), g_stageTimes[Stage::Vertices]
 	);
 
 	m_if_main->Print(text, Vector2(10, 10), Left, Colors::Azure);
@@ -725,7 +746,10 @@ void Game::OnDeviceLost()
 	m_graphic_grid.reset();
 	m_if_main.reset();
 	m_if_composition.reset();
+	for (Planet const& planet : g_planets)
+		g_handles.Release(planet.id);
 	g_planets.clear();
+	g_massOrder.Clear();
 
 	m_graphicsMemory.reset();
 }
@@ -5,8 +5,8 @@
 #include "Constants.h"
 #include "Camera.h"
 #include "Globals.h"
+#include "ThreadPool.h"
 
-#include <map>
 #include <vector>
 
 using namespace DirectX::SimpleMath;
@@ -30,12 +30,20 @@ unsigned int g_current = 0;
 unsigned int g_quadrantSize = QUADRANT_SIZE;
 unsigned int g_collisions = 0;
 float g_speed = TIME_DELTA;
+double g_profileBudget = PROFILE_BUDGET;
+GravityMethod g_gravityMethod = GravityMethod::Shader;
+IntegratorMethod g_integrator = IntegratorMethod::Euler;
 bool g_coreView = false;
+uint64_t g_seed = 0;
+uint32_t g_frame = 0;
+StageTimes g_stageTimes{};
 
+BodyHandles g_handles{};
 std::vector<Planet> g_planets{};
-std::map<uint32_t, Composition<float>> g_compositions{};
-std::map<uint32_t, std::vector<DepthInfo>> g_profiles{};
-std::map<std::string, std::vector<Planet*>> g_quadrants{};
+MassOrder g_massOrder{};
+CompositionStore g_compositions{};
+ProfileArena g_profiles{Composition<double>::LANES};
+const EscapeEngine g_escape{ELEMENTAL_WEIGHT};
 
 
 std::unique_ptr<Buffers::ConstantBuffer<Buffers::Settings>> g_settings_buffer;
@@ -71,57 +79,59 @@ void UpdateGlobalBuffers()
 	g_mvp_buffer->Write(&mvpBuffer);
 }
 
-unsigned int GetPlanetIndex(const int id)
+// Index of the planet with id in g_planets, 0 if it no longer exists.
+unsigned int GetPlanetIndex(uint32_t const id)
 {
-	for (int i = 0; i < g_planets.size(); i++)
-	{
-		if (g_planets[i].id == id)
-			return i;
-	}
-
-	return 0;
+	const uint32_t position = g_handles.Position(id);
+	return position != BodyHandles::NONE ? position : 0;
 }
 
-Planet& GetPlanet(const unsigned int id)
+Planet* FindPlanet(uint32_t const id)
 {
-	for (auto& g_planet : g_planets)
-	{
-		if (g_planet.id == id)
-			return g_planet;
-	}
-
-	return Planet{};
+	const uint32_t position = g_handles.Position(id);
+	return position != BodyHandles::NONE ? &g_planets[position] : nullptr;
 }
 
 unsigned int CleanPlanets()
 {
+	StageTimer timer(g_stageTimes, Stage::Clean);
+
 	const UINT32 id = g_planets[g_current].id;
 	const double maxDistance = PLUTO_SUN_DIST * S_NORM_INV;
 
-	for (int i = g_planets.size() - 1; i >= 0; i--)
+	std::vector<uint8_t> erase(g_planets.size());
+	parallel_for(0, g_planets.size(), [&](size_t const i)
 	{
 		const Planet& planet = g_planets[i];
-		bool erase = planet.mass == 0 || // ID is zero when destroyed
+		erase[i] = planet.mass == 0 || // ID is zero when destroyed
 			isnan(planet.position.x + planet.position.y + planet.position.z) || // Error value
 			sqrt(pow(planet.position.x, 2) + pow(planet.position.y, 2) + pow(planet.position.z, 2)) >= maxDistance;
+	});
 
-		if (erase) g_planets.erase(g_planets.begin() + i);
+	// Compact in one pass instead of erasing one planet at a time, the survivors keep their order.
+	size_t kept = 0, moved = g_planets.size();
+	for (size_t i = 0; i < g_planets.size(); i++)
+	{
+		if (erase[i])
+		{
+			g_handles.Release(g_planets[i].id);
+			moved = std::min(moved, i);
+			continue;
+		}
+		if (kept != i) g_planets[kept] = g_planets[i];
+		kept++;
 	}
+	g_planets.erase(g_planets.begin() + kept, g_planets.end());
+
+	for (size_t i = moved; i < g_planets.size(); i++)
+		g_handles.Place(g_planets[i].id, static_cast<uint32_t>(i));
+
+	// The bodies are no longer sorted, the order by mass is repaired where masses changed.
+	g_massOrder.Update(erase, [](size_t const i) { return g_planets[i].mass; });
 
-	//auto end = std::remove_if(g_planets.begin(), g_planets.end(),
-	//    [maxDistance](Planet const& planet) {
-	//        return planet.mass == 0 || // ID is zero when destroyed
-	//            isnan(planet.position.x + planet.position.y + planet.position.z) || // Error value
-	//            sqrt(pow(planet.position.x, 2) + pow(planet.position.y, 2) + pow(planet.position.z, 2)) >= maxDistance;
-	//    });
-	//
-	//g_planets.erase(end, g_planets.end());
-
-	std::sort(g_planets.begin(), g_planets.end(),
-	          [](const Planet& planet1, const Planet& planet2)
-	          {
-		          return planet1.mass > planet2.mass;
-	          });
+	// Keep compositions and profiles in body order and free those of the bodies just removed.
+	g_compositions.Align(g_planets, [](const Planet& planet) { return planet.id; });
+	g_profiles.Retain(g_planets, [](const Planet& planet) { return planet.id; });
 
 	const UINT32 idx = GetPlanetIndex(id);
 	return idx;
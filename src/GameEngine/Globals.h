@@ -4,29 +4,43 @@
 #include "Camera.h"
 #include "Buffers.h"
 #include "Planet.h"
+#include "BodyHandles.h"
+#include "GravitySolver.h"
+#include "Integrator.h"
+#include "MassOrder.h"
+#include "CompositionStore.h"
+#include "EscapeEngine.h"
+#include "StageTimer.h"
 
 #include <vector>
-#include <map>
 
 using Microsoft::WRL::ComPtr;
 
 extern const std::unique_ptr<DX::DeviceResources> g_device_resources;
 extern const std::unique_ptr<Camera> g_camera;
 extern const DirectX::SimpleMath::Matrix g_world;
+extern BodyHandles g_handles;
 extern std::vector<Planet> g_planets;
-extern std::map<uint32_t, Composition<float>> g_compositions;
-extern std::map<uint32_t, std::vector<DepthInfo>> g_profiles;
-extern std::map<std::string, std::vector<Planet*>> g_quadrants;
+extern MassOrder g_massOrder;
+extern CompositionStore g_compositions;
+extern ProfileArena g_profiles;
+extern const EscapeEngine g_escape;
 extern unsigned int g_current;
 extern unsigned int g_quadrantSize;
 extern unsigned int g_collisions;
 extern std::unique_ptr<Buffers::ConstantBuffer<Buffers::Settings>> g_settings_buffer;
 extern std::unique_ptr<Buffers::ConstantBuffer<Buffers::ModelViewProjection>> g_mvp_buffer;
 extern float g_speed;
+extern double g_profileBudget;
+extern GravityMethod g_gravityMethod;
+extern IntegratorMethod g_integrator;
 extern bool g_coreView;
+extern uint64_t g_seed;
+extern uint32_t g_frame;
+extern StageTimes g_stageTimes;
 
 void CreateGlobalBuffers();
 void UpdateGlobalBuffers();
 unsigned int CleanPlanets();
-unsigned int GetPlanetIndex(int id);
-Planet& GetPlanet(unsigned int id);
+unsigned int GetPlanetIndex(uint32_t id);
+Planet* FindPlanet(uint32_t id);
@@ -0,0 +1,81 @@
+#pragma once
+
+#include "PhysicalConstants.h"
+
+#include <cstddef>
+#include <cstdint>
+
+// G expressed in screen units: a = G_SCREEN * m * d / |d|^3 gives the acceleration in screen units (S_NORM metres) per
+// second squared for a screen space offset d, which is what GravitationalAcceleration in Physics.hlsli computes.
+constexpr double G_SCREEN = G * S_NORM_INV * S_NORM_INV * S_NORM_INV;
+
+// Non-owning view over the kinematic state of the bodies taking part in a gravity pass. Positions and velocities are
+// in screen units, radius in metres and mass in kg, the same units the Instance struct uses on the GPU.
+struct GravityBodies
+{
+	size_t count = 0;
+
+	const float* x = nullptr;
+	const float* y = nullptr;
+	const float* z = nullptr;
+	const float* mass = nullptr;
+	const float* radius = nullptr;
+
+	float* vx = nullptr;
+	float* vy = nullptr;
+	float* vz = nullptr;
+	uint32_t* collision = nullptr;
+
+	// Accelerations in screen units per second squared, written by GravitySolver::Accelerate.
+	double* ax = nullptr;
+	double* ay = nullptr;
+	double* az = nullptr;
+};
+
+struct GravityStats
+{
+	double buildTime = 0; // ms
+	double forceTime = 0; // ms
+	uint64_t interactions = 0;
+	size_t nodes = 0;
+	double gflops = 0; // only reported by solvers with a known operation count
+	double error = 0; // relative rms acceleration error against direct summation, only reported by approximate solvers
+};
+
+enum class GravityMethod
+{
+	Shader,
+	BarnesHut,
+	DirectSum,
+	FastMultipole,
+	ParticleMesh,
+	Count
+};
+
+class GravitySolver
+{
+public:
+	virtual ~GravitySolver() = default;
+
+	// Computes the acceleration of every body and raises bodies.collision for every body that overlaps another one.
+	virtual void Accelerate(GravityBodies const& bodies) = 0;
+	[[nodiscard]] virtual const char* Name() const = 0;
+
+	// One gravity pass: velocity += acceleration * deltaTime, the same update ComputeGravityShader performs.
+	void Execute(GravityBodies const& bodies, double const deltaTime)
+	{
+		Accelerate(bodies);
+
+		for (size_t i = 0; i < bodies.count; i++)
+		{
+			bodies.vx[i] += static_cast<float>(bodies.ax[i] * deltaTime);
+			bodies.vy[i] += static_cast<float>(bodies.ay[i] * deltaTime);
+			bodies.vz[i] += static_cast<float>(bodies.az[i] * deltaTime);
+		}
+	}
+
+	[[nodiscard]] GravityStats const& Stats() const { return m_stats; }
+
+protected:
+	GravityStats m_stats;
+};
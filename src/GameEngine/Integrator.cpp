@@ -0,0 +1,591 @@
+#include "Integrator.h"
+
+#include "KeplerSolver.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+	constexpr size_t BODIES_PER_TASK = 64;
+
+	// Yoshida's coefficients: w1 = 1 / (2 - 2^(1/3)), w0 = 1 - 2 w1.
+	const double YOSHIDA_W1 = 1 / (2 - std::cbrt(2.0));
+	const double YOSHIDA_W0 = 1 - 2 * YOSHIDA_W1;
+
+	// Block timesteps are the longest power of two fraction of the frame below BLOCK_ETA |a| / |j|; a circular orbit
+	// then takes about 2 pi / BLOCK_ETA steps.
+	constexpr double BLOCK_ETA = 0.02;
+
+	void Kick(BodyStore& bodies, double const* ax, double const* ay, double const* az, double const deltaTime)
+	{
+		for (size_t i = 0; i < bodies.Size(); i++)
+		{
+			if (bodies.mass[i] == 0)
+				continue;
+
+			bodies.vx[i] = static_cast<float>(bodies.vx[i] + ax[i] * deltaTime);
+			bodies.vy[i] = static_cast<float>(bodies.vy[i] + ay[i] * deltaTime);
+			bodies.vz[i] = static_cast<float>(bodies.vz[i] + az[i] * deltaTime);
+		}
+	}
+
+	// Positions and velocities of all bodies at one time, the sources of a pairwise pass.
+	struct Phase
+	{
+		double const* x;
+		double const* y;
+		double const* z;
+		double const* vx;
+		double const* vy;
+		double const* vz;
+		float const* mass;
+		size_t count;
+	};
+
+	// a = G sum m r / |r|^3, j = G sum m (v / |r|^3 - 3 (r.v) r / |r|^5), r and v relative to body i.
+	void AccelerationJerk(Phase const& phase, size_t const i, double& ax, double& ay, double& az, double& jx, double& jy,
+	                      double& jz)
+	{
+		double sx = 0, sy = 0, sz = 0, tx = 0, ty = 0, tz = 0;
+		for (size_t j = 0; j < phase.count; j++)
+		{
+			if (phase.mass[j] == 0)
+				continue;
+
+			const double dx = phase.x[j] - phase.x[i], dy = phase.y[j] - phase.y[i], dz = phase.z[j] - phase.z[i];
+			const double r2 = dx * dx + dy * dy + dz * dz;
+			if (r2 == 0)
+				continue;
+
+			const double dvx = phase.vx[j] - phase.vx[i], dvy = phase.vy[j] - phase.vy[i], dvz = phase.vz[j] - phase.vz[i];
+			const double inv2 = 1 / r2;
+			const double inv3 = phase.mass[j] * inv2 * std::sqrt(inv2);
+			const double radial = 3 * (dx * dvx + dy * dvy + dz * dvz) * inv2;
+
+			sx += dx * inv3;
+			sy += dy * inv3;
+			sz += dz * inv3;
+			tx += (dvx - radial * dx) * inv3;
+			ty += (dvy - radial * dy) * inv3;
+			tz += (dvz - radial * dz) * inv3;
+		}
+
+		ax = sx * G_SCREEN;
+		ay = sy * G_SCREEN;
+		az = sz * G_SCREEN;
+		jx = tx * G_SCREEN;
+		jy = ty * G_SCREEN;
+		jz = tz * G_SCREEN;
+	}
+
+	void Drift(BodyStore& bodies, double const deltaTime)
+	{
+		for (size_t i = 0; i < bodies.Size(); i++)
+		{
+			if (bodies.mass[i] == 0)
+				continue;
+
+			bodies.x[i] = static_cast<float>(bodies.x[i] + bodies.vx[i] * deltaTime);
+			bodies.y[i] = static_cast<float>(bodies.y[i] + bodies.vy[i] * deltaTime);
+			bodies.z[i] = static_cast<float>(bodies.z[i] + bodies.vz[i] * deltaTime);
+		}
+	}
+}
+
+const char* GetIntegratorName(IntegratorMethod const method)
+{
+	switch (method)
+	{
+	case IntegratorMethod::Euler: return "Euler";
+	case IntegratorMethod::Leapfrog: return "Leapfrog KDK";
+	case IntegratorMethod::Yoshida: return "Yoshida 4";
+	case IntegratorMethod::Hermite: return "Hermite 4";
+	case IntegratorMethod::Block: return "Block Hermite";
+	case IntegratorMethod::WisdomHolman: return "Wisdom-Holman";
+	default: return "Unknown";
+	}
+}
+
+double TotalEnergy(BodyStore const& bodies)
+{
+	const size_t count = bodies.Size();
+
+	// Every body pairs with the ones after it; chunks are summed in index order, so the result does not depend on the
+	// thread count.
+	return parallel_reduce(0, count, BODIES_PER_TASK, 0.0, [&](double energy, size_t const i)
+	                       {
+		                       const double mi = bodies.mass[i];
+		                       if (mi == 0)
+			                       return energy;
+
+		                       const double vx = bodies.vx[i], vy = bodies.vy[i], vz = bodies.vz[i];
+		                       double potential = 0;
+		                       for (size_t j = i + 1; j < count; j++)
+		                       {
+			                       const double dx = bodies.x[j] - static_cast<double>(bodies.x[i]);
+			                       const double dy = bodies.y[j] - static_cast<double>(bodies.y[i]);
+			                       const double dz = bodies.z[j] - static_cast<double>(bodies.z[i]);
+			                       const double r2 = dx * dx + dy * dy + dz * dz;
+			                       if (r2 > 0)
+				                       potential += bodies.mass[j] / std::sqrt(r2);
+		                       }
+
+		                       return energy + 0.5 * mi * (vx * vx + vy * vy + vz * vz) - G_SCREEN * mi * potential;
+	                       },
+	                       [](double const a, double const b) { return a + b; });
+}
+
+void Integrator::Step(BodyStore& bodies, GravitySolver& solver, double const deltaTime, bool const measureEnergy)
+{
+	m_stats.evaluations = 0;
+	m_stats.bodyEvaluations = 0;
+	m_stats.deepestLevel = 0;
+
+	const double before = measureEnergy ? TotalEnergy(bodies) : 0;
+
+	Advance(bodies, solver, deltaTime);
+
+	if (measureEnergy && before != 0)
+	{
+		m_stats.energyError = (TotalEnergy(bodies) - before) / std::abs(before);
+		m_stats.energyDrift += m_stats.energyError;
+		m_stats.measured++;
+	}
+}
+
+void Integrator::Evaluate(BodyStore& bodies, GravitySolver& solver)
+{
+	solver.Accelerate(bodies.Gravity());
+	m_stats.evaluations++;
+	m_stats.bodyEvaluations += bodies.Size();
+}
+
+bool Integrator::Cached(BodyStore const& bodies) const
+{
+	return m_cachedMass.size() == bodies.Size() &&
+		std::equal(m_cachedMass.begin(), m_cachedMass.end(), bodies.mass.begin());
+}
+
+void Integrator::Cache(BodyStore const& bodies)
+{
+	m_cachedMass.assign(bodies.mass.begin(), bodies.mass.end());
+}
+
+void EulerIntegrator::Advance(BodyStore& bodies, GravitySolver& solver, double const deltaTime)
+{
+	Evaluate(bodies, solver);
+	Kick(bodies, bodies.ax.data(), bodies.ay.data(), bodies.az.data(), deltaTime);
+	Drift(bodies, deltaTime);
+}
+
+void LeapfrogIntegrator::Advance(BodyStore& bodies, GravitySolver& solver, double const deltaTime)
+{
+	if (!Cached(bodies))
+	{
+		Evaluate(bodies, solver);
+		m_ax.assign(bodies.ax.begin(), bodies.ax.end());
+		m_ay.assign(bodies.ay.begin(), bodies.ay.end());
+		m_az.assign(bodies.az.begin(), bodies.az.end());
+	}
+
+	Kick(bodies, m_ax.data(), m_ay.data(), m_az.data(), deltaTime / 2);
+	Drift(bodies, deltaTime);
+
+	Evaluate(bodies, solver);
+	Kick(bodies, bodies.ax.data(), bodies.ay.data(), bodies.az.data(), deltaTime / 2);
+
+	m_ax.assign(bodies.ax.begin(), bodies.ax.end());
+	m_ay.assign(bodies.ay.begin(), bodies.ay.end());
+	m_az.assign(bodies.az.begin(), bodies.az.end());
+	Cache(bodies);
+}
+
+void YoshidaIntegrator::Advance(BodyStore& bodies, GravitySolver& solver, double const deltaTime)
+{
+	// Drift-kick-drift form: c1 = c4 = w1 / 2, c2 = c3 = (w0 + w1) / 2, d1 = d3 = w1, d2 = w0.
+	const double drifts[4] = {YOSHIDA_W1 / 2, (YOSHIDA_W0 + YOSHIDA_W1) / 2, (YOSHIDA_W0 + YOSHIDA_W1) / 2, YOSHIDA_W1 / 2};
+	const double kicks[3] = {YOSHIDA_W1, YOSHIDA_W0, YOSHIDA_W1};
+
+	for (int k = 0; k < 3; k++)
+	{
+		Drift(bodies, drifts[k] * deltaTime);
+		Evaluate(bodies, solver);
+		Kick(bodies, bodies.ax.data(), bodies.ay.data(), bodies.az.data(), kicks[k] * deltaTime);
+	}
+	Drift(bodies, drifts[3] * deltaTime);
+}
+
+void HermiteIntegrator::Evaluate(double const* x, double const* y, double const* z, double const* vx,
+                                 double const* vy, double const* vz, float const* mass, size_t const count)
+{
+	for (auto* values : {&m_ax, &m_ay, &m_az, &m_jx, &m_jy, &m_jz})
+		values->resize(count);
+
+	const Phase phase{x, y, z, vx, vy, vz, mass, count};
+	parallel_for(0, count, BODIES_PER_TASK, [&](size_t const i)
+	{
+		AccelerationJerk(phase, i, m_ax[i], m_ay[i], m_az[i], m_jx[i], m_jy[i], m_jz[i]);
+	});
+
+	m_stats.evaluations++;
+	m_stats.bodyEvaluations += count;
+}
+
+void HermiteIntegrator::Advance(BodyStore& bodies, GravitySolver&, double const deltaTime)
+{
+	const size_t count = bodies.Size();
+	const double dt = deltaTime, dt2 = dt * dt / 2, dt3 = dt * dt * dt / 6;
+
+	std::vector<double> x(bodies.x.begin(), bodies.x.end());
+	std::vector<double> y(bodies.y.begin(), bodies.y.end());
+	std::vector<double> z(bodies.z.begin(), bodies.z.end());
+	std::vector<double> vx(bodies.vx.begin(), bodies.vx.end());
+	std::vector<double> vy(bodies.vy.begin(), bodies.vy.end());
+	std::vector<double> vz(bodies.vz.begin(), bodies.vz.end());
+
+	if (!Cached(bodies))
+		Evaluate(x.data(), y.data(), z.data(), vx.data(), vy.data(), vz.data(), bodies.mass.data(), count);
+
+	const std::vector<double> ax0 = m_ax, ay0 = m_ay, az0 = m_az, jx0 = m_jx, jy0 = m_jy, jz0 = m_jz;
+
+	// Predict with the Taylor series up to the jerk.
+	std::vector<double> px(count), py(count), pz(count), pvx(count), pvy(count), pvz(count);
+	for (size_t i = 0; i < count; i++)
+	{
+		px[i] = x[i] + vx[i] * dt + ax0[i] * dt2 + jx0[i] * dt3;
+		py[i] = y[i] + vy[i] * dt + ay0[i] * dt2 + jy0[i] * dt3;
+		pz[i] = z[i] + vz[i] * dt + az0[i] * dt2 + jz0[i] * dt3;
+		pvx[i] = vx[i] + ax0[i] * dt + jx0[i] * dt2;
+		pvy[i] = vy[i] + ay0[i] * dt + jy0[i] * dt2;
+		pvz[i] = vz[i] + az0[i] * dt + jz0[i] * dt2;
+	}
+
+	Evaluate(px.data(), py.data(), pz.data(), pvx.data(), pvy.data(), pvz.data(), bodies.mass.data(), count);
+
+	// Correct with the accelerations and jerks at both ends of the step.
+	const double dt12 = dt * dt / 12;
+	for (size_t i = 0; i < count; i++)
+	{
+		if (bodies.mass[i] == 0)
+			continue;
+
+		const double nvx = vx[i] + (ax0[i] + m_ax[i]) * dt / 2 + (jx0[i] - m_jx[i]) * dt12;
+		const double nvy = vy[i] + (ay0[i] + m_ay[i]) * dt / 2 + (jy0[i] - m_jy[i]) * dt12;
+		const double nvz = vz[i] + (az0[i] + m_az[i]) * dt / 2 + (jz0[i] - m_jz[i]) * dt12;
+
+		bodies.x[i] = static_cast<float>(x[i] + (vx[i] + nvx) * dt / 2 + (ax0[i] - m_ax[i]) * dt12);
+		bodies.y[i] = static_cast<float>(y[i] + (vy[i] + nvy) * dt / 2 + (ay0[i] - m_ay[i]) * dt12);
+		bodies.z[i] = static_cast<float>(z[i] + (vz[i] + nvz) * dt / 2 + (az0[i] - m_az[i]) * dt12);
+		bodies.vx[i] = static_cast<float>(nvx);
+		bodies.vy[i] = static_cast<float>(nvy);
+		bodies.vz[i] = static_cast<float>(nvz);
+	}
+
+	// The accelerations and jerks at the predicted state open the next step; the corrector moves the bodies only by
+	// O(dt^4), well inside the error of the scheme.
+	Cache(bodies);
+}
+
+uint32_t BlockIntegrator::Level(double const ax, double const ay, double const az, double const jx, double const jy,
+                               double const jz, double const deltaTime)
+{
+	const double a2 = ax * ax + ay * ay + az * az, j2 = jx * jx + jy * jy + jz * jz;
+	const double step = j2 > 0 ? BLOCK_ETA * std::sqrt(a2 / j2) : deltaTime;
+
+	uint32_t level = 0;
+	while (level < MAX_LEVEL && std::ldexp(deltaTime, -static_cast<int>(level)) > step)
+		level++;
+
+	return level;
+}
+
+void BlockIntegrator::Advance(BodyStore& bodies, GravitySolver&, double const deltaTime)
+{
+	constexpr uint32_t ticks = 1u << MAX_LEVEL;
+	const size_t count = bodies.Size();
+	const double tick = deltaTime / ticks;
+
+	std::vector<double> x(bodies.x.begin(), bodies.x.end());
+	std::vector<double> y(bodies.y.begin(), bodies.y.end());
+	std::vector<double> z(bodies.z.begin(), bodies.z.end());
+	std::vector<double> vx(bodies.vx.begin(), bodies.vx.end());
+	std::vector<double> vy(bodies.vy.begin(), bodies.vy.end());
+	std::vector<double> vz(bodies.vz.begin(), bodies.vz.end());
+
+	// All bodies meet at the end of a frame, so the accelerations and jerks of the last sub-step open the next frame.
+	if (!Cached(bodies))
+	{
+		for (auto* values : {&m_ax, &m_ay, &m_az, &m_jx, &m_jy, &m_jz})
+			values->resize(count);
+
+		const Phase phase{x.data(), y.data(), z.data(), vx.data(), vy.data(), vz.data(), bodies.mass.data(), count};
+		parallel_for(0, count, BODIES_PER_TASK, [&](size_t const i)
+		{
+			AccelerationJerk(phase, i, m_ax[i], m_ay[i], m_az[i], m_jx[i], m_jy[i], m_jz[i]);
+		});
+
+		m_stats.evaluations++;
+		m_stats.bodyEvaluations += count;
+	}
+
+	// Levels are fractions of the frame time, which changes from frame to frame, so they start over every frame.
+	m_level.resize(count);
+	for (size_t i = 0; i < count; i++)
+		m_level[i] = static_cast<uint8_t>(Level(m_ax[i], m_ay[i], m_az[i], m_jx[i], m_jy[i], m_jz[i], deltaTime));
+
+	std::vector<uint32_t> time(count, 0);
+	std::vector<double> px(count), py(count), pz(count), pvx(count), pvy(count), pvz(count);
+	const Phase predicted{px.data(), py.data(), pz.data(), pvx.data(), pvy.data(), pvz.data(), bodies.mass.data(), count};
+
+	std::vector<uint32_t> active;
+	for (uint32_t now = 0; now < ticks;)
+	{
+		// The next sub-step is the earliest end of a body's step; every body whose step ends there is active.
+		uint32_t next = ticks;
+		for (size_t i = 0; i < count; i++)
+		{
+			if (bodies.mass[i] == 0)
+				continue;
+
+			next = std::min(next, time[i] + (ticks >> m_level[i]));
+			m_stats.deepestLevel = std::max<uint32_t>(m_stats.deepestLevel, m_level[i]);
+		}
+
+		active.clear();
+		for (size_t i = 0; i < count; i++)
+		{
+			if (bodies.mass[i] != 0 && time[i] + (ticks >> m_level[i]) == next)
+				active.push_back(static_cast<uint32_t>(i));
+		}
+
+		// Everyone is predicted to the sub-step, only the active bodies get forces.
+		parallel_for(0, count, BODIES_PER_TASK * 16, [&](size_t const i)
+		{
+			const double dt = (next - time[i]) * tick, dt2 = dt * dt / 2, dt3 = dt * dt * dt / 6;
+
+			px[i] = x[i] + vx[i] * dt + m_ax[i] * dt2 + m_jx[i] * dt3;
+			py[i] = y[i] + vy[i] * dt + m_ay[i] * dt2 + m_jy[i] * dt3;
+			pz[i] = z[i] + vz[i] * dt + m_az[i] * dt2 + m_jz[i] * dt3;
+			pvx[i] = vx[i] + m_ax[i] * dt + m_jx[i] * dt2;
+			pvy[i] = vy[i] + m_ay[i] * dt + m_jy[i] * dt2;
+			pvz[i] = vz[i] + m_az[i] * dt + m_jz[i] * dt2;
+		});
+
+		parallel_for(0, active.size(), BODIES_PER_TASK, [&](size_t const k)
+		{
+			const uint32_t i = active[k];
+			const double dt = (next - time[i]) * tick, dt12 = dt * dt / 12;
+
+			double ax, ay, az, jx, jy, jz;
+			AccelerationJerk(predicted, i, ax, ay, az, jx, jy, jz);
+
+			const double nvx = vx[i] + (m_ax[i] + ax) * dt / 2 + (m_jx[i] - jx) * dt12;
+			const double nvy = vy[i] + (m_ay[i] + ay) * dt / 2 + (m_jy[i] - jy) * dt12;
+			const double nvz = vz[i] + (m_az[i] + az) * dt / 2 + (m_jz[i] - jz) * dt12;
+
+			x[i] += (vx[i] + nvx) * dt / 2 + (m_ax[i] - ax) * dt12;
+			y[i] += (vy[i] + nvy) * dt / 2 + (m_ay[i] - ay) * dt12;
+			z[i] += (vz[i] + nvz) * dt / 2 + (m_az[i] - az) * dt12;
+			vx[i] = nvx;
+			vy[i] = nvy;
+			vz[i] = nvz;
+
+			m_ax[i] = ax;
+			m_ay[i] = ay;
+			m_az[i] = az;
+			m_jx[i] = jx;
+			m_jy[i] = jy;
+			m_jz[i] = jz;
+
+			// Steps shrink at once but grow one level at a time, and only where the longer step would start, so all
+			// steps stay aligned to the blocks.
+			const uint32_t wanted = Level(ax, ay, az, jx, jy, jz, deltaTime);
+			const uint32_t level = m_level[i];
+			if (wanted > level)
+				m_level[i] = static_cast<uint8_t>(wanted);
+			else if (wanted < level && next % (ticks >> (level - 1)) == 0)
+				m_level[i] = static_cast<uint8_t>(level - 1);
+
+			time[i] = next;
+		});
+
+		m_stats.evaluations++;
+		m_stats.bodyEvaluations += active.size();
+		now = next;
+	}
+
+	for (size_t i = 0; i < count; i++)
+	{
+		if (bodies.mass[i] == 0)
+			continue;
+
+		bodies.x[i] = static_cast<float>(x[i]);
+		bodies.y[i] = static_cast<float>(y[i]);
+		bodies.z[i] = static_cast<float>(z[i]);
+		bodies.vx[i] = static_cast<float>(vx[i]);
+		bodies.vy[i] = static_cast<float>(vy[i]);
+		bodies.vz[i] = static_cast<float>(vz[i]);
+	}
+
+	Cache(bodies);
+}
+
+void WisdomHolmanIntegrator::Interact(BodyStore& bodies, GravitySolver& solver)
+{
+	m_mass.assign(bodies.mass.begin(), bodies.mass.end());
+	m_mass[m_star] = 0;
+
+	GravityBodies view = bodies.Gravity();
+	view.mass = m_mass.data();
+	solver.Accelerate(view);
+
+	m_ax.assign(bodies.ax.begin(), bodies.ax.end());
+	m_ay.assign(bodies.ay.begin(), bodies.ay.end());
+	m_az.assign(bodies.az.begin(), bodies.az.end());
+
+	m_stats.evaluations++;
+	m_stats.bodyEvaluations += bodies.Size();
+}
+
+void WisdomHolmanIntegrator::Advance(BodyStore& bodies, GravitySolver& solver, double const deltaTime)
+{
+	const size_t count = bodies.Size();
+	if (count == 0)
+		return;
+
+	const size_t star = std::max_element(bodies.mass.begin(), bodies.mass.end()) - bodies.mass.begin();
+	const double starMass = bodies.mass[star];
+	if (starMass == 0)
+		return;
+
+	if (!Cached(bodies) || star != m_star)
+	{
+		m_star = star;
+		Interact(bodies, solver);
+	}
+
+	double mass = 0, cx = 0, cy = 0, cz = 0, cvx = 0, cvy = 0, cvz = 0;
+	m_planets.clear();
+	for (size_t i = 0; i < count; i++)
+	{
+		const double m = bodies.mass[i];
+		if (m == 0)
+			continue;
+
+		mass += m;
+		cx += bodies.x[i] * m;
+		cy += bodies.y[i] * m;
+		cz += bodies.z[i] * m;
+		cvx += bodies.vx[i] * m;
+		cvy += bodies.vy[i] * m;
+		cvz += bodies.vz[i] * m;
+
+		if (i != star)
+			m_planets.push_back(static_cast<uint32_t>(i));
+	}
+	cx /= mass;
+	cy /= mass;
+	cz /= mass;
+	cvx /= mass;
+	cvy /= mass;
+	cvz /= mass;
+
+	const size_t planets = m_planets.size();
+	for (auto* values : {&m_qx, &m_qy, &m_qz, &m_px, &m_py, &m_pz})
+		values->resize(planets);
+
+	// First half kick, straight into the barycentric velocities; the forces between the planets leave the barycentre
+	// at rest.
+	const double half = deltaTime / 2;
+	for (size_t k = 0; k < planets; k++)
+	{
+		const uint32_t i = m_planets[k];
+
+		m_qx[k] = static_cast<double>(bodies.x[i]) - bodies.x[star];
+		m_qy[k] = static_cast<double>(bodies.y[i]) - bodies.y[star];
+		m_qz[k] = static_cast<double>(bodies.z[i]) - bodies.z[star];
+		m_px[k] = bodies.vx[i] - cvx + m_ax[i] * half;
+		m_py[k] = bodies.vy[i] - cvy + m_ay[i] * half;
+		m_pz[k] = bodies.vz[i] - cvz + m_az[i] * half;
+	}
+
+	const auto jump = [&]
+	{
+		double sx = 0, sy = 0, sz = 0;
+		for (size_t k = 0; k < planets; k++)
+		{
+			const double m = bodies.mass[m_planets[k]];
+			sx += m * m_px[k];
+			sy += m * m_py[k];
+			sz += m * m_pz[k];
+		}
+
+		const double scale = half / starMass;
+		for (size_t k = 0; k < planets; k++)
+		{
+			m_qx[k] += sx * scale;
+			m_qy[k] += sy * scale;
+			m_qz[k] += sz * scale;
+		}
+	};
+
+	jump();
+	KeplerDrift({m_qx.data(), m_qy.data(), m_qz.data(), m_px.data(), m_py.data(), m_pz.data(), planets},
+	            G_SCREEN * starMass, deltaTime);
+	jump();
+
+	// Back to barycentric positions: the barycentre drifts with its velocity and the star sits where the planets'
+	// heliocentric moment puts it.
+	double qx = 0, qy = 0, qz = 0;
+	for (size_t k = 0; k < planets; k++)
+	{
+		const double m = bodies.mass[m_planets[k]];
+		qx += m * m_qx[k];
+		qy += m * m_qy[k];
+		qz += m * m_qz[k];
+	}
+
+	const double sx = cx + cvx * deltaTime - qx / mass;
+	const double sy = cy + cvy * deltaTime - qy / mass;
+	const double sz = cz + cvz * deltaTime - qz / mass;
+
+	bodies.x[star] = static_cast<float>(sx);
+	bodies.y[star] = static_cast<float>(sy);
+	bodies.z[star] = static_cast<float>(sz);
+	for (size_t k = 0; k < planets; k++)
+	{
+		const uint32_t i = m_planets[k];
+		bodies.x[i] = static_cast<float>(m_qx[k] + sx);
+		bodies.y[i] = static_cast<float>(m_qy[k] + sy);
+		bodies.z[i] = static_cast<float>(m_qz[k] + sz);
+	}
+
+	Interact(bodies, solver);
+
+	// Second half kick, then the star takes the momentum the planets do not carry.
+	double px = 0, py = 0, pz = 0;
+	for (size_t k = 0; k < planets; k++)
+	{
+		const uint32_t i = m_planets[k];
+		const double m = bodies.mass[i];
+
+		m_px[k] += m_ax[i] * half;
+		m_py[k] += m_ay[i] * half;
+		m_pz[k] += m_az[i] * half;
+		px += m * m_px[k];
+		py += m * m_py[k];
+		pz += m * m_pz[k];
+
+		bodies.vx[i] = static_cast<float>(m_px[k] + cvx);
+		bodies.vy[i] = static_cast<float>(m_py[k] + cvy);
+		bodies.vz[i] = static_cast<float>(m_pz[k] + cvz);
+	}
+
+	bodies.vx[star] = static_cast<float>(cvx - px / starMass);
+	bodies.vy[star] = static_cast<float>(cvy - py / starMass);
+	bodies.vz[star] = static_cast<float>(cvz - pz / starMass);
+
+	Cache(bodies);
+}
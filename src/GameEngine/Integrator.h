@@ -0,0 +1,179 @@
+#pragma once
+
+#include "BodyStore.h"
+#include "GravitySolver.h"
+
+#include <cstdint>
+#include <vector>
+
+enum class IntegratorMethod
+{
+	Euler,
+	Leapfrog,
+	Yoshida,
+	Hermite,
+	Block,
+	WisdomHolman,
+	Count
+};
+
+struct IntegratorStats
+{
+	uint64_t evaluations = 0; // force evaluations in the last step
+	uint64_t bodyEvaluations = 0; // bodies whose force was evaluated in the last step, summed over its evaluations
+	uint32_t deepestLevel = 0; // block timesteps only: the shortest step taken was deltaTime / 2^deepestLevel
+	double energyError = 0; // relative energy change over the last measured step
+	double energyDrift = 0; // sum of the relative changes of all measured steps
+	uint64_t measured = 0; // steps with an energy measurement
+};
+
+// Advances the CPU bodies by one frame, taking the accelerations from a GravitySolver. The shader path keeps its own
+// Euler step in ComputeGravityShader and ComputePositionShader.
+//
+// Positions and velocities stay floats in the BodyStore, the GPU instance layout, while the updates are computed in
+// double. Massless bodies are left where they are, as BodyStore::Drift does. A step optionally measures the total
+// energy before and after, which costs a pairwise pass of its own, so callers measure only every so many steps.
+class Integrator
+{
+public:
+	virtual ~Integrator() = default;
+
+	[[nodiscard]] virtual const char* Name() const = 0;
+
+	void Step(BodyStore& bodies, GravitySolver& solver, double deltaTime, bool measureEnergy);
+
+	[[nodiscard]] IntegratorStats const& Stats() const { return m_stats; }
+
+	// Drops the accelerations kept from the last step. Callers reset whenever the bodies may have moved without this
+	// integrator since its last Step, such as after another integrator, solver or the shader path ran.
+	void Reset() { m_cachedMass.clear(); }
+
+protected:
+	virtual void Advance(BodyStore& bodies, GravitySolver& solver, double deltaTime) = 0;
+
+	// Fills bodies.ax, ay and az.
+	void Evaluate(BodyStore& bodies, GravitySolver& solver);
+
+	// Whether the accelerations of the last evaluation still hold: no Reset since, same bodies with the same masses.
+	// Positions may have been shifted by the centre of mass in between, which does not change the accelerations, but
+	// any other move needs a Reset as the masses alone cannot tell.
+	[[nodiscard]] bool Cached(BodyStore const& bodies) const;
+	void Cache(BodyStore const& bodies);
+
+	IntegratorStats m_stats;
+
+private:
+	std::vector<float> m_cachedMass;
+};
+
+// Symplectic Euler, what the engine did before the integrators: kick with the acceleration at the start, then drift.
+// First order, one evaluation per step.
+class EulerIntegrator final : public Integrator
+{
+public:
+	[[nodiscard]] const char* Name() const override { return "Euler"; }
+
+protected:
+	void Advance(BodyStore& bodies, GravitySolver& solver, double deltaTime) override;
+};
+
+// Kick-drift-kick leapfrog. Second order and symplectic; the closing kick's accelerations open the next step, so it
+// costs one evaluation per step like Euler as long as the bodies do not change in between.
+class LeapfrogIntegrator final : public Integrator
+{
+public:
+	[[nodiscard]] const char* Name() const override { return "Leapfrog KDK"; }
+
+protected:
+	void Advance(BodyStore& bodies, GravitySolver& solver, double deltaTime) override;
+
+private:
+	AlignedVector<double> m_ax, m_ay, m_az;
+};
+
+// Yoshida's fourth order symplectic composition of three leapfrog steps, the middle one backwards in time. Three
+// evaluations per step.
+class YoshidaIntegrator final : public Integrator
+{
+public:
+	[[nodiscard]] const char* Name() const override { return "Yoshida 4"; }
+
+protected:
+	void Advance(BodyStore& bodies, GravitySolver& solver, double deltaTime) override;
+};
+
+// Fourth order Hermite predictor-corrector. It needs the jerk along with the acceleration, which none of the solvers
+// provide, so it sums both pairwise itself and ignores the solver: O(N^2) per step, for accuracy runs rather than
+// large systems. One evaluation per step, reused like the leapfrog's.
+class HermiteIntegrator final : public Integrator
+{
+public:
+	[[nodiscard]] const char* Name() const override { return "Hermite 4"; }
+
+protected:
+	void Advance(BodyStore& bodies, GravitySolver& solver, double deltaTime) override;
+
+private:
+	void Evaluate(double const* x, double const* y, double const* z, double const* vx, double const* vy,
+	              double const* vz, float const* mass, size_t count);
+
+	std::vector<double> m_ax, m_ay, m_az, m_jx, m_jy, m_jz;
+};
+
+// Fourth order Hermite with individual block timesteps. Every body steps by deltaTime / 2^level, its level chosen from
+// eta |a| / |j| after each of its steps, so only the bodies in close encounters take short steps instead of the whole
+// system. At every sub-step all bodies are predicted to the current time, and only the ones whose step ends there are
+// evaluated, pairwise like HermiteIntegrator, and corrected. All bodies meet again at the end of the frame.
+class BlockIntegrator final : public Integrator
+{
+public:
+	// The shortest step is deltaTime / 2^MAX_LEVEL; encounters asking for less are integrated less accurately.
+	static constexpr uint32_t MAX_LEVEL = 20;
+
+	[[nodiscard]] const char* Name() const override { return "Block Hermite"; }
+
+protected:
+	void Advance(BodyStore& bodies, GravitySolver& solver, double deltaTime) override;
+
+private:
+	// Level whose step is no longer than eta |a| / |j|.
+	static uint32_t Level(double ax, double ay, double az, double jx, double jy, double jz, double deltaTime);
+
+	std::vector<double> m_ax, m_ay, m_az, m_jx, m_jy, m_jz;
+	std::vector<uint8_t> m_level;
+};
+
+// Wisdom-Holman map in democratic heliocentric coordinates for systems dominated by one star, the heaviest body. Each
+// step kicks the barycentric velocities with the forces between the other bodies for half a step, shifts the
+// heliocentric positions by the star's share of their momentum, moves every body along its Kepler orbit around the
+// star for the full step, shifts again and closes with the second half kick. The star's pull is integrated exactly, so
+// orbits stay stable at steps of a sizeable fraction of the innermost period where the other integrators need hundreds
+// per orbit.
+//
+// The kicks come from the selected solver with the star made massless; the closing kick's accelerations open the next
+// step like the leapfrog's.
+class WisdomHolmanIntegrator final : public Integrator
+{
+public:
+	[[nodiscard]] const char* Name() const override { return "Wisdom-Holman"; }
+
+protected:
+	void Advance(BodyStore& bodies, GravitySolver& solver, double deltaTime) override;
+
+private:
+	// Accelerations from all bodies but the star into m_ax, m_ay and m_az.
+	void Interact(BodyStore& bodies, GravitySolver& solver);
+
+	AlignedVector<float> m_mass;
+	AlignedVector<double> m_ax, m_ay, m_az;
+
+	// Bodies orbiting the star with their heliocentric positions and barycentric velocities.
+	std::vector<uint32_t> m_planets;
+	std::vector<double> m_qx, m_qy, m_qz, m_px, m_py, m_pz;
+	size_t m_star = 0;
+};
+
+[[nodiscard]] const char* GetIntegratorName(IntegratorMethod method);
+
+// Kinetic plus potential energy of the bodies with mass, in kg screen units^2 / s^2.
+[[nodiscard]] double TotalEnergy(BodyStore const& bodies);
@@ -0,0 +1,258 @@
+#include "KeplerSolver.h"
+
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+	constexpr size_t BODIES_PER_TASK = 256;
+	constexpr int MAX_ITERATIONS = 16;
+	constexpr double TOLERANCE = 1e-15;
+
+	// The Stumpff series are summed below this |z| and reduced towards it by powers of four.
+	constexpr double STUMPFF_LIMIT = .1;
+	constexpr int MAX_REDUCTIONS = 40;
+
+	// c2(z) = sum (-z)^k / (2k + 2)! and c3(z) = sum (-z)^k / (2k + 3)!, enough terms for double precision below
+	// STUMPFF_LIMIT.
+	constexpr double C2_SERIES[] = {
+		1 / 2., -1 / 24., 1 / 720., -1 / 40320., 1 / 3628800., -1 / 479001600., 1 / 87178291200.
+	};
+	constexpr double C3_SERIES[] = {
+		1 / 6., -1 / 120., 1 / 5040., -1 / 362880., 1 / 39916800., -1 / 6227020800., 1 / 1307674368000.
+	};
+	constexpr int SERIES_TERMS = sizeof(C2_SERIES) / sizeof(C2_SERIES[0]);
+
+	int Reduce(double& z)
+	{
+		int reductions = 0;
+		while (std::abs(z) > STUMPFF_LIMIT && reductions < MAX_REDUCTIONS)
+		{
+			z *= .25;
+			reductions++;
+		}
+
+		return reductions;
+	}
+
+	// c0 = cos sqrt z, c1 = sin sqrt z / sqrt z, c2 = (1 - c0) / z and c3 = (1 - c1) / z, continued to z < 0 with cosh
+	// and sinh. Every quadrupling of z maps them through c0' = 2 c0^2 - 1, c1' = c0 c1, c2' = c1^2 / 2 and
+	// c3' = (c2 + c0 c3) / 4.
+	void Stumpff(double z, double& c0, double& c1, double& c2, double& c3)
+	{
+		const int reductions = Reduce(z);
+
+		c2 = C2_SERIES[SERIES_TERMS - 1];
+		c3 = C3_SERIES[SERIES_TERMS - 1];
+		for (int k = SERIES_TERMS - 2; k >= 0; k--)
+		{
+			c2 = c2 * z + C2_SERIES[k];
+			c3 = c3 * z + C3_SERIES[k];
+		}
+		c1 = 1 - z * c3;
+		c0 = 1 - z * c2;
+
+		for (int k = 0; k < reductions; k++)
+		{
+			c3 = (c2 + c0 * c3) * .25;
+			c2 = c1 * c1 * .5;
+			c1 = c0 * c1;
+			c0 = 2 * c0 * c0 - 1;
+		}
+	}
+
+	// Kepler's equation in the universal anomaly s: r0 G1 + eta G2 + mu G3 = deltaTime with G_n = s^n c_n(beta s^2),
+	// solved with Laguerre's method of order 5. Then the f and g functions carry position and velocity along.
+	void SolveScalar(KeplerOrbits const& orbits, size_t const i, double const mu, double const deltaTime)
+	{
+		const double x = orbits.x[i], y = orbits.y[i], z = orbits.z[i];
+		const double vx = orbits.vx[i], vy = orbits.vy[i], vz = orbits.vz[i];
+
+		const double r0 = std::sqrt(x * x + y * y + z * z);
+		const double eta = x * vx + y * vy + z * vz;
+		const double beta = 2 * mu / r0 - (vx * vx + vy * vy + vz * vz);
+		const double zeta = mu - beta * r0;
+
+		double s = deltaTime / r0;
+		double c0, c1, c2, c3;
+
+		for (int iteration = 0; iteration < MAX_ITERATIONS; iteration++)
+		{
+			Stumpff(beta * s * s, c0, c1, c2, c3);
+
+			const double g1 = s * c1, g2 = s * s * c2, g3 = s * s * s * c3;
+			const double f = r0 * g1 + eta * g2 + mu * g3 - deltaTime;
+			const double fp = r0 * c0 + eta * g1 + mu * g2;
+			const double fpp = eta * c0 + zeta * g1;
+
+			const double root = std::sqrt(std::abs(16 * fp * fp - 20 * f * fpp));
+			const double ds = -5 * f / (fp + std::copysign(root, fp));
+			s += ds;
+
+			if (std::abs(ds) <= TOLERANCE * std::abs(s))
+				break;
+		}
+
+		Stumpff(beta * s * s, c0, c1, c2, c3);
+
+		const double g1 = s * c1, g2 = s * s * c2, g3 = s * s * s * c3;
+		const double r = r0 * c0 + eta * g1 + mu * g2;
+
+		const double f = 1 - mu * g2 / r0;
+		const double g = deltaTime - mu * g3;
+		const double fd = -mu * g1 / (r * r0);
+		const double gd = 1 - mu * g2 / r;
+
+		orbits.x[i] = f * x + g * vx;
+		orbits.y[i] = f * y + g * vy;
+		orbits.z[i] = f * z + g * vz;
+		orbits.vx[i] = fd * x + gd * vx;
+		orbits.vy[i] = fd * y + gd * vy;
+		orbits.vz[i] = fd * z + gd * vz;
+	}
+
+#ifdef SIMD_X86
+	SIMD_TARGET("avx2,fma")
+	void StumpffAvx2(__m256d const z, __m256d& c0, __m256d& c1, __m256d& c2, __m256d& c3)
+	{
+		// The reductions differ per lane, so they are counted lane by lane and the quadruplings masked.
+		alignas(32) double reduced[4];
+		alignas(32) double reductions[4];
+		_mm256_store_pd(reduced, z);
+
+		int most = 0;
+		for (int lane = 0; lane < 4; lane++)
+		{
+			const int count = Reduce(reduced[lane]);
+			reductions[lane] = count;
+			most = std::max(most, count);
+		}
+
+		const __m256d r = _mm256_load_pd(reduced);
+		const __m256d levels = _mm256_load_pd(reductions);
+		const __m256d one = _mm256_set1_pd(1);
+		const __m256d half = _mm256_set1_pd(.5);
+		const __m256d quarter = _mm256_set1_pd(.25);
+
+		c2 = _mm256_set1_pd(C2_SERIES[SERIES_TERMS - 1]);
+		c3 = _mm256_set1_pd(C3_SERIES[SERIES_TERMS - 1]);
+		for (int k = SERIES_TERMS - 2; k >= 0; k--)
+		{
+			c2 = _mm256_fmadd_pd(c2, r, _mm256_set1_pd(C2_SERIES[k]));
+			c3 = _mm256_fmadd_pd(c3, r, _mm256_set1_pd(C3_SERIES[k]));
+		}
+		c1 = _mm256_fnmadd_pd(r, c3, one);
+		c0 = _mm256_fnmadd_pd(r, c2, one);
+
+		for (int k = 0; k < most; k++)
+		{
+			const __m256d active = _mm256_cmp_pd(levels, _mm256_set1_pd(k), _CMP_GT_OQ);
+
+			const __m256d n3 = _mm256_mul_pd(_mm256_fmadd_pd(c0, c3, c2), quarter);
+			const __m256d n2 = _mm256_mul_pd(_mm256_mul_pd(c1, c1), half);
+			const __m256d n1 = _mm256_mul_pd(c0, c1);
+			const __m256d n0 = _mm256_fmsub_pd(_mm256_add_pd(c0, c0), c0, one);
+
+			c3 = _mm256_blendv_pd(c3, n3, active);
+			c2 = _mm256_blendv_pd(c2, n2, active);
+			c1 = _mm256_blendv_pd(c1, n1, active);
+			c0 = _mm256_blendv_pd(c0, n0, active);
+		}
+	}
+
+	SIMD_TARGET("avx2,fma")
+	void SolveAvx2(KeplerOrbits const& orbits, size_t const i, double const mu, double const deltaTime)
+	{
+		const __m256d x = _mm256_loadu_pd(orbits.x + i), y = _mm256_loadu_pd(orbits.y + i);
+		const __m256d z = _mm256_loadu_pd(orbits.z + i);
+		const __m256d vx = _mm256_loadu_pd(orbits.vx + i), vy = _mm256_loadu_pd(orbits.vy + i);
+		const __m256d vz = _mm256_loadu_pd(orbits.vz + i);
+
+		const __m256d m = _mm256_set1_pd(mu);
+		const __m256d dt = _mm256_set1_pd(deltaTime);
+		const __m256d one = _mm256_set1_pd(1);
+		const __m256d sign = _mm256_set1_pd(-0.);
+
+		const __m256d r0 = _mm256_sqrt_pd(_mm256_fmadd_pd(x, x, _mm256_fmadd_pd(y, y, _mm256_mul_pd(z, z))));
+		const __m256d eta = _mm256_fmadd_pd(x, vx, _mm256_fmadd_pd(y, vy, _mm256_mul_pd(z, vz)));
+		const __m256d v2 = _mm256_fmadd_pd(vx, vx, _mm256_fmadd_pd(vy, vy, _mm256_mul_pd(vz, vz)));
+		const __m256d beta = _mm256_sub_pd(_mm256_div_pd(_mm256_add_pd(m, m), r0), v2);
+		const __m256d zeta = _mm256_fnmadd_pd(beta, r0, m);
+
+		__m256d s = _mm256_div_pd(dt, r0);
+		__m256d c0, c1, c2, c3;
+
+		for (int iteration = 0; iteration < MAX_ITERATIONS; iteration++)
+		{
+			const __m256d s2 = _mm256_mul_pd(s, s);
+			StumpffAvx2(_mm256_mul_pd(beta, s2), c0, c1, c2, c3);
+
+			const __m256d g1 = _mm256_mul_pd(s, c1);
+			const __m256d g2 = _mm256_mul_pd(s2, c2);
+			const __m256d g3 = _mm256_mul_pd(_mm256_mul_pd(s2, s), c3);
+
+			const __m256d f = _mm256_fmadd_pd(r0, g1, _mm256_fmadd_pd(eta, g2, _mm256_fmsub_pd(m, g3, dt)));
+			const __m256d fp = _mm256_fmadd_pd(r0, c0, _mm256_fmadd_pd(eta, g1, _mm256_mul_pd(m, g2)));
+			const __m256d fpp = _mm256_fmadd_pd(eta, c0, _mm256_mul_pd(zeta, g1));
+
+			const __m256d radicand = _mm256_fmsub_pd(_mm256_mul_pd(_mm256_set1_pd(16), fp), fp,
+			                                         _mm256_mul_pd(_mm256_mul_pd(_mm256_set1_pd(20), f), fpp));
+			const __m256d root = _mm256_sqrt_pd(_mm256_andnot_pd(sign, radicand));
+			const __m256d denominator = _mm256_add_pd(fp, _mm256_or_pd(root, _mm256_and_pd(fp, sign)));
+			const __m256d ds = _mm256_div_pd(_mm256_mul_pd(_mm256_set1_pd(-5), f), denominator);
+			s = _mm256_add_pd(s, ds);
+
+			const __m256d limit = _mm256_mul_pd(_mm256_set1_pd(TOLERANCE), _mm256_andnot_pd(sign, s));
+			const __m256d open = _mm256_cmp_pd(_mm256_andnot_pd(sign, ds), limit, _CMP_GT_OQ);
+			if (_mm256_movemask_pd(open) == 0)
+				break;
+		}
+
+		const __m256d s2 = _mm256_mul_pd(s, s);
+		StumpffAvx2(_mm256_mul_pd(beta, s2), c0, c1, c2, c3);
+
+		const __m256d g1 = _mm256_mul_pd(s, c1);
+		const __m256d g2 = _mm256_mul_pd(s2, c2);
+		const __m256d g3 = _mm256_mul_pd(_mm256_mul_pd(s2, s), c3);
+		const __m256d r = _mm256_fmadd_pd(r0, c0, _mm256_fmadd_pd(eta, g1, _mm256_mul_pd(m, g2)));
+
+		const __m256d mg1 = _mm256_mul_pd(m, g1), mg2 = _mm256_mul_pd(m, g2);
+		const __m256d f = _mm256_sub_pd(one, _mm256_div_pd(mg2, r0));
+		const __m256d g = _mm256_fnmadd_pd(m, g3, dt);
+		const __m256d fd = _mm256_div_pd(_mm256_sub_pd(_mm256_setzero_pd(), mg1), _mm256_mul_pd(r, r0));
+		const __m256d gd = _mm256_sub_pd(one, _mm256_div_pd(mg2, r));
+
+		_mm256_storeu_pd(orbits.x + i, _mm256_fmadd_pd(f, x, _mm256_mul_pd(g, vx)));
+		_mm256_storeu_pd(orbits.y + i, _mm256_fmadd_pd(f, y, _mm256_mul_pd(g, vy)));
+		_mm256_storeu_pd(orbits.z + i, _mm256_fmadd_pd(f, z, _mm256_mul_pd(g, vz)));
+		_mm256_storeu_pd(orbits.vx + i, _mm256_fmadd_pd(fd, x, _mm256_mul_pd(gd, vx)));
+		_mm256_storeu_pd(orbits.vy + i, _mm256_fmadd_pd(fd, y, _mm256_mul_pd(gd, vy)));
+		_mm256_storeu_pd(orbits.vz + i, _mm256_fmadd_pd(fd, z, _mm256_mul_pd(gd, vz)));
+	}
+#endif
+}
+
+void KeplerDrift(KeplerOrbits const& orbits, double const mu, double const deltaTime,
+                 [[maybe_unused]] SimdLevel const level)
+{
+	const size_t chunks = (orbits.count + BODIES_PER_TASK - 1) / BODIES_PER_TASK;
+
+	parallel_for(0, chunks, 1, [&](size_t const chunk)
+	{
+		size_t i = chunk * BODIES_PER_TASK;
+		const size_t last = std::min(orbits.count, i + BODIES_PER_TASK);
+
+#ifdef SIMD_X86
+		if (level >= SimdLevel::AVX2)
+		{
+			for (; i + 4 <= last; i += 4)
+				SolveAvx2(orbits, i, mu, deltaTime);
+		}
+#endif
+
+		for (; i < last; i++)
+			SolveScalar(orbits, i, mu, deltaTime);
+	});
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include "Simd.h"
+
+#include <cstddef>
+
+// Positions and velocities of bodies on two-body orbits around a common centre, in double precision.
+struct KeplerOrbits
+{
+	double* x;
+	double* y;
+	double* z;
+	double* vx;
+	double* vy;
+	double* vz;
+	size_t count;
+};
+
+// Moves every body along its Kepler orbit around a mass of gravitational parameter mu (screen units^3 / s^2) at the
+// origin for deltaTime seconds, for elliptic, parabolic and hyperbolic orbits alike.
+//
+// The universal-variable form of Kepler's equation is solved with Laguerre's method, which converges from the simple
+// guess deltaTime / r for any eccentricity, and the Stumpff functions are summed as series after reducing their
+// argument by powers of four. Every step of that is the same for all bodies, so with AVX2 four bodies are solved per
+// register, iterating until the slowest of them has converged. Bodies are split into chunks over the thread pool.
+void KeplerDrift(KeplerOrbits const& orbits, double mu, double deltaTime, SimdLevel level = GetSimdLevel());
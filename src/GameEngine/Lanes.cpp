@@ -0,0 +1,325 @@
+#include "Lanes.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+	bool UseAvx2()
+	{
+		return Lanes::Level() == SimdLevel::AVX2;
+	}
+
+	// Eight float or four double partial sums, combined pairwise in the order the vector reduction uses.
+	float SumScalar(float const* a, size_t const count)
+	{
+		float acc[8] = {};
+		size_t i = 0;
+		for (; i + 8 <= count; i += 8)
+			for (size_t k = 0; k < 8; k++)
+				acc[k] += a[i + k];
+
+		const float r0 = acc[0] + acc[4], r1 = acc[1] + acc[5], r2 = acc[2] + acc[6], r3 = acc[3] + acc[7];
+		float total = (r0 + r2) + (r1 + r3);
+		for (; i < count; i++)
+			total += a[i];
+		return total;
+	}
+
+	double SumScalar(double const* a, size_t const count)
+	{
+		double acc[4] = {};
+		size_t i = 0;
+		for (; i + 4 <= count; i += 4)
+			for (size_t k = 0; k < 4; k++)
+				acc[k] += a[i + k];
+
+		double total = (acc[0] + acc[2]) + (acc[1] + acc[3]);
+		for (; i < count; i++)
+			total += a[i];
+		return total;
+	}
+
+#ifdef SIMD_X86
+	SIMD_TARGET("avx2")
+	void AddAvx2(float* a, float const* b, size_t const count)
+	{
+		size_t i = 0;
+		for (; i + 8 <= count; i += 8)
+			_mm256_storeu_ps(a + i, _mm256_add_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i)));
+		for (; i < count; i++)
+			a[i] += b[i];
+	}
+
+	SIMD_TARGET("avx2")
+	void AddAvx2(double* a, double const* b, size_t const count)
+	{
+		size_t i = 0;
+		for (; i + 4 <= count; i += 4)
+			_mm256_storeu_pd(a + i, _mm256_add_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i)));
+		for (; i < count; i++)
+			a[i] += b[i];
+	}
+
+	SIMD_TARGET("avx2")
+	void SubtractAvx2(float* a, float const* b, size_t const count)
+	{
+		size_t i = 0;
+		for (; i + 8 <= count; i += 8)
+			_mm256_storeu_ps(a + i, _mm256_sub_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i)));
+		for (; i < count; i++)
+			a[i] -= b[i];
+	}
+
+	SIMD_TARGET("avx2")
+	void SubtractAvx2(double* a, double const* b, size_t const count)
+	{
+		size_t i = 0;
+		for (; i + 4 <= count; i += 4)
+			_mm256_storeu_pd(a + i, _mm256_sub_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i)));
+		for (; i < count; i++)
+			a[i] -= b[i];
+	}
+
+	SIMD_TARGET("avx2")
+	void MultiplyAvx2(float* a, float const value, size_t const count)
+	{
+		const __m256 v = _mm256_set1_ps(value);
+		size_t i = 0;
+		for (; i + 8 <= count; i += 8)
+			_mm256_storeu_ps(a + i, _mm256_mul_ps(_mm256_loadu_ps(a + i), v));
+		for (; i < count; i++)
+			a[i] *= value;
+	}
+
+	SIMD_TARGET("avx2")
+	void MultiplyAvx2(double* a, double const value, size_t const count)
+	{
+		const __m256d v = _mm256_set1_pd(value);
+		size_t i = 0;
+		for (; i + 4 <= count; i += 4)
+			_mm256_storeu_pd(a + i, _mm256_mul_pd(_mm256_loadu_pd(a + i), v));
+		for (; i < count; i++)
+			a[i] *= value;
+	}
+
+	SIMD_TARGET("avx2")
+	void DivideAvx2(float* a, float const value, size_t const count)
+	{
+		const __m256 v = _mm256_set1_ps(value);
+		size_t i = 0;
+		for (; i + 8 <= count; i += 8)
+			_mm256_storeu_ps(a + i, _mm256_div_ps(_mm256_loadu_ps(a + i), v));
+		for (; i < count; i++)
+			a[i] /= value;
+	}
+
+	SIMD_TARGET("avx2")
+	void DivideAvx2(double* a, double const value, size_t const count)
+	{
+		const __m256d v = _mm256_set1_pd(value);
+		size_t i = 0;
+		for (; i + 4 <= count; i += 4)
+			_mm256_storeu_pd(a + i, _mm256_div_pd(_mm256_loadu_pd(a + i), v));
+		for (; i < count; i++)
+			a[i] /= value;
+	}
+
+	SIMD_TARGET("avx2")
+	float SumAvx2(float const* a, size_t const count)
+	{
+		__m256 acc = _mm256_setzero_ps();
+		size_t i = 0;
+		for (; i + 8 <= count; i += 8)
+			acc = _mm256_add_ps(acc, _mm256_loadu_ps(a + i));
+
+		const __m128 r = _mm_add_ps(_mm256_castps256_ps128(acc), _mm256_extractf128_ps(acc, 1));
+		const __m128 s = _mm_add_ps(r, _mm_movehl_ps(r, r));
+		float total = _mm_cvtss_f32(_mm_add_ss(s, _mm_shuffle_ps(s, s, 1)));
+		for (; i < count; i++)
+			total += a[i];
+		return total;
+	}
+
+	SIMD_TARGET("avx2")
+	double SumAvx2(double const* a, size_t const count)
+	{
+		__m256d acc = _mm256_setzero_pd();
+		size_t i = 0;
+		for (; i + 4 <= count; i += 4)
+			acc = _mm256_add_pd(acc, _mm256_loadu_pd(a + i));
+
+		const __m128d r = _mm_add_pd(_mm256_castpd256_pd128(acc), _mm256_extractf128_pd(acc, 1));
+		double total = _mm_cvtsd_f64(_mm_add_sd(r, _mm_unpackhi_pd(r, r)));
+		for (; i < count; i++)
+			total += a[i];
+		return total;
+	}
+
+	SIMD_TARGET("avx2")
+	void ConvertAvx2(double* to, float const* from, size_t const count)
+	{
+		size_t i = 0;
+		for (; i + 4 <= count; i += 4)
+			_mm256_storeu_pd(to + i, _mm256_cvtps_pd(_mm_loadu_ps(from + i)));
+		for (; i < count; i++)
+			to[i] = static_cast<double>(from[i]);
+	}
+
+	SIMD_TARGET("avx2")
+	void ConvertAvx2(float* to, double const* from, size_t const count)
+	{
+		size_t i = 0;
+		for (; i + 4 <= count; i += 4)
+			_mm_storeu_ps(to + i, _mm256_cvtpd_ps(_mm256_loadu_pd(from + i)));
+		for (; i < count; i++)
+			to[i] = static_cast<float>(from[i]);
+	}
+#endif
+}
+
+namespace Lanes
+{
+	SimdLevel Level()
+	{
+		return GetSimdLevel() != SimdLevel::Scalar ? SimdLevel::AVX2 : SimdLevel::Scalar;
+	}
+
+	void Fill(float* a, float const value, size_t const count)
+	{
+		std::fill_n(a, count, value);
+	}
+
+	void Fill(double* a, double const value, size_t const count)
+	{
+		std::fill_n(a, count, value);
+	}
+
+	void Add(float* a, float const* b, size_t const count)
+	{
+#ifdef SIMD_X86
+		if (UseAvx2())
+			return AddAvx2(a, b, count);
+#endif
+		for (size_t i = 0; i < count; i++)
+			a[i] += b[i];
+	}
+
+	void Add(double* a, double const* b, size_t const count)
+	{
+#ifdef SIMD_X86
+		if (UseAvx2())
+			return AddAvx2(a, b, count);
+#endif
+		for (size_t i = 0; i < count; i++)
+			a[i] += b[i];
+	}
+
+	void Subtract(float* a, float const* b, size_t const count)
+	{
+#ifdef SIMD_X86
+		if (UseAvx2())
+			return SubtractAvx2(a, b, count);
+#endif
+		for (size_t i = 0; i < count; i++)
+			a[i] -= b[i];
+	}
+
+	void Subtract(double* a, double const* b, size_t const count)
+	{
+#ifdef SIMD_X86
+		if (UseAvx2())
+			return SubtractAvx2(a, b, count);
+#endif
+		for (size_t i = 0; i < count; i++)
+			a[i] -= b[i];
+	}
+
+	void Multiply(float* a, float const value, size_t const count)
+	{
+#ifdef SIMD_X86
+		if (UseAvx2())
+			return MultiplyAvx2(a, value, count);
+#endif
+		for (size_t i = 0; i < count; i++)
+			a[i] *= value;
+	}
+
+	void Multiply(double* a, double const value, size_t const count)
+	{
+#ifdef SIMD_X86
+		if (UseAvx2())
+			return MultiplyAvx2(a, value, count);
+#endif
+		for (size_t i = 0; i < count; i++)
+			a[i] *= value;
+	}
+
+	void Divide(float* a, float const value, size_t const count)
+	{
+#ifdef SIMD_X86
+		if (UseAvx2())
+			return DivideAvx2(a, value, count);
+#endif
+		for (size_t i = 0; i < count; i++)
+			a[i] /= value;
+	}
+
+	void Divide(double* a, double const value, size_t const count)
+	{
+#ifdef SIMD_X86
+		if (UseAvx2())
+			return DivideAvx2(a, value, count);
+#endif
+		for (size_t i = 0; i < count; i++)
+			a[i] /= value;
+	}
+
+	float Sum(float const* a, size_t const count)
+	{
+#ifdef SIMD_X86
+		if (UseAvx2())
+			return SumAvx2(a, count);
+#endif
+		return SumScalar(a, count);
+	}
+
+	double Sum(double const* a, size_t const count)
+	{
+#ifdef SIMD_X86
+		if (UseAvx2())
+			return SumAvx2(a, count);
+#endif
+		return SumScalar(a, count);
+	}
+
+	void Convert(double* to, float const* from, size_t const count)
+	{
+#ifdef SIMD_X86
+		if (UseAvx2())
+			return ConvertAvx2(to, from, count);
+#endif
+		for (size_t i = 0; i < count; i++)
+			to[i] = static_cast<double>(from[i]);
+	}
+
+	void Convert(float* to, double const* from, size_t const count)
+	{
+#ifdef SIMD_X86
+		if (UseAvx2())
+			return ConvertAvx2(to, from, count);
+#endif
+		for (size_t i = 0; i < count; i++)
+			to[i] = static_cast<float>(from[i]);
+	}
+
+	void Convert(float* to, float const* from, size_t const count)
+	{
+		std::memmove(to, from, count * sizeof(float));
+	}
+
+	void Convert(double* to, double const* from, size_t const count)
+	{
+		std::memmove(to, from, count * sizeof(double));
+	}
+}
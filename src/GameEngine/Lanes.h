@@ -0,0 +1,42 @@
+#pragma once
+
+#include "Simd.h"
+
+#include <cstddef>
+
+// Element-wise kernels over fixed-width arrays such as Composition's padded lanes, with AVX2 when GetSimdLevel()
+// allows it. Lengths that are a multiple of eight floats or four doubles run entirely in registers. The scalar path
+// sums in the same lanes and order as the vector one, so results don't depend on the machine.
+namespace Lanes
+{
+	// The kernels these calls run: AVX2 or Scalar, never wider.
+	[[nodiscard]] SimdLevel Level();
+
+	void Fill(float* a, float value, size_t count);
+	void Fill(double* a, double value, size_t count);
+
+	// a += b
+	void Add(float* a, float const* b, size_t count);
+	void Add(double* a, double const* b, size_t count);
+
+	// a -= b
+	void Subtract(float* a, float const* b, size_t count);
+	void Subtract(double* a, double const* b, size_t count);
+
+	// a *= value
+	void Multiply(float* a, float value, size_t count);
+	void Multiply(double* a, double value, size_t count);
+
+	// a /= value
+	void Divide(float* a, float value, size_t count);
+	void Divide(double* a, double value, size_t count);
+
+	[[nodiscard]] float Sum(float const* a, size_t count);
+	[[nodiscard]] double Sum(double const* a, size_t count);
+
+	// to = from, converted element by element.
+	void Convert(double* to, float const* from, size_t count);
+	void Convert(float* to, double const* from, size_t count);
+	void Convert(float* to, float const* from, size_t count);
+	void Convert(double* to, double const* from, size_t count);
+}
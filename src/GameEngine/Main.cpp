@@ -36,7 +36,7 @@ int WINAPI wWinMain(_In_ HINSTANCE hInstance, _In_opt_ HINSTANCE hPrevInstance,
 	if (FAILED(initialize))
 		return 1;
 
-	srand(static_cast<unsigned>(time(nullptr)));
+	g_seed = static_cast<uint64_t>(time(nullptr));
 
 	g_game = std::make_unique<Game>();
 
@@ -0,0 +1,68 @@
+#include "MassOrder.h"
+
+#include <algorithm>
+
+void MassOrder::Compact(std::vector<uint8_t> const& erase)
+{
+	constexpr uint32_t NONE = ~0u;
+
+	// The bodies were replaced rather than compacted, rank them all anew.
+	if (erase.size() < m_order.size())
+		m_order.clear();
+
+	const size_t known = m_order.size();
+
+	m_remap.resize(erase.size());
+	uint32_t kept = 0;
+	for (size_t i = 0; i < erase.size(); i++)
+		m_remap[i] = erase[i] ? NONE : kept++;
+
+	size_t ranked = 0;
+	for (uint32_t const index : m_order)
+	{
+		if (m_remap[index] != NONE)
+			m_order[ranked++] = m_remap[index];
+	}
+	m_order.resize(ranked);
+
+	for (size_t i = known; i < erase.size(); i++)
+	{
+		if (m_remap[i] != NONE)
+			m_order.push_back(m_remap[i]);
+	}
+}
+
+void MassOrder::Repair()
+{
+	// Keep a non-increasing run and lift out whichever of a pair breaks it: the body just kept when the new one still
+	// fits below its predecessor (it got lighter), otherwise the new one (it got heavier).
+	m_kept.clear();
+	m_moved.clear();
+	for (uint32_t const index : m_order)
+	{
+		const float mass = m_mass[index];
+		const size_t size = m_kept.size();
+
+		if (size == 0 || mass <= m_mass[m_kept[size - 1]])
+			m_kept.push_back(index);
+		else if (size > 1 && mass <= m_mass[m_kept[size - 2]])
+		{
+			m_moved.push_back(m_kept[size - 1]);
+			m_kept[size - 1] = index;
+		}
+		else
+			m_moved.push_back(index);
+	}
+
+	if (!m_moved.empty())
+	{
+		const auto heavier = [this](uint32_t const a, uint32_t const b) { return m_mass[a] > m_mass[b]; };
+
+		std::stable_sort(m_moved.begin(), m_moved.end(), heavier);
+		std::merge(m_kept.begin(), m_kept.end(), m_moved.begin(), m_moved.end(), m_order.begin(), heavier);
+	}
+
+	m_rank.resize(m_order.size());
+	for (size_t r = 0; r < m_order.size(); r++)
+		m_rank[m_order[r]] = static_cast<uint32_t>(r);
+}
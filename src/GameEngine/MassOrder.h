@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Indices of the bodies from heaviest to lightest, kept next to a body array that stays in creation order. Between
+// frames only a few masses change (collisions, escape) and bodies are only appended or removed, so the order is
+// repaired rather than re-sorted: the bodies that broke it are lifted out, sorted among themselves and merged back,
+// O(N + k log k) for k of them and one linear pass when nothing moved.
+class MassOrder
+{
+public:
+	// Follows a compaction of the bodies that dropped those whose erase flag is set and kept the others in order;
+	// bodies past the ones known so far are new and get ranked. massOf(i) is the mass of the body now at index i.
+	template <typename MassOf>
+	void Update(std::vector<uint8_t> const& erase, MassOf const& massOf)
+	{
+		Compact(erase);
+
+		m_mass.resize(m_order.size());
+		for (size_t i = 0; i < m_mass.size(); i++)
+			m_mass[i] = massOf(i);
+
+		Repair();
+	}
+
+	// Forgets the bodies, the next update ranks all of them anew.
+	void Clear() { m_order.clear(); m_rank.clear(); }
+
+	[[nodiscard]] size_t Size() const { return m_order.size(); }
+
+	// Index of the body at rank, 0 being the heaviest.
+	[[nodiscard]] uint32_t operator[](size_t const rank) const { return m_order[rank]; }
+
+	// Rank of the body at index.
+	[[nodiscard]] uint32_t Rank(size_t const index) const { return m_rank[index]; }
+
+private:
+	void Compact(std::vector<uint8_t> const& erase);
+	void Repair();
+
+	std::vector<uint32_t> m_order;
+	std::vector<uint32_t> m_rank;
+
+	// Scratch, kept to avoid reallocating every frame.
+	std::vector<float> m_mass;
+	std::vector<uint32_t> m_remap, m_kept, m_moved;
+};
@@ -121,6 +121,9 @@ struct Composition
 	float Bohrium;
 	float Hassium;
 	float Meitnerium;
+
+	// Pads Composition<float> to 112 lanes, whole AVX registers on the CPU.
+	float padding[3];
 };
 
 struct Instance
@@ -141,6 +144,16 @@ struct Instance
 	Material material;
 };
 
+// Far field of one occupied quadrant, as Buffers::Quadrant: mass and quadrupole are multiplied by G in screen units.
+struct Quadrant
+{
+	int3 cell;
+	float mass;
+	float3 center;
+	float3 diagonal;
+	float3 offDiagonal;
+};
+
 struct InstanceDescription
 {
 	Instance instance;
@@ -0,0 +1,412 @@
+#include "ParticleMeshSolver.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+
+namespace
+{
+	typedef std::complex<double> Complex;
+
+	constexpr uint32_t MIN_GRID = 8;
+	constexpr size_t SHORT_RANGE_TABLE = 1024;
+	constexpr size_t ITEMS_PER_TASK = 256;
+
+	double Milliseconds(std::chrono::high_resolution_clock::time_point const start)
+	{
+		return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+	}
+
+	template <typename F>
+	void ForEach(size_t const count, F const& f)
+	{
+		parallel_for(0, count, ITEMS_PER_TASK, f);
+	}
+}
+
+ParticleMeshSolver::ParticleMeshSolver(double const cellSize, uint32_t const maxGrid) :
+	m_cellSize(1),
+	m_maxGrid(MIN_GRID)
+{
+	SetCellSize(cellSize);
+	SetMaxGrid(maxGrid);
+}
+
+void ParticleMeshSolver::SetCellSize(double const cellSize)
+{
+	m_cellSize = cellSize > 0 ? cellSize : 1;
+}
+
+void ParticleMeshSolver::SetMaxGrid(uint32_t const maxGrid)
+{
+	m_maxGrid = MIN_GRID;
+	while (m_maxGrid * 2 <= maxGrid)
+		m_maxGrid *= 2;
+}
+
+void ParticleMeshSolver::Accelerate(GravityBodies const& bodies)
+{
+	m_stats = {};
+
+	auto start = std::chrono::high_resolution_clock::now();
+	Gather(bodies);
+
+	if (!m_index.empty())
+	{
+		PrepareKernel();
+		Deposit();
+	}
+
+	m_stats.buildTime = Milliseconds(start);
+	start = std::chrono::high_resolution_clock::now();
+
+	if (!m_index.empty())
+	{
+		Convolve();
+		Interpolate();
+		ShortRange();
+	}
+
+	std::fill(bodies.ax, bodies.ax + bodies.count, 0.);
+	std::fill(bodies.ay, bodies.ay + bodies.count, 0.);
+	std::fill(bodies.az, bodies.az + bodies.count, 0.);
+
+	for (size_t k = 0; k < m_index.size(); k++)
+	{
+		const uint32_t i = m_index[k];
+
+		bodies.ax[i] = m_ax[k] * G_SCREEN;
+		bodies.ay[i] = m_ay[k] * G_SCREEN;
+		bodies.az[i] = m_az[k] * G_SCREEN;
+
+		if (m_collision[k])
+			bodies.collision[i] = 1;
+	}
+
+	m_stats.forceTime = Milliseconds(start);
+	m_stats.nodes = static_cast<size_t>(m_grid) * m_grid * m_grid;
+}
+
+void ParticleMeshSolver::Gather(GravityBodies const& bodies)
+{
+	m_index.clear();
+	m_maxRadius = 0;
+	std::fill(m_lower, m_lower + 3, INFINITY);
+	std::fill(m_upper, m_upper + 3, -INFINITY);
+
+	// Massless bodies neither attract nor get attracted in the shader.
+	for (uint32_t i = 0; i < bodies.count; i++)
+	{
+		if (bodies.mass[i] == 0)
+			continue;
+
+		const double p[3] = {bodies.x[i], bodies.y[i], bodies.z[i]};
+		for (int axis = 0; axis < 3; axis++)
+		{
+			m_lower[axis] = std::min(m_lower[axis], p[axis]);
+			m_upper[axis] = std::max(m_upper[axis], p[axis]);
+		}
+
+		m_maxRadius = std::max(m_maxRadius, static_cast<double>(bodies.radius[i]) * S_NORM_INV);
+		m_index.push_back(i);
+	}
+
+	const size_t count = m_index.size();
+	if (count > 0)
+	{
+		// The spacing only ever doubles so the kernel can be reused while the system stays about the same size. The
+		// margin keeps every cloud-in-cell stencil and its central differences inside the valid part of the mesh.
+		const double extent = std::max({m_upper[0] - m_lower[0], m_upper[1] - m_lower[1], m_upper[2] - m_lower[2]});
+
+		m_spacing = m_cellSize;
+		while (extent / m_spacing + 3 > m_maxGrid)
+			m_spacing *= 2;
+
+		m_grid = MIN_GRID;
+		while (m_grid < extent / m_spacing + 3)
+			m_grid *= 2;
+
+		for (int axis = 0; axis < 3; axis++)
+			m_origin[axis] = (m_lower[axis] + m_upper[axis]) * .5 - m_grid * .5 * m_spacing;
+
+		// Short range cells are at least as wide as the cutoff and as the largest possible overlap, so both are
+		// found in adjacent cells. The bodies are sorted by cell, which keeps every cell contiguous in memory.
+		m_cellWidth = std::max(CUTOFF * SPLITTING * m_spacing, 2 * m_maxRadius);
+
+		size_t cells = 1;
+		for (int axis = 0; axis < 3; axis++)
+		{
+			m_cells[axis] = static_cast<uint32_t>((m_upper[axis] - m_lower[axis]) / m_cellWidth) + 1;
+			cells *= m_cells[axis];
+		}
+
+		m_cellStart.assign(cells + 1, 0);
+		m_bodyCell.resize(count);
+		for (size_t k = 0; k < count; k++)
+		{
+			const uint32_t i = m_index[k];
+			m_bodyCell[k] = Cell(bodies.x[i], bodies.y[i], bodies.z[i]);
+			m_cellStart[m_bodyCell[k] + 1]++;
+		}
+
+		for (size_t cell = 0; cell < cells; cell++)
+			m_cellStart[cell + 1] += m_cellStart[cell];
+
+		std::vector<uint32_t> sorted(count);
+		std::vector<uint32_t> fill(m_cellStart.begin(), m_cellStart.end() - 1);
+		for (size_t k = 0; k < count; k++)
+			sorted[fill[m_bodyCell[k]]++] = m_index[k];
+		m_index.swap(sorted);
+	}
+
+	for (auto* values : {&m_x, &m_y, &m_z, &m_mass, &m_radius, &m_ax, &m_ay, &m_az})
+		values->assign(count, 0.);
+	m_collision.assign(count, 0);
+
+	for (size_t k = 0; k < count; k++)
+	{
+		const uint32_t i = m_index[k];
+
+		m_x[k] = bodies.x[i];
+		m_y[k] = bodies.y[i];
+		m_z[k] = bodies.z[i];
+		m_mass[k] = bodies.mass[i];
+		m_radius[k] = static_cast<double>(bodies.radius[i]) * S_NORM_INV;
+	}
+}
+
+uint32_t ParticleMeshSolver::Cell(double const x, double const y, double const z) const
+{
+	const double p[3] = {x, y, z};
+	uint32_t cell[3];
+	for (int axis = 0; axis < 3; axis++)
+		cell[axis] = std::min(static_cast<uint32_t>((p[axis] - m_lower[axis]) / m_cellWidth), m_cells[axis] - 1);
+
+	return (cell[2] * m_cells[1] + cell[1]) * m_cells[0] + cell[0];
+}
+
+void ParticleMeshSolver::PrepareKernel()
+{
+	if (m_kernelGrid == m_grid && m_kernelSpacing == m_spacing)
+		return;
+
+	const size_t size = 2 * static_cast<size_t>(m_grid);
+	const double splitting = SPLITTING * m_spacing;
+	const double alpha = 1 / (2 * splitting);
+	const double cutoff = CUTOFF * splitting;
+
+	m_fft = Fft(size);
+	m_mesh.assign(size * size * size, 0.);
+
+	// Distances wrap around the padded grid so the circular convolution sees every offset up to m_grid in both
+	// directions, which covers any pair of nodes inside the unpadded part.
+	for (size_t z = 0; z < size; z++)
+		for (size_t y = 0; y < size; y++)
+			for (size_t x = 0; x < size; x++)
+			{
+				const double dx = static_cast<double>(std::min(x, size - x));
+				const double dy = static_cast<double>(std::min(y, size - y));
+				const double dz = static_cast<double>(std::min(z, size - z));
+				const double r = sqrt(dx * dx + dy * dy + dz * dz) * m_spacing;
+
+				m_mesh[(z * size + y) * size + x] = r > 0 ? erf(alpha * r) / r : 2 * alpha / sqrt(PI);
+			}
+
+	Transform3D(m_mesh, false, false);
+
+	// The kernel is real and even, so is its transform.
+	const double normalisation = 1. / static_cast<double>(m_mesh.size());
+	m_kernel.resize(m_mesh.size());
+	for (size_t i = 0; i < m_mesh.size(); i++)
+		m_kernel[i] = m_mesh[i].real() * normalisation;
+
+	m_shortRange.resize(SHORT_RANGE_TABLE + 2);
+	for (size_t i = 0; i < m_shortRange.size(); i++)
+	{
+		const double r = cutoff * sqrt(static_cast<double>(i) / SHORT_RANGE_TABLE);
+		m_shortRange[i] = erfc(alpha * r) + 2 * alpha * r / sqrt(PI) * exp(-alpha * alpha * r * r);
+	}
+
+	m_kernelGrid = m_grid;
+	m_kernelSpacing = m_spacing;
+}
+
+void ParticleMeshSolver::Deposit()
+{
+	const size_t size = 2 * static_cast<size_t>(m_grid);
+	const double scale = 1 / m_spacing;
+
+	m_mesh.assign(size * size * size, 0.);
+
+	for (size_t k = 0; k < m_index.size(); k++)
+	{
+		const double u[3] = {
+			(m_x[k] - m_origin[0]) * scale, (m_y[k] - m_origin[1]) * scale, (m_z[k] - m_origin[2]) * scale
+		};
+		const size_t i[3] = {
+			static_cast<size_t>(u[0]), static_cast<size_t>(u[1]), static_cast<size_t>(u[2])
+		};
+		const double f[3] = {u[0] - i[0], u[1] - i[1], u[2] - i[2]};
+
+		for (size_t corner = 0; corner < 8; corner++)
+		{
+			const size_t dx = corner & 1, dy = corner >> 1 & 1, dz = corner >> 2;
+			const double weight = (dx ? f[0] : 1 - f[0]) * (dy ? f[1] : 1 - f[1]) * (dz ? f[2] : 1 - f[2]);
+			m_mesh[((i[2] + dz) * size + i[1] + dy) * size + i[0] + dx] += m_mass[k] * weight;
+		}
+	}
+}
+
+void ParticleMeshSolver::Convolve()
+{
+	Transform3D(m_mesh, false, true);
+
+	ForEach(m_mesh.size(), [this](size_t const i) { m_mesh[i] *= m_kernel[i]; });
+
+	Transform3D(m_mesh, true, true);
+}
+
+void ParticleMeshSolver::Interpolate()
+{
+	const size_t size = 2 * static_cast<size_t>(m_grid);
+	const double scale = 1 / m_spacing;
+	const double difference = 1 / (2 * m_spacing);
+
+	const auto potential = [this, size](size_t const x, size_t const y, size_t const z)
+	{
+		return m_mesh[(z * size + y) * size + x].real();
+	};
+
+	ForEach(m_index.size(), [&](size_t const k)
+	{
+		const double u[3] = {
+			(m_x[k] - m_origin[0]) * scale, (m_y[k] - m_origin[1]) * scale, (m_z[k] - m_origin[2]) * scale
+		};
+		const size_t i[3] = {
+			static_cast<size_t>(u[0]), static_cast<size_t>(u[1]), static_cast<size_t>(u[2])
+		};
+		const double f[3] = {u[0] - i[0], u[1] - i[1], u[2] - i[2]};
+
+		double a[3] = {};
+		for (size_t corner = 0; corner < 8; corner++)
+		{
+			const size_t dx = corner & 1, dy = corner >> 1 & 1, dz = corner >> 2;
+			const size_t x = i[0] + dx, y = i[1] + dy, z = i[2] + dz;
+			const double weight = (dx ? f[0] : 1 - f[0]) * (dy ? f[1] : 1 - f[1]) * (dz ? f[2] : 1 - f[2]);
+
+			a[0] += weight * (potential(x + 1, y, z) - potential(x - 1, y, z));
+			a[1] += weight * (potential(x, y + 1, z) - potential(x, y - 1, z));
+			a[2] += weight * (potential(x, y, z + 1) - potential(x, y, z - 1));
+		}
+
+		m_ax[k] = a[0] * difference;
+		m_ay[k] = a[1] * difference;
+		m_az[k] = a[2] * difference;
+	});
+}
+
+void ParticleMeshSolver::ShortRange()
+{
+	const double cutoff = CUTOFF * SPLITTING * m_spacing;
+	const double cutoff2 = cutoff * cutoff;
+	const double table = SHORT_RANGE_TABLE / cutoff2;
+	const size_t plane = static_cast<size_t>(m_cells[0]) * m_cells[1];
+	std::atomic<uint64_t> interactions{0};
+
+	ForEach(m_index.size(), [&](size_t const k)
+	{
+		const double xi = m_x[k], yi = m_y[k], zi = m_z[k], ri = m_radius[k];
+		const uint32_t cell = Cell(xi, yi, zi);
+		const int64_t cx = cell % m_cells[0], cy = cell / m_cells[0] % m_cells[1], cz = cell / plane;
+
+		double a[3] = {};
+		uint64_t pairs = 0;
+
+		for (int64_t z = std::max<int64_t>(cz - 1, 0); z <= std::min<int64_t>(cz + 1, m_cells[2] - 1); z++)
+			for (int64_t y = std::max<int64_t>(cy - 1, 0); y <= std::min<int64_t>(cy + 1, m_cells[1] - 1); y++)
+			{
+				// Cells adjacent along x are adjacent in memory as well.
+				const size_t row = z * plane + y * m_cells[0];
+				const uint32_t first = m_cellStart[row + std::max<int64_t>(cx - 1, 0)];
+				const uint32_t last = m_cellStart[row + std::min<int64_t>(cx + 1, m_cells[0] - 1) + 1];
+
+				for (uint32_t j = first; j < last; j++)
+				{
+					const double dx = m_x[j] - xi;
+					const double dy = m_y[j] - yi;
+					const double dz = m_z[j] - zi;
+					const double r2 = dx * dx + dy * dy + dz * dz;
+
+					const double reach = ri + m_radius[j];
+					if (r2 <= reach * reach && j != k)
+						m_collision[k] = 1;
+
+					if (r2 >= cutoff2 || r2 <= 0)
+						continue;
+
+					const double t = r2 * table;
+					const auto index = static_cast<size_t>(t);
+					const double factor = m_shortRange[index] + (t - index) * (m_shortRange[index + 1] - m_shortRange[index]);
+
+					const double inv = 1 / sqrt(r2);
+					const double s = m_mass[j] * factor * inv * inv * inv;
+					a[0] += dx * s;
+					a[1] += dy * s;
+					a[2] += dz * s;
+					pairs++;
+				}
+			}
+
+		m_ax[k] += a[0];
+		m_ay[k] += a[1];
+		m_az[k] += a[2];
+		interactions.fetch_add(pairs, std::memory_order_relaxed);
+	});
+
+	m_stats.interactions = interactions.load();
+}
+
+void ParticleMeshSolver::Transform3D(std::vector<Complex>& grid, bool const inverse, bool const padded)
+{
+	const size_t size = m_fft.Size();
+	const size_t half = padded ? size / 2 : size;
+
+	// Along one axis, for the lines whose other two coordinates are below the given limits. On the padded grid only
+	// the lower half of every axis holds mass before the forward transform, and only the lower half of the potential
+	// is needed after the inverse one, so the lines outside it are skipped.
+	const auto pass = [&](size_t const stride, size_t const strideA, size_t const limitA, size_t const strideB,
+	                      size_t const limitB)
+	{
+		parallel_for(0, limitB, 1, [&](size_t const b)
+		{
+			std::vector<Complex> line(size);
+			for (size_t a = 0; a < limitA; a++)
+			{
+				Complex* start = &grid[a * strideA + b * strideB];
+				for (size_t i = 0; i < size; i++)
+					line[i] = start[i * stride];
+
+				m_fft.Transform(line.data(), inverse);
+
+				for (size_t i = 0; i < size; i++)
+					start[i * stride] = line[i];
+			}
+		});
+	};
+
+	const size_t plane = size * size;
+	if (!inverse)
+	{
+		pass(1, size, half, plane, half);
+		pass(size, 1, size, plane, half);
+		pass(plane, 1, size, size, size);
+	}
+	else
+	{
+		pass(plane, 1, size, size, size);
+		pass(size, 1, size, plane, half);
+		pass(1, size, half, plane, half);
+	}
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include "Fft.h"
+#include "GravitySolver.h"
+
+#include <vector>
+
+// Particle-particle particle-mesh (P3M) gravity. The 1/r interaction is split into a smooth long range part
+// erf(r / 2rs) / r and a short range remainder erfc(r / 2rs) / r. The long range part is solved on a mesh: masses are
+// deposited with cloud-in-cell weights, convolved with the kernel by FFT on a zero padded grid (isolated boundaries,
+// no periodic images), differentiated by central differences and interpolated back with the same weights. The short
+// range part is summed directly over the bodies within the cutoff using a cell list, which also yields the exact
+// collision flags. Cost is O(N + G log G) for a mesh of G cells.
+class ParticleMeshSolver final : public GravitySolver
+{
+public:
+	// cellSize is the finest mesh spacing in screen units; it is doubled until the system fits into maxGrid cells.
+	explicit ParticleMeshSolver(double cellSize = 1, uint32_t maxGrid = 64);
+
+	void Accelerate(GravityBodies const& bodies) override;
+	[[nodiscard]] const char* Name() const override { return "P3M"; }
+
+	void SetCellSize(double cellSize);
+	[[nodiscard]] double GetCellSize() const { return m_cellSize; }
+
+	void SetMaxGrid(uint32_t maxGrid);
+	[[nodiscard]] uint32_t GetMaxGrid() const { return m_maxGrid; }
+
+	// Mesh cells per axis of the last pass.
+	[[nodiscard]] uint32_t GetGrid() const { return m_grid; }
+
+	// Splitting scale rs in mesh cells and short range cutoff in units of rs.
+	static constexpr double SPLITTING = 1.25;
+	static constexpr double CUTOFF = 4.5;
+
+private:
+	void Gather(GravityBodies const& bodies);
+	void Deposit();
+	void Convolve();
+	void Interpolate();
+	void ShortRange();
+	void PrepareKernel();
+	void Transform3D(std::vector<std::complex<double>>& grid, bool inverse, bool padded);
+	[[nodiscard]] uint32_t Cell(double x, double y, double z) const;
+
+	double m_cellSize;
+	uint32_t m_maxGrid;
+
+	// Mesh of the current pass: m_grid nodes per axis spaced m_spacing apart, padded to twice that size.
+	uint32_t m_grid = 0;
+	double m_spacing = 0;
+	double m_origin[3] = {};
+	std::vector<std::complex<double>> m_mesh;
+
+	// Fourier transform of the long range kernel, including the 1 / size normalisation of the inverse FFT.
+	uint32_t m_kernelGrid = 0;
+	double m_kernelSpacing = 0;
+	std::vector<double> m_kernel;
+	Fft m_fft;
+
+	// Short range force factor as a function of (r / cutoff)^2, multiplied with m / r^3.
+	std::vector<double> m_shortRange;
+
+	// Cell list for the short range pass, the bodies of cell c are [m_cellStart[c], m_cellStart[c + 1]).
+	double m_cellWidth = 0;
+	uint32_t m_cells[3] = {};
+	std::vector<uint32_t> m_cellStart;
+	std::vector<uint32_t> m_bodyCell; // scratch for the counting sort
+
+	// Live bodies only, sorted by cell.
+	double m_maxRadius = 0;
+	double m_lower[3] = {};
+	double m_upper[3] = {};
+	std::vector<uint32_t> m_index;
+	std::vector<double> m_x, m_y, m_z, m_mass, m_radius;
+	std::vector<double> m_ax, m_ay, m_az;
+	std::vector<uint8_t> m_collision;
+};
@@ -0,0 +1,63 @@
+#pragma once
+
+constexpr double PI = 3.1415926535897932384626433832795028841971693993751058209749445923078164062;
+constexpr double PI_RAD = PI / 180.;
+constexpr double PI_SQ = 4 * PI;
+constexpr double PI_CB = (4 / 3.) * PI;
+
+constexpr double G = 6.673e-11; // gravitational constant (m3)
+constexpr double c = 2.99792458e8; // speed of light (ms-1)
+constexpr double h = 6.62607004e-34; // Planck's constant (m2 kg / s)
+constexpr double eV = 1.60218e-19; // electron volt(J)
+constexpr double Rh = 2.179e-18; // Rydberg constant for H (J)
+constexpr double sigma = 5.670374419e-8; //Stefan–Boltzmann constant (W⋅m−2⋅K−4)
+constexpr double kB = 1.38064852e-23; // Boltzmann constant (m2 kg s-2 K-1)
+constexpr double Mu = .99999999965; // Molar mass constant (g mol-1)
+constexpr double Na = 6.02214086e23; // Avogadro constant (mol-1)
+constexpr double Da = 1.66053906660e-27; // Dalton / unified atomic mass unit
+constexpr double R = Na * kB; // Gas constant
+
+constexpr double EPSILON = 1.e-7;
+
+constexpr double SOLAR_LUMINOSITY = 3.828e26; // (W)
+
+constexpr double SUN_MASS = 1.989e30;
+constexpr double SUN_DIAMETER = 1392680000; // m
+
+constexpr double QUADRANT_SIZE = SUN_DIAMETER * 2.; // m
+const double SYSTEM_MASS = SUN_MASS * 1.0014;
+
+constexpr double EARTH_MASS = 5.97219e24;
+constexpr double EARTH_DIAMETER = 1.6742e7; // m
+constexpr double EARTH_SUN_DIST = 1.496e11; // m
+constexpr double EARTH_SUN_VELOCITY = 29780; // (m/s)
+
+constexpr double MOON_MASS = 7.34767309e22;
+constexpr double MOON_DIAMETER = 3.4742e6; // m
+constexpr double MOON_EARTH_DIST = 3.844e8; // m
+constexpr double MOON_EARTH_VELOCITY = 284; // (m/s)
+
+constexpr double JUPITER_MASS = 1.899e27;
+constexpr double JUPITER_DIAMETER = 1.42984e8; // m
+constexpr double JUPITER_SUN_DIST = 7.7841e11; // m
+constexpr double JUPITER_SUN_VELOCITY = 13070; // (m/s)
+
+constexpr double PLUTO_SUN_DIST = 5.9068e12; // m
+
+constexpr double S_NORM = 1.e9;
+constexpr double S_NORM_INV = 1. / S_NORM;
+constexpr double MASS_RADIUS_NORM = 2.24471369068046E-06;
+constexpr double MASS_RADIUS_OFFSET = 1130654.3672034;
+
+const double ELEMENTAL_WEIGHT[109] // (g/mol)
+{
+	1.008, 4.003, 6.941, 9.012, 10.811, 12.011, 14.007, 15.999, 18.998, 20.18, 22.99,
+	24.305, 26.982, 28.086, 30.974, 32.065, 35.453, 39.948, 39.098, 40.078, 44.956, 47.867,
+	50.942, 51.996, 54.938, 55.845, 58.933, 58.693, 63.546, 65.39, 69.723, 72.64, 74.922,
+	78.96, 79.904, 83.8, 85.468, 87.62, 88.906, 91.224, 92.906, 95.94, 98, 101.07, 102.906,
+	106.42, 107.868, 112.411, 114.818, 118.71, 121.76, 127.6, 126.905, 131.293, 132.906, 137.327,
+	138.906, 140.116, 140.908, 144.24, 145, 150.36, 151.964, 157.25, 158.925, 162.5, 164.93,
+	167.259, 168.934, 173.04, 174.967, 178.49, 180.948, 183.84, 186.207, 190.23, 192.217, 195.078,
+	196.967, 200.59, 204.383, 207.2, 208.98, 209, 210, 222, 223, 226, 227, 232.038, 231.036, 238.029,
+	237, 244, 243, 247, 247, 251, 252, 257, 258, 259, 262, 261, 262, 266, 264, 277, 268
+};
@@ -187,15 +187,15 @@ Composition GetCollisionComposition(InstanceDescription description1, InstanceDe
 		return description2.composition;
 	if (description2.instance.mass == 0)
 		return description1.composition;
-	float a[109] = (float[109])description1.composition;
-	float b[109] = (float[109])description2.composition;
+	float a[112] = (float[112])description1.composition;
+	float b[112] = (float[112])description2.composition;
 
 	/*float c[109];
 		for (int i = 0; i < 109; i++)
 		    c[i] = description1.instance.mass * a[i] + description2.instance.mass * b[i];*/
 
-	float c[109];
-	for (int i = 0; i < 109; i++)
+	float c[112];
+	for (int i = 0; i < 112; i++)
 		c[i] = a[i] + b[i];
 
 	composition = (Composition)c;
@@ -207,7 +207,7 @@ float3 GetCompositionColor(Composition composition)
 {
 	float3 color = float3(0, 0, 0);
 
-	float c[109] = (float[109])composition;
+	float c[112] = (float[112])composition;
 	for (int i = 0; i < 109; i++)
 		color += (ATOM_COLORS[i].xyz) * c[i];
 
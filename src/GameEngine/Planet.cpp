@@ -2,6 +2,8 @@
 
 #include "StepTimer.h"
 #include "Planet.h"
+#include "Random.h"
+#include "SolarSystem.h"
 
 using namespace std;
 using namespace DirectX;
@@ -13,13 +15,26 @@ using Microsoft::WRL::ComPtr;
 template struct Composition<float>;
 template struct Composition<double>;
 
+namespace
+{
+	Vector3 RandomAngular(uint32_t const id)
+	{
+		Random random(g_seed, RandomStream::Rotation, id);
+
+		const float x = random.Uniform(0.f, 1.f);
+		const float y = random.Uniform(0.f, 1.f);
+		const float z = random.Uniform(0.f, 1.f);
+		return Vector3(x, y, z) * random.Uniform(1e-3f, 1e-6f);
+	}
+}
+
 Planet::Planet(const double mass, double density, double temperature, const Vector3 position, const Vector3 direction,
                const float velocity) :
-	id(rand() * rand()),
+	id(g_handles.Create()),
 	position(position),
 	direction(Vector3::Zero),
 	velocity(direction * velocity),
-	angular(randv(0, 1) * rand(1e-3f, 1e-6f)),
+	angular(RandomAngular(id)),
 	radius(RadiusByMass(mass)),
 	mass(static_cast<float>(mass)),
 	temperature(static_cast<float>(temperature)),
@@ -39,37 +54,22 @@ Planet::Planet(const double mass, double density, double temperature, const Vect
 
 float Planet::RadiusByMass(double mass)
 {
-	double r = sqrt(mass) * MASS_RADIUS_NORM + MASS_RADIUS_OFFSET;
-	r -= ((pow(mass, 2) * G) / mass) * 1.861399E-11;
-
-	return static_cast<float>(r);
+	return static_cast<float>(EstimateRadius(mass));
 }
 
-std::string Planet::GetQuadrant() const
+ProfileLayers Planet::GetDensityProfile()
 {
-	const Vector3 p = position * S_NORM / static_cast<float>(g_quadrantSize);
-
-	const std::string x = std::to_string(static_cast<int>(round(p.x)));
-	const std::string y = std::to_string(static_cast<int>(round(p.y)));
-	const std::string z = std::to_string(static_cast<int>(round(p.z)));
-
-	std::string f = x + "|" + y + "|" + z;
-	return f;
-}
-
-std::vector<DepthInfo>& Planet::GetDensityProfile()
-{
-	if (g_profiles.find(id) == g_profiles.end())
+	if (!g_profiles.Contains(id))
 	{
-		// Current object Properties
-		auto& tComposition = g_compositions[id].As<double>();
-
 		auto const step = static_cast<size_t>(round(pow(static_cast<double>(mass) * 1e-9, .35)));
-		auto const size = sizeof(Composition<float>) / sizeof(float);
+		auto constexpr size = Composition<float>::size();
 		double usedMass = 0, usedVolume = 0;
 
-		if (step == 0 || g_compositions.find(id) == g_compositions.end())
-			return std::vector<DepthInfo>();
+		if (step == 0 || !g_compositions.Contains(id))
+			return g_profiles.Find(id);
+
+		// Current object Properties
+		const Composition<double> tComposition = g_compositions.Get(id).As<double>();
 
 		std::vector<ElementInfo> store{};
 		for (uint32_t i = 0; i < size; i++)
@@ -81,6 +81,8 @@ std::vector<DepthInfo>& Planet::GetDensityProfile()
 			          return a.weight < b.weight;
 		          });
 
+		Random random(g_seed, RandomStream::DensityProfile, id);
+
 		std::vector<DepthInfo> profile{};
 		int i = 1;
 		double d = static_cast<double>(density), p = 0;
@@ -108,7 +110,7 @@ std::vector<DepthInfo>& Planet::GetDensityProfile()
 				{
 					double use = m > store[j].mass ? store[j].mass : m;
 
-					use *= rand(.5, 1);
+					use *= random.Uniform(.5, 1.);
 
 					ma += (use / info.density) * store[j].density;
 					d += store[j].density * use;
@@ -132,10 +134,18 @@ std::vector<DepthInfo>& Planet::GetDensityProfile()
 		}
 
 		mass = static_cast<float>(usedMass);
-		g_compositions[id] /= g_compositions[id].sum();
-		g_compositions[id] *= mass;
+		g_compositions.Scale(id, mass / g_compositions.Sum(id));
 
-		g_profiles[id] = profile;
+		ProfileLayers const layers = g_profiles.Allocate(id, profile.size());
+		for (size_t l = 0; l < profile.size(); l++)
+		{
+			layers.radius[l] = profile[l].radius;
+			layers.volume[l] = profile[l].volume;
+			layers.mass[l] = profile[l].mass;
+			layers.density[l] = profile[l].density;
+			layers.pressure[l] = profile[l].pressure;
+			LayerComposition(layers, l) = profile[l].composition;
+		}
 
 		RefreshDensityProfile();
 
@@ -151,42 +161,44 @@ std::vector<DepthInfo>& Planet::GetDensityProfile()
 		//}
 	}
 
-	return g_profiles[id];
+	return g_profiles.Find(id);
 }
 
 void Planet::RefreshDensityProfile() const
 {
-	std::vector<DepthInfo>& profile = g_profiles[id];
-
-	double usedVolume = 0, usedMass = 0;
-	for (size_t i = 0; i < profile.size(); i++)
+	// Only looked up, the collision merge refreshes several planets in parallel.
+	ProfileLayers const profile = g_profiles.Find(id);
+
+	// The layers below the first stale one are unchanged, so the sums resume from what they enclose.
+	const size_t first = g_profiles.FirstStale(id);
+	double usedVolume = first > 0 ? profile.enclosedVolume[first - 1] : 0;
+	double usedMass = first > 0 ? profile.enclosedMass[first - 1] : 0;
+	for (size_t i = first; i < profile.count; i++)
 	{
-		DepthInfo& info = profile[i];
-
-		if (i == profile.size() - 1)
-		{
-			info.volume = info.mass / info.density;
-			info.radius = cbrt(((info.volume + usedVolume) / PI) * (3 / 4.));
-		}
+		if (i == profile.count - 1)
+			profile.volume[i] = profile.mass[i] / profile.density[i];
 		else
-		{
-			info.density = info.mass / info.volume;
-		}
+			profile.density[i] = profile.mass[i] / profile.volume[i];
 
-		usedMass += info.mass;
-		info.pressure = (usedMass * G) / pow(info.radius, 2);
+		usedMass += profile.mass[i];
+		usedVolume += profile.volume[i];
+		profile.enclosedMass[i] = usedMass;
+		profile.enclosedVolume[i] = usedVolume;
 
-		usedVolume += info.volume;
+		profile.radius[i] = cbrt((usedVolume / PI) * (3 / 4.));
+		profile.pressure[i] = (usedMass * G) / pow(profile.radius[i], 2);
 	}
+
+	g_profiles.Validate(id);
 }
 
 std::optional<double> Planet::RadiusByDensity()
 {
-	std::vector<DepthInfo> const& profile = GetDensityProfile();
+	ProfileLayers const profile = GetDensityProfile();
 
-	if (!profile.empty())
+	if (!profile.Empty())
 	{
-		const double r = profile[profile.size() - 1].radius;
+		const double r = profile.radius[profile.count - 1];
 		return r;
 	}
 
@@ -195,22 +207,30 @@ std::optional<double> Planet::RadiusByDensity()
 
 std::optional<double> Planet::MassByDensity()
 {
-	std::vector<DepthInfo> const& profile = GetDensityProfile();
+	ProfileLayers const profile = GetDensityProfile();
+	if (profile.Empty())
+		return std::nullopt;
 
+	// A refreshed profile holds its total as the mass the top layer encloses.
 	double m = 0;
-	for (DepthInfo const& info : profile)
-		m += info.mass;
+	if (g_profiles.FirstStale(id) == profile.count)
+		m = profile.enclosedMass[profile.count - 1];
+	else
+	{
+		for (size_t l = 0; l < profile.count; l++)
+			m += profile.mass[l];
+	}
 
 	if (m > 0) return m;
 	return std::nullopt;
 }
 
-void Planet::Update(float const deltaTime)
+bool Planet::Escape(float const deltaTime)
 {
-	auto m = MassByDensity(), r = RadiusByDensity();
+	ProfileLayers profile = g_profiles.Find(id);
 
-	if (!m.has_value() || !r.has_value() || g_compositions.find(id) == g_compositions.end())
-		return;
+	if (profile.Empty() || !MassByDensity().has_value() || !g_compositions.Contains(id))
+		return false;
 
 	// Stellar properties
 	//Planet const star = g_planets[0];
@@ -219,139 +239,65 @@ void Planet::Update(float const deltaTime)
 	//double const sLuminosity = PI_SQ * pow(sRadius, 2) * sigma * pow(5778., 4); // TEMP SUN in Kelvin = 5778.
 
 	// Current object Properties
-	//double const tMass = m.value();
-	//double const tRadius = r.value();
-	//double const tVolume = pow(tRadius, 3) * PI_CB;
 	//double const tDistance = static_cast<double>(Vector3::Distance(star.position, position)) * S_NORM; // Distance to star (alpha)
-	std::vector<DepthInfo>& tProfile = g_profiles[id];
-	std::vector<DepthInfo> refProfile = g_profiles[id];
-
-	//const double alpha = sqrt(pow(star.position.x - planet.position.x, 2) + pow(star.position.y - planet.position.y, 2) + pow(star.position.z - planet.position.z, 2));
 	//const double Ab = static_cast<double>(material.color.x) + static_cast<double>(material.color.y) + static_cast<double>(material.color.z) / 3.; // Bond albedo (https://en.wikipedia.org/wiki/Bond_albedo); Earth = .306
 	//const double T = pow(sLuminosity * (1 - Ab) / (16 * sigma * PI * pow(alpha, 2)), 1 / 4.); // Planetary equilibrium temperature
 
-	bool lostToSpace = false;
-	double insideMass = 0;
-	for (size_t j = 0; j < tProfile.size(); j++)
-	{
-		DepthInfo& layer = tProfile[j];
-		DepthInfo const& layerRef = refProfile[j];
-
-		insideMass += layerRef.mass;
-
-		double const pEscape = sqrt((2 * G * insideMass) / layerRef.radius);
-		//double const aK = (layerRef.pressure * layerRef.volume) / (2 / 3.);
-
-		for (size_t i = 0; i < layer.composition.size(); i++)
-		{
-			std::string const name = ELEMENTAL_SYMBOLS[i];
-			double const layerParticleMass = layerRef.composition.data()[i];
-			if (layerParticleMass > 0) //&& ELEMENTAL_GOLDSCHMIDT[i] == 0
-			{
-				double const nParticles = layerParticleMass / (ELEMENTAL_WEIGHT[i] / Na);
-				//double const nT = (layerRef.pressure * layerRef.volume) / R;
-				double const tParticle = (layerRef.pressure * layerRef.volume) / (nParticles * R);
-
-				double vParticle = sqrt(3 * (kB * tParticle / layerParticleMass));
-				vParticle = rand(vParticle * .5, vParticle * 1.5);
-
-				//const double k = .5 * (values[i]) * pow(vParticle, 2); // - boundMass
-				//const double v = sqrt(3 * k * T / massPlanet);
-
-				double escapeRatio = sqrt(abs(vParticle - pEscape) / max(vParticle, pEscape)) *
-					(static_cast<double>(deltaTime) / 3600.);
-				escapeRatio = escapeRatio < 1 ? escapeRatio : 1;
-				const double change = layerParticleMass * escapeRatio;
-
-				if (vParticle > pEscape)
-				{
-					// inner layers
-					if (j < tProfile.size() - 1)
-					{
-						DepthInfo& layerUp = tProfile[j + 1];
-						layerUp.composition.data()[i] += change;
-					}
-						// most outer layer
-					else lostToSpace = true;
-
-					layer.composition.data()[i] -= change;
-				}
-				else
-				{
-					// outer layers
-					if (j > 0)
-					{
-						DepthInfo& layerDown = tProfile[j - 1];
-						layerDown.composition.data()[i] += change;
-
-						layer.composition.data()[i] -= change;
-					}
-				}
-			}
-		}
-	}
-
-	for (unsigned long long j = tProfile.size() - 1; j > 0; j--)
-	{
-		DepthInfo& layer = tProfile[j];
-
-		for (size_t i = 0; i < layer.composition.size(); i++)
-		{
-			if (layer.composition.data()[i] < 0 || isnan(layer.composition.data()[i]))
-				layer.composition.data()[i] = 0;
-		}
-		layer.mass = layer.composition.sum();
+	// Mass moves between all neighbouring layers, so the whole profile is refreshed.
+	bool lostToSpace = g_escape.Evolve(profile, deltaTime) > 0;
+	g_profiles.Invalidate(id, 0);
 
-		if (isnan(layer.mass))
-			int a = 0;
+	g_profiles.EraseLayers(id, [&profile](size_t const l) { return l > 0 && profile.mass[l] < EPSILON; });
+	profile = g_profiles.Find(id);
 
-		if (layer.mass < EPSILON)
-		{
-			if (j > 0) tProfile.erase(tProfile.begin() + j);
-		}
-	}
+	RefreshDensityProfile();
 
-	// Write values back only on change
-	if (lostToSpace && !tProfile.empty())
+	lostToSpace = lostToSpace && !profile.Empty();
+	if (lostToSpace)
 	{
-		Composition<double> values = {};
-		for (auto& info : tProfile)
-			values += info.composition;
-
-		m = MassByDensity();
+		const auto m = MassByDensity();
 		mass = m.has_value() ? static_cast<float>(m.value()) : 0;
-
-		g_compositions[id] = values.As<float>();
 	}
 
-	RefreshDensityProfile();
-
-	r = RadiusByDensity();
+	const auto r = RadiusByDensity();
 	radius = static_cast<float>(r.has_value() ? r.value() : 1);
 
-	if (!tProfile.empty())
-		material.color = tProfile[tProfile.size() - 1].composition.GetColor();
+	if (!profile.Empty())
+		material.color = LayerComposition(profile, profile.count - 1).GetColor();
 
 	//const double sLuminosity = PI_SQ * pow(planet.radius, 2) * sigma * pow(5778., 4); // TEMP SUN in Kelvin = 5778.
 	if (static_cast<double>(mass) > SUN_MASS * .4)
 		material.Ka = Vector3(1);
 	//else material.Ka = Vector3(.2);
+
+	return lostToSpace;
+}
+
+void Planet::StoreComposition() const
+{
+	ProfileLayers const profile = g_profiles.Find(id);
+
+	Composition<double> values = {};
+	for (size_t j = 0; j < profile.count; j++)
+		values += LayerComposition(profile, j);
+
+	g_compositions.Set(id, values.As<float>());
 }
 
 template <typename T>
 void Composition<T>::Randomize(const Planet& planet)
 {
-	size_t const s = sizeof(Composition<T>) / sizeof(T);
+	size_t constexpr s = size();
 	std::array<T, s> values = {};
 	ZeroMemory(values.data(), sizeof(T) * values.size());
 
 	const double* rVector = planet.mass > EARTH_MASS * 10 ? ELEMENTAL_ABUNDANCE : ELEMENTAL_ABUNDANCE_T;
 
+	std::array<double, s> uniform = {};
+	Random(g_seed, RandomStream::Composition, planet.id).Fill(uniform.data(), s, 0., 2.);
+
 	for (int i = 0; i < s; i++)
-	{
-		double a = rVector[i];
-		values[i] = rand(0, a * 2.);
-	}
+		values[i] = static_cast<T>(uniform[i] * rVector[i]);
 
 	normalize(values);
 
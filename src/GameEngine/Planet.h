@@ -1,5 +1,7 @@
 #pragma once
 
+#include "Composition.h"
+#include "ProfileArena.h"
 #include "StepTimer.h"
 
 #include <array>
@@ -11,7 +13,7 @@ typedef struct ColorProfile;
 struct Planet
 {
 public:
-	Planet() : id(rand() * rand())
+	Planet() : id(0)
 	{
 		//ZeroMemory(this, sizeof(this));
 	}
@@ -64,7 +66,6 @@ public:
 		float alpha;
 	} material{};
 
-	std::string GetQuadrant() const;
 
 	const DirectX::SimpleMath::Vector3 GetPosition() const { return position; }
 	double GetScreenSize() const { return (radius / S_NORM) * 2.; }
@@ -74,242 +75,29 @@ public:
 	double GetVolume() const { return pow(GetRadius(), 3) * PI_CB; }
 	double GetDensity() const { return GetMass() / GetVolume(); }
 
-	std::vector<DepthInfo>& GetDensityProfile();
+	ProfileLayers GetDensityProfile();
+
+	// Solves density, radius and pressure again from the first layer g_profiles holds stale, outward.
 	void RefreshDensityProfile() const;
-	void Update(float deltaTime);
+
+	// One step of atmospheric escape on the density profile, which has to exist already. Touches only this planet and
+	// its layers, so planets can run it in parallel. Returns whether mass escaped and StoreComposition is due.
+	bool Escape(float deltaTime);
+
+	// Sums the layers of the profile into the planet's composition.
+	void StoreComposition() const;
+
 	std::optional<double> RadiusByDensity();
 	std::optional<double> MassByDensity();
 
 	static float RadiusByMass(double mass);
 };
 
-template <typename T>
-struct Composition
+// The element masses of a profile layer, stored in the arena in Composition's field order.
+inline Composition<double>& LayerComposition(ProfileLayers const& layers, size_t const layer)
 {
-	T Hydrogen;
-	T Helium;
-	T Lithium;
-	T Beryllium;
-	T Boron;
-	T Carbon;
-	T Nitrogen;
-	T Oxygen;
-	T Fluorine;
-	T Neon;
-	T Sodium;
-	T Magnesium;
-	T Aluminum;
-	T Silicon;
-	T Phosphorus;
-	T Sulfur;
-	T Chlorine;
-	T Argon;
-	T Potassium;
-	T Calcium;
-	T Scandium;
-	T Titanium;
-	T Vanadium;
-	T Chromium;
-	T Manganese;
-	T Iron;
-	T Cobalt;
-	T Nickel;
-	T Copper;
-	T Zinc;
-	T Gallium;
-	T Germanium;
-	T Arsenic;
-	T Selenium;
-	T Bromine;
-	T Krypton;
-	T Rubidium;
-	T Strontium;
-	T Yttrium;
-	T Zirconium;
-	T Niobium;
-	T Molybdenum;
-	T Technetium;
-	T Ruthenium;
-	T Rhodium;
-	T Palladium;
-	T Silver;
-	T Cadmium;
-	T Indium;
-	T Tin;
-	T Antimony;
-	T Tellurium;
-	T Iodine;
-	T Xenon;
-	T Cesium;
-	T Barium;
-	T Lanthanum;
-	T Cerium;
-	T Praseodymium;
-	T Neodymium;
-	T Promethium;
-	T Samarium;
-	T Europium;
-	T Gadolinium;
-	T Terbium;
-	T Dysprosium;
-	T Holmium;
-	T Erbium;
-	T Thulium;
-	T Ytterbium;
-	T Lutetium;
-	T Hafnium;
-	T Tantalum;
-	T Tungsten;
-	T Rhenium;
-	T Osmium;
-	T Iridium;
-	T Platinum;
-	T Gold;
-	T Mercury;
-	T Thallium;
-	T Lead;
-	T Bismuth;
-	T Polonium;
-	T Astatine;
-	T Radon;
-	T Francium;
-	T Radium;
-	T Actinium;
-	T Thorium;
-	T Protactinium;
-	T Uranium;
-	T Neptunium;
-	T Plutonium;
-	T Americium;
-	T Curium;
-	T Berkelium;
-	T Californium;
-	T Einsteinium;
-	T Fermium;
-	T Mendelevium;
-	T Nobelium;
-	T Lawrencium;
-	T Rutherfordium;
-	T Dubnium;
-	T Seaborgium;
-	T Bohrium;
-	T Hassium;
-	T Meitnerium;
-
-	//const void Normalize();
-	void Randomize(const Planet& planet);
-	[[nodiscard]] DirectX::SimpleMath::Vector4 GetColor() const;
-
-	T* data() const { return (T*)this; }
-	static size_t size() { return sizeof(Composition<T>) / sizeof(T); }
-
-	T sum() const
-	{
-		T s = 0;
-		for (int i = 0; i < size(); i++)
-			s += data()[i];
-		return s;
-	}
-
-	template <typename A>
-	[[nodiscard]] Composition<A>& As() const
-	{
-		auto* a = new Composition<A>();
-		for (auto i = 0; i < size(); i++)
-			a->data()[i] = data()[i];
-		return *a;
-	}
-
-	template <typename A>
-	Composition<T>& operator=(const Composition<A>& value)
-	{
-		for (int i = 0; i < size(); i++)
-			data()[i] = ((T*)&value)[i];
-
-		return *this;
-	}
-
-	template <typename A, size_t S>
-	Composition<T>& operator=(const std::array<A, S>& value)
-	{
-		for (int i = 0; i < S; i++)
-			data()[i] = ((T*)&value)[i];
-
-		return *this;
-	}
-
-	Composition<T>& operator=(const T& value)
-	{
-		for (int i = 0; i < size(); i++)
-			data()[i] = value;
-
-		return *this;
-	}
-
-	template <typename A>
-	Composition<T>& operator+=(const Composition<A>& value)
-	{
-		for (int i = 0; i < size(); i++)
-			data()[i] += ((T*)&value)[i];
-
-		return *this;
-	}
-
-	template <typename A>
-	friend Composition<T>& operator+(Composition<T> lhs, const Composition<A>& rhs)
-	{
-		lhs += rhs;
-		return lhs;
-	}
-
-	template <typename A>
-	Composition<T>& operator-=(const Composition<A>& value)
-	{
-		for (int i = 0; i < size(); i++)
-			data()[i] -= ((T*)&value)[i];
-
-		return *this;
-	}
-
-	template <typename A>
-	friend Composition<T>& operator-(Composition<T> lhs, const Composition<A>& rhs)
-	{
-		lhs -= rhs;
-		return lhs;
-	}
-
-	template <typename A>
-	Composition<T>& operator*=(const A& value)
-	{
-		for (int i = 0; i < size(); i++)
-			data()[i] *= static_cast<T>(value);
-
-		return *this;
-	}
-
-	template <typename A>
-	friend Composition<T>& operator*(Composition<T> lhs, const A& rhs)
-	{
-		lhs *= rhs;
-		return lhs;
-	}
-
-	template <typename A>
-	Composition<T>& operator/=(const A& value)
-	{
-		for (int i = 0; i < size(); i++)
-			data()[i] /= static_cast<T>(value);
-
-		return *this;
-	}
-
-	template <typename A>
-	friend Composition<T>& operator/(Composition<T> lhs, const A& rhs)
-	{
-		lhs /= rhs;
-		return lhs;
-	}
-};
+	return *reinterpret_cast<Composition<double>*>(layers.Elements(layer));
+}
 
 struct DepthInfo
 {
@@ -389,13 +177,3 @@ struct ElementInfo
 	double density;
 	double mass;
 };
-
-struct PlanetDescription
-{
-	//PlanetDescription(Planet planet, Composition composition) : 
-	//    planet(planet), 
-	//    composition(composition) {};
-
-	Planet planet;
-	Composition<float> composition;
-};
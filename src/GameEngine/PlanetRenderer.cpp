@@ -11,6 +11,7 @@
 #include "Sphere.h"
 #include "Buffers.h"
 #include "SimplexNoise.h"
+#include "ThreadPool.h"
 #include "PlanetRenderer.h"
 
 using namespace std;
@@ -20,6 +21,34 @@ using namespace Buffers;
 
 using Microsoft::WRL::ComPtr;
 
+namespace
+{
+	constexpr size_t PLANETS_PER_TASK = 1024;
+
+	// Frames between two energy measurements of the integrator, each a pairwise pass over the bodies.
+	constexpr uint32_t ENERGY_INTERVAL = 60;
+
+	// Mass weighted position sums for the center of mass, accumulated in double so the result does not depend on the
+	// order of summation beyond rounding.
+	struct MassMoments
+	{
+		double x = 0;
+		double y = 0;
+		double z = 0;
+		double mass = 0;
+		double systemMass = 0;
+		unsigned int collisions = 0;
+
+		MassMoments operator+(MassMoments const& other) const
+		{
+			return {
+				x + other.x, y + other.y, z + other.z, mass + other.mass, systemMass + other.systemMass,
+				collisions + other.collisions
+			};
+		}
+	};
+}
+
 PlanetRenderer::PlanetRenderer() :
 	m_environment(),
 	m_system(),
@@ -48,8 +77,15 @@ PlanetRenderer::PlanetRenderer() :
 	m_distant(),
 	m_computeGravity(10240),
 	m_computePosition(10240),
-	m_computeCollision(10240),
-	m_texturePlanet(360)
+	m_quadrantBuffer(10240),
+	m_texturePlanet(360),
+	m_barnesHut(),
+	m_directSum(),
+	m_fastMultipole(),
+	m_particleMesh(g_quadrantSize * S_NORM_INV),
+	m_bodies(),
+	m_quadrants(g_quadrantSize * S_NORM_INV),
+	m_scheduler(g_profileBudget)
 {
 	CreateDeviceDependentResources();
 }
@@ -60,130 +96,360 @@ void PlanetRenderer::Update(DX::StepTimer const& timer)
 	float time = static_cast<float>(timer.GetTotalSeconds());
 	float deltaTime = g_speed * elapsedTime;
 
-	float x = 0;
-	float y = 0;
-	float z = 0;
-	float totalMass = 0;
-	float systemMass = 0;
-	int noOfPlanets = 0;
+	g_frame++;
+
 	const double massNorm = pow(S_NORM_INV, 3);
 
 	std::vector<Planet*> planets = {};
-	g_collisions = 0;
+	Vector3 centerOfMass;
+	MassMoments moments;
 
 	for (Planet& planet : g_planets)
 	{
 		if (planet.mass != 0 && !(isnan(planet.position.x) || isnan(planet.position.y) || isnan(planet.position.z)))
-		{
 			planets.push_back(&planet);
+	}
 
-			if (planet.id == g_planets[g_current].id)
-				planet.Update(deltaTime);
-			//else if (planet.id == m_cursor)
-			//	planet.Update(deltaTime * g_planets.size());
+	EscapeAtmospheres(planets, deltaTime);
 
-			float mass = planet.mass * massNorm;
+	{
+		StageTimer stageTimer(g_stageTimes, Stage::CenterOfMass);
+
+		moments = parallel_reduce(0, planets.size(), PLANETS_PER_TASK, MassMoments{},
+		                          [&](MassMoments accumulator, size_t const i)
+		                          {
+			                          Planet const& planet = *planets[i];
+			                          double const mass = planet.mass * massNorm;
+
+			                          accumulator.x += planet.position.x * mass;
+			                          accumulator.y += planet.position.y * mass;
+			                          accumulator.z += planet.position.z * mass;
+			                          accumulator.mass += mass;
+			                          accumulator.systemMass += planet.mass;
+			                          accumulator.collisions += planet.collisions;
+			                          return accumulator;
+		                          },
+		                          [](MassMoments const& a, MassMoments const& b) { return a + b; });
+
+		centerOfMass = Vector3(static_cast<float>(moments.x / moments.mass),
+		                       static_cast<float>(moments.y / moments.mass),
+		                       static_cast<float>(moments.z / moments.mass));
+
+		parallel_for(0, planets.size(), PLANETS_PER_TASK, [&](size_t const i) { planets[i]->position -= centerOfMass; });
+	}
 
-			x += planet.position.x * mass;
-			y += planet.position.y * mass;
-			z += planet.position.z * mass;
+	g_collisions = moments.collisions;
+
+	Environment environment = {};
+	environment.deltaTime = elapsedTime * g_speed;
+	environment.totalTime = time;
+	// The mass order is first ranked when the system is built, fall back to a search should it lag the bodies.
+	if (g_massOrder.Size() > 0 && g_massOrder[0] < g_planets.size())
+		environment.light = g_planets[g_massOrder[0]].position;
+	else if (!planets.empty())
+		environment.light = (*max_element(planets.begin(), planets.end(),
+		                                  [](Planet const* a, Planet const* b) { return a->mass < b->mass; }))->position;
+	m_environment.Write(&environment);
 
-			totalMass += mass;
-			systemMass += planet.mass;
-			noOfPlanets++;
+	const Composition<float> composition = g_compositions.Get(planets[g_current]->id);
+	m_composition.Write(&composition);
 
-			planet.quadrantMass = 0;
-			g_collisions += planet.collisions;
-		}
-	}
+	{
+		StageTimer stageTimer(g_stageTimes, Stage::Quadrants);
+		LoadBodies(planets);
+		m_quadrants.Build(m_bodies.Gravity());
+		m_quadrants.Aggregate(m_bodies.Gravity());
 
-	const Vector3 centerOfMass = Vector3(x, y, z) / totalMass;
-	for (Planet* planet : planets)
-		planet->position -= centerOfMass;
+		// The mass ComputeGravityShader sums pairwise, ComputePositionShader adds the cells beyond it from their moments.
+		parallel_for(0, planets.size(), PLANETS_PER_TASK, [&](size_t const i)
+		{
+			planets[i]->quadrantMass = static_cast<float>(m_quadrants.NeighbourMassOf(i));
+		});
 
+		if (GetGravitySolver() == nullptr)
+			LoadQuadrants();
+	}
 
 	System system = {};
-	system.systemMass = systemMass;
+	system.systemMass = static_cast<float>(moments.systemMass);
 	system.centerOfMass = centerOfMass;
+	system.quadrantSize = static_cast<float>(g_quadrantSize * S_NORM_INV);
+	system.quadrantCount = static_cast<uint32_t>(m_quadrantData.size());
 	m_system.Write(&system);
 
-	Environment environment = {};
-	environment.deltaTime = elapsedTime * g_speed;
-	environment.totalTime = time;
-	environment.light = planets[0]->position;
-	m_environment.Write(&environment);
+	{
+		StageTimer stageTimer(g_stageTimes, Stage::Gravity);
+		ExecuteGravity(planets, deltaTime);
+	}
+
+	StageTimer collisionTimer(g_stageTimes, Stage::Collision);
+
+	ExecuteBroadphase(planets);
+	m_resolver.Execute(m_bodies, m_broadphase.Pairs());
+	MergePlanets(planets);
+
+	collisionTimer.Stop();
+
+	{
+		StageTimer stageTimer(g_stageTimes, Stage::Drift);
+
+		// The CPU integrators have drifted the bodies along with the gravity pass.
+		if (GetGravitySolver() != nullptr)
+			StorePositions(planets);
+		else
+			m_computePosition.Execute(planets, static_cast<UINT>(planets.size()));
+	}
+
+	UpdateActivePlanetVerticesColor();
+
+	MoveCursor();
+}
+
+GravitySolver* PlanetRenderer::GetGravitySolver()
+{
+	switch (g_gravityMethod)
+	{
+	case GravityMethod::BarnesHut: return &m_barnesHut;
+	case GravityMethod::DirectSum: return &m_directSum;
+	case GravityMethod::FastMultipole: return &m_fastMultipole;
+	case GravityMethod::ParticleMesh: return &m_particleMesh;
+	default: return nullptr;
+	}
+}
+
+Integrator& PlanetRenderer::GetIntegrator()
+{
+	switch (g_integrator)
+	{
+	case IntegratorMethod::Leapfrog: return m_leapfrog;
+	case IntegratorMethod::Yoshida: return m_yoshida;
+	case IntegratorMethod::Hermite: return m_hermite;
+	case IntegratorMethod::Block: return m_block;
+	case IntegratorMethod::WisdomHolman: return m_wisdomHolman;
+	default: return m_euler;
+	}
+}
+
+void PlanetRenderer::ExecuteGravity(std::vector<Planet*> const& planets, float const deltaTime)
+{
+	GravitySolver* solver = GetGravitySolver();
+	if (solver == nullptr)
+	{
+		m_computeGravity.Execute(planets, static_cast<UINT>(planets.size()), static_cast<UINT>(planets.size()));
+		m_stepped = nullptr;
+		return;
+	}
+
+	// Accelerations an integrator kept are only valid when it stepped the bodies with the same solver last frame.
+	Integrator& integrator = GetIntegrator();
+	if (&integrator != m_stepped || solver != m_steppedSolver)
+		integrator.Reset();
+
+	m_stepped = &integrator;
+	m_steppedSolver = solver;
+
+	integrator.Step(m_bodies, *solver, static_cast<double>(deltaTime), g_frame % ENERGY_INTERVAL == 0);
+
+	parallel_for(0, planets.size(), PLANETS_PER_TASK, [&](size_t const i)
+	{
+		Planet& planet = *planets[i];
+
+		planet.velocity = Vector3(m_bodies.vx[i], m_bodies.vy[i], m_bodies.vz[i]);
+	});
+}
+
+void PlanetRenderer::ExecuteBroadphase(std::vector<Planet*> const& planets)
+{
+	// The gravity shader works on the planets directly, so m_bodies still has the velocities from before it ran.
+	if (GetGravitySolver() == nullptr)
+		LoadBodies(planets);
 
-	m_composition.Write(&g_compositions[planets[g_current]->id]);
+	std::fill(m_bodies.collision.begin(), m_bodies.collision.end(), 0);
+	m_broadphase.Execute(m_bodies.Gravity());
 
-	m_computeGravity.Execute(planets, static_cast<UINT>(planets.size()), static_cast<UINT>(planets.size()));
+	parallel_for(0, planets.size(), PLANETS_PER_TASK, [&](size_t const i)
+	{
+		planets[i]->collision = m_bodies.collision[i];
+	});
+}
 
-	std::map<UINT, Planet*> collisions = {};
-	std::vector<PlanetDescription> descriptions = {};
-	std::vector<PlanetDescription*> descriptionsPtrs = {};
+void PlanetRenderer::EscapeAtmospheres(std::vector<Planet*> const& planets, float const deltaTime)
+{
+	StageTimer stageTimer(g_stageTimes, Stage::Escape);
 
+	// Creating a profile allocates in the arena, so the planets that have none yet get it first.
 	for (Planet* planet : planets)
 	{
-		bool const collision = static_cast<bool>(planet->collision);
-		if (collision)
-		{
-			PlanetDescription description{};
-			description.planet = *planet;
-			description.composition = g_compositions[planet->id];
+		if (!g_profiles.Contains(planet->id))
+			planet->GetDensityProfile();
+	}
 
-			collisions[planet->id] = planet;
-			descriptions.push_back(description);
-		}
+	// Bodies in focus count by their size on screen, the active one fully.
+	const Vector3 eye = g_camera->Position();
+	const uint32_t current = g_planets[g_current].id;
+
+	std::vector<ProfileCandidate> candidates(planets.size());
+	size_t cursor = planets.size();
+	for (size_t i = 0; i < planets.size(); i++)
+	{
+		Planet const& planet = *planets[i];
+
+		const float distance = Vector3::Distance(eye, planet.position);
+		const float visibility = planet.id == current
+			                         ? 1.f
+			                         : static_cast<float>(planet.GetScreenSize()) / max(distance, 1e-6f);
+
+		candidates[i] = {
+			planet.id, planet.mass, min(visibility, 1.f), static_cast<uint32_t>(g_profiles.Find(planet.id).count)
+		};
+
+		if (planet.id == m_cursor)
+			cursor = i;
+	}
+
+	m_scheduler.SetBudget(g_profileBudget);
+	std::vector<ProfileStep> const& steps = m_scheduler.Schedule(candidates, cursor, static_cast<double>(deltaTime));
+
+	const auto start = std::chrono::high_resolution_clock::now();
+
+	std::vector<uint8_t> lost(steps.size());
+	parallel_for(0, steps.size(), 1, [&](size_t const k)
+	{
+		lost[k] = planets[steps[k].index]->Escape(static_cast<float>(steps[k].deltaTime));
+	});
+
+	m_scheduler.Complete(
+		std::chrono::duration<double, std::micro>(std::chrono::high_resolution_clock::now() - start).count());
+
+	// Storing a composition can switch it between its sparse and dense form.
+	for (size_t k = 0; k < steps.size(); k++)
+	{
+		if (lost[k])
+			planets[steps[k].index]->StoreComposition();
 	}
+}
 
-	for (PlanetDescription& description : descriptions)
-		descriptionsPtrs.push_back(&description);
+void PlanetRenderer::MergePlanets(std::vector<Planet*> const& planets)
+{
+	std::vector<MergeCluster> const& clusters = m_resolver.Clusters();
+	std::vector<uint32_t> const& members = m_resolver.Members();
 
-	m_computeCollision.Execute(descriptionsPtrs, static_cast<UINT>(descriptionsPtrs.size()),
-	                           static_cast<UINT>(descriptionsPtrs.size()));
+	// Every cluster only touches the ids of its own members: the compositions of the absorbed bodies are cleared and
+	// the survivor's profile layers invalidated and refreshed. CompositionStore allows Clear, and ProfileArena allows
+	// Invalidate and Validate, to run concurrently for different ids, so the clusters can run in parallel. Adding to a
+	// composition can switch it between its sparse and dense form, so the survivors get theirs afterwards, one at a
+	// time.
+	std::vector<Composition<double>> absorbedBy(clusters.size());
 
-	for (PlanetDescription& description : descriptions)
+	parallel_for(0, clusters.size(), 1, [&](size_t const c)
 	{
-		memcpy(collisions[description.planet.id], &description.planet, sizeof(Planet));
+		MergeCluster const& cluster = clusters[c];
+		Planet& survivor = *planets[cluster.survivor];
 
-		Planet& planet = *collisions[description.planet.id];
-		if (planet.mass > 0)
+		Composition<double>& absorbed = absorbedBy[c];
+		absorbed = 0.;
+		for (uint32_t k = cluster.first; k < cluster.first + cluster.count; k++)
 		{
-			std::vector<DepthInfo>& profile = g_profiles[planet.id];
-			size_t const l = profile.size() - static_cast<size_t>(round(profile.size() * .1)) - 1;
-			DepthInfo& layer = profile[l];
+			const uint32_t i = members[k];
+			Planet& planet = *planets[i];
 
-			float a = g_compositions[description.planet.id].sum();
-			float b = description.composition.sum();
+			planet.position = Vector3(m_bodies.x[i], m_bodies.y[i], m_bodies.z[i]);
+			planet.velocity = Vector3(m_bodies.vx[i], m_bodies.vy[i], m_bodies.vz[i]);
+			planet.mass = m_bodies.mass[i];
+			planet.radius = m_bodies.radius[i];
+			planet.collision = 0;
 
-			Composition<float> diff = (description.composition - g_compositions[description.planet.id]);
-			layer += diff.As<double>();
+			if (i == cluster.survivor)
+				continue;
 
-			double const oldRadius = layer.radius;
-			double const usedVolume = l > 0 ? pow(profile[l - 1].radius, 3) * PI_CB : 0;
-			double const newRadius = cbrt(((layer.volume + usedVolume) / PI) * (3 / 4.));
-			double const radiusChange = newRadius - oldRadius;
+			absorbed += g_compositions.Get(planet.id);
+			g_compositions.Clear(planet.id);
+		}
 
-			if (radiusChange != 0)
-			{
-				layer.radius = newRadius;
+		survivor.collisions += cluster.count - 1;
 
-				if (l < profile.size() - 1)
-					for (int i = l + 1; i < profile.size(); i++)
-						profile[i].radius += radiusChange;
-			}
+		// The absorbed material goes into the layer just below the surface, which grows by its volume. Only the layers
+		// from it outward are solved again, their radii follow from the volume they enclose.
+		ProfileLayers const profile = g_profiles.Find(survivor.id);
+		if (profile.Empty())
+			return;
 
-			memcpy(&g_compositions[description.planet.id], &description.composition, sizeof(Composition<float>));
+		const size_t l = profile.count - static_cast<size_t>(round(profile.count * .1)) - 1;
 
-			planet.RefreshDensityProfile();
-		}
-		else memcpy(&g_compositions[description.planet.id], &description.composition, sizeof(Composition<float>));
+		Composition<double>& layer = LayerComposition(profile, l);
+		layer += absorbed;
+		profile.mass[l] = layer.sum();
+		profile.volume[l] = profile.mass[l] / profile.density[l];
+
+		g_profiles.Invalidate(survivor.id, l);
+		survivor.RefreshDensityProfile();
+	});
+
+	for (size_t c = 0; c < clusters.size(); c++)
+	{
+		const uint32_t id = planets[clusters[c].survivor]->id;
+		if (g_compositions.Contains(id))
+			g_compositions.Add(id, absorbedBy[c]);
 	}
+}
 
-	m_computePosition.Execute(planets, static_cast<UINT>(planets.size()));
+void PlanetRenderer::LoadQuadrants()
+{
+	std::vector<QuadrantCell> const& cells = m_quadrants.Cells();
+	std::vector<QuadrantMoments> const& moments = m_quadrants.Moments();
 
-	UpdateActivePlanetVerticesColor();
+	// Every occupied cell is uploaded, the far field of any left out would be missing from all bodies.
+	if (m_quadrantBuffer.Reserve(cells.size()))
+		m_computePosition.SetShaderResources({m_quadrantBuffer.Location});
 
-	MoveCursor();
+	m_quadrantData.resize(cells.size());
+	parallel_for(0, m_quadrantData.size(), PLANETS_PER_TASK, [&](size_t const c)
+	{
+		QuadrantMoments const& cell = moments[c];
+		double const* q = cell.quadrupole;
+
+		int32_t x, y, z;
+		MortonDecode(cells[c].key, x, y, z);
+
+		Quadrant& quadrant = m_quadrantData[c];
+		quadrant.cell = XMINT3(x, y, z);
+		quadrant.mass = static_cast<float>(cell.mass * G_SCREEN);
+		quadrant.center = XMFLOAT3(static_cast<float>(cell.x), static_cast<float>(cell.y), static_cast<float>(cell.z));
+		quadrant.diagonal = XMFLOAT3(static_cast<float>(q[0] * G_SCREEN), static_cast<float>(q[1] * G_SCREEN),
+		                             static_cast<float>(q[2] * G_SCREEN));
+		quadrant.offDiagonal = XMFLOAT3(static_cast<float>(q[3] * G_SCREEN), static_cast<float>(q[4] * G_SCREEN),
+		                                static_cast<float>(q[5] * G_SCREEN));
+	});
+
+	m_quadrantBuffer.Write(m_quadrantData.data(), m_quadrantData.size());
+}
+
+void PlanetRenderer::StorePositions(std::vector<Planet*> const& planets)
+{
+	parallel_for(0, planets.size(), PLANETS_PER_TASK, [&](size_t const i)
+	{
+		planets[i]->position = Vector3(m_bodies.x[i], m_bodies.y[i], m_bodies.z[i]);
+	});
+}
+
+void PlanetRenderer::LoadBodies(std::vector<Planet*> const& planets)
+{
+	m_bodies.Resize(planets.size());
+
+	parallel_for(0, planets.size(), PLANETS_PER_TASK, [&](size_t const i) { LoadBody(i, *planets[i]); });
+}
+
+void PlanetRenderer::LoadBody(size_t const i, Planet const& planet)
+{
+	m_bodies.x[i] = planet.position.x;
+	m_bodies.y[i] = planet.position.y;
+	m_bodies.z[i] = planet.position.z;
+	m_bodies.vx[i] = planet.velocity.x;
+	m_bodies.vy[i] = planet.velocity.y;
+	m_bodies.vz[i] = planet.velocity.z;
+	m_bodies.mass[i] = planet.mass;
+	m_bodies.radius[i] = planet.radius;
+	m_bodies.collision[i] = planet.collision;
 }
 
 void PlanetRenderer::Render(ID3D12GraphicsCommandList* commandList)
@@ -310,24 +576,23 @@ void PlanetRenderer::UpdateActivePlanetVerticesColor()
 {
 	Planet const& planet = g_planets[g_current];
 
-	auto& profile = g_profiles[planet.id];
-	double const radiusNorm = profile[profile.size() - 1].radius / 360.;
+	ProfileLayers const profile = g_profiles.Find(planet.id);
+	double const radiusNorm = profile.radius[profile.count - 1] / 360.;
 
 	double maxDensity = 0, maxPressure = 0;
-	for (DepthInfo const& info : profile)
+	for (size_t l = 0; l < profile.count; l++)
 	{
-		maxDensity = info.density > maxDensity ? info.density : maxDensity;
-		maxPressure = info.pressure > maxPressure ? info.pressure : maxPressure;
+		maxDensity = profile.density[l] > maxDensity ? profile.density[l] : maxDensity;
+		maxPressure = profile.pressure[l] > maxPressure ? profile.pressure[l] : maxPressure;
 	}
 
 	std::array<XMFLOAT4, 180> colorProfile{};
 	int j = 0;
 	for (int i = 0; i < 180; i++)
 	{
-		while (profile[j].radius < i * radiusNorm) j++;
+		while (profile.radius[j] < i * radiusNorm) j++;
 
-		DepthInfo& info = profile[j];
-		colorProfile[i] = static_cast<XMFLOAT4>(info.composition.GetColor());
+		colorProfile[i] = static_cast<XMFLOAT4>(LayerComposition(profile, j).GetColor());
 	}
 
 	m_colorProfile.Write(colorProfile.data());
@@ -339,36 +604,36 @@ void PlanetRenderer::UpdateVertices(Sphere::Mesh& mesh,
                                     std::vector<VertexPositionNormalColorTexture>& vertices, const int lod,
                                     const Planet* planet)
 {
-	vertices.clear();
+	StageTimer stageTimer(g_stageTimes, Stage::Vertices);
 
 	mesh = Sphere::create(lod);
 
-	size_t length = mesh.vertices.size();
-	XMFLOAT3* normals = new XMFLOAT3[length];
-	vector<Vector2> texcoords{};
-
+	const size_t length = mesh.vertices.size();
+	vector<XMFLOAT3> normals(length);
+	vector<Vector2> texcoords(length);
 
 	const bool applyNoise = planet != nullptr;
-	float limit, radius;
-	SimplexNoise noise;
+	float limit = 0, radius = 0, id = 0;
+	const SimplexNoise noise;
 
 	if (applyNoise)
 	{
 		limit = S_NORM_INV * 100000;
 		radius = static_cast<float>(planet->radius * S_NORM_INV);
-		noise = SimplexNoise();
+		id = sqrt(static_cast<float>(planet->id));
 	}
 
-	for (Vector3& vertex : mesh.vertices)
+	parallel_for(0, length, [&](size_t const i)
 	{
-		texcoords.push_back(Vector2(
+		Vector3& vertex = mesh.vertices[i];
+
+		texcoords[i] = Vector2(
 			static_cast<float>(acos(min(max(vertex.x / 1., -1.), 1.)) / PI_RAD * 2),
 			static_cast<float>(acos(min(max(vertex.y / 1., -1.), 1.)) / PI_RAD * 2)
-		));
+		);
 
 		if (applyNoise)
 		{
-			float const id = sqrt(static_cast<float>(planet->id));
 			float noiseVal = noise.fractal(10,
 			                               vertex.x + id,
 			                               vertex.y + id,
@@ -377,21 +642,16 @@ void PlanetRenderer::UpdateVertices(Sphere::Mesh& mesh,
 			noiseVal = min(max(noiseVal, -limit), limit);
 			vertex *= radius + noiseVal;
 		}
-	}
+	});
 
-	ComputeNormals(mesh.indices.data(), mesh.triangle_count(), mesh.vertices.data(), mesh.vertices.size(), 0, normals);
+	ComputeNormals(mesh.indices.data(), mesh.triangle_count(), mesh.vertices.data(), mesh.vertices.size(), 0,
+	               normals.data());
 
-	for (int i = 0; i < length; i++)
+	vertices.resize(length);
+	parallel_for(0, length, [&](size_t const i)
 	{
-		Vector3 vertex = mesh.vertices[i];
-		Vector3 normal = normals[i];
-		Vector2 tex = texcoords[i];
-
-		vertices.push_back(VertexPositionNormalColorTexture(vertex, normal, Vector4::Zero, tex));
-	}
-
-	texcoords.clear();
-	texcoords.shrink_to_fit();
+		vertices[i] = VertexPositionNormalColorTexture(mesh.vertices[i], normals[i], Vector4::Zero, texcoords[i]);
+	});
 }
 
 void PlanetRenderer::CreateDeviceDependentResources()
@@ -429,17 +689,12 @@ void PlanetRenderer::CreateDeviceDependentResources()
 	});
 	m_computeGravity.CreatePipeline();
 
-	m_computeCollision.LoadShader("ComputeCollisionShader");
-	m_computeCollision.SetConstantBuffers({
-		m_environment.Description
-	});
-	m_computeCollision.CreatePipeline();
-
 	m_computePosition.LoadShader("ComputePositionShader");
 	m_computePosition.SetConstantBuffers({
 		m_environment.Description,
 		m_system.Description
 	});
+	m_computePosition.SetShaderResources({m_quadrantBuffer.Location});
 	m_computePosition.CreatePipeline();
 
 	m_texturePlanet.LoadShader("TextureComputeShader");
@@ -7,6 +7,16 @@
 #include "Buffers.h"
 #include "Sphere.h"
 #include "StepTimer.h"
+#include "BarnesHutSolver.h"
+#include "BodyStore.h"
+#include "Broadphase.h"
+#include "CollisionResolver.h"
+#include "DirectSumSolver.h"
+#include "FastMultipoleSolver.h"
+#include "Integrator.h"
+#include "ParticleMeshSolver.h"
+#include "ProfileScheduler.h"
+#include "QuadrantIndex.h"
 
 class PlanetRenderer
 {
@@ -41,8 +51,24 @@ public:
 		m_distant(planet.m_distant),
 		m_computeGravity(planet.m_computeGravity),
 		m_computePosition(planet.m_computePosition),
-		m_computeCollision(planet.m_computeCollision),
+		m_quadrantBuffer(planet.m_quadrantBuffer),
+		m_quadrantData(planet.m_quadrantData),
 		m_texturePlanet(planet.m_texturePlanet),
+		m_barnesHut(planet.m_barnesHut),
+		m_directSum(planet.m_directSum),
+		m_fastMultipole(planet.m_fastMultipole),
+		m_particleMesh(planet.m_particleMesh),
+		m_euler(planet.m_euler),
+		m_leapfrog(planet.m_leapfrog),
+		m_yoshida(planet.m_yoshida),
+		m_hermite(planet.m_hermite),
+		m_block(planet.m_block),
+		m_wisdomHolman(planet.m_wisdomHolman),
+		m_bodies(planet.m_bodies),
+		m_quadrants(planet.m_quadrants),
+		m_broadphase(planet.m_broadphase),
+		m_resolver(planet.m_resolver),
+		m_scheduler(planet.m_scheduler),
 		m_cursor(planet.m_cursor)
 	{
 	}
@@ -54,9 +80,25 @@ public:
 	void Render(ID3D12GraphicsCommandList* commandList);
 	void Update(DX::StepTimer const& timer);
 
+	GravitySolver* GetGravitySolver();
+	Integrator& GetIntegrator();
+	Broadphase const& GetBroadphase() const { return m_broadphase; }
+	CollisionResolver const& GetResolver() const { return m_resolver; }
+	QuadrantIndex const& GetQuadrants() const { return m_quadrants; }
+	size_t GetQuadrantCapacity() const { return m_quadrantBuffer.Capacity; }
+	ProfileScheduler const& GetScheduler() const { return m_scheduler; }
+
 private:
 	void UpdateVertices(Sphere::Mesh& mesh, std::vector<DirectX::VertexPositionNormalColorTexture>& vertices,
 	                    int lod, const Planet* planet = nullptr);
+	void ExecuteGravity(std::vector<Planet*> const& planets, float deltaTime);
+	void ExecuteBroadphase(std::vector<Planet*> const& planets);
+	void EscapeAtmospheres(std::vector<Planet*> const& planets, float deltaTime);
+	void MergePlanets(std::vector<Planet*> const& planets);
+	void LoadQuadrants();
+	void StorePositions(std::vector<Planet*> const& planets);
+	void LoadBodies(std::vector<Planet*> const& planets);
+	void LoadBody(size_t i, Planet const& planet);
 	void UpdateActivePlanetVertices();
 	void UpdateActivePlanetVerticesColor();
 	void CreateDeviceDependentResources();
@@ -96,9 +138,41 @@ private:
 	Pipeline m_distant;
 	ComputePipeline<Planet> m_computeGravity;
 	ComputePipeline<Planet> m_computePosition;
-	ComputePipeline<PlanetDescription> m_computeCollision;
+
+	// Moments of the occupied quadrants for the far field of ComputePositionShader, uploaded on the Shader path.
+	Buffers::StructuredBuffer<Buffers::Quadrant> m_quadrantBuffer;
+	std::vector<Buffers::Quadrant> m_quadrantData;
 	TexturePipeline<DirectX::XMFLOAT4> m_texturePlanet;
 
+	// CPU gravity solvers, used instead of m_computeGravity when g_gravityMethod selects them. They work on m_bodies,
+	// which the integrator selected by g_integrator then also advances in place of m_computePosition.
+	BarnesHutSolver m_barnesHut;
+	DirectSumSolver m_directSum;
+	FastMultipoleSolver m_fastMultipole;
+	ParticleMeshSolver m_particleMesh;
+	EulerIntegrator m_euler;
+	LeapfrogIntegrator m_leapfrog;
+	YoshidaIntegrator m_yoshida;
+	HermiteIntegrator m_hermite;
+	BlockIntegrator m_block;
+	WisdomHolmanIntegrator m_wisdomHolman;
+	BodyStore m_bodies;
+
+	// The integrator and solver of the last frame, null after the shader path, so a switch drops cached accelerations.
+	// A copy starts without them.
+	Integrator* m_stepped = nullptr;
+	GravitySolver* m_steppedSolver = nullptr;
+
+	// Bodies by g_quadrantSize cell, rebuilt every frame from m_bodies.
+	QuadrantIndex m_quadrants;
+
+	// Finds the colliding bodies for every gravity method, the flags the gravity kernels raise are not used.
+	Broadphase m_broadphase;
+	CollisionResolver m_resolver;
+
+	// Picks the bodies whose density profiles advance each frame within g_profileBudget, starting at m_cursor.
+	ProfileScheduler m_scheduler;
+
 	uint32_t m_cursor;
 
 	uint32_t MoveCursor()
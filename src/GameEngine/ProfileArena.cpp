@@ -0,0 +1,135 @@
+#include "ProfileArena.h"
+
+#include <algorithm>
+
+ProfileArena::ProfileArena(size_t const elements) :
+	m_elements(elements)
+{
+}
+
+ProfileLayers ProfileArena::Find(uint32_t const id)
+{
+	Span const* span = m_spans.Find(id);
+	return span != nullptr ? View(*span) : View(Span{0, 0, 0});
+}
+
+ProfileLayers ProfileArena::Allocate(uint32_t const id, size_t const count)
+{
+	Erase(id);
+
+	const size_t end = m_size + count;
+	if (end > m_radius.size())
+	{
+		for (auto* values : Fields())
+			values->resize(end);
+		m_composition.resize(end * m_elements);
+	}
+
+	for (auto* values : Fields())
+		std::fill(values->begin() + m_size, values->begin() + end, 0.);
+	std::fill(m_composition.begin() + m_size * m_elements, m_composition.begin() + end * m_elements, 0.);
+
+	const Span span{static_cast<uint32_t>(m_size), static_cast<uint32_t>(count), 0};
+	m_spans.Insert(id, span);
+	m_size = end;
+	m_live += count;
+
+	return View(span);
+}
+
+std::array<std::vector<double>*, 7> ProfileArena::Fields()
+{
+	return {&m_radius, &m_volume, &m_mass, &m_density, &m_pressure, &m_enclosedMass, &m_enclosedVolume};
+}
+
+void ProfileArena::MoveLayer(size_t const from, size_t const to)
+{
+	for (auto* values : Fields())
+		(*values)[to] = (*values)[from];
+	std::copy_n(m_composition.begin() + from * m_elements, m_elements, m_composition.begin() + to * m_elements);
+}
+
+void ProfileArena::Erase(uint32_t const id)
+{
+	if (Span const* span = m_spans.Find(id))
+	{
+		m_live -= span->count;
+		m_spans.Erase(id);
+	}
+}
+
+void ProfileArena::Invalidate(uint32_t const id, size_t const layer)
+{
+	if (Span* span = m_spans.Find(id))
+		span->stale = std::min(span->stale, static_cast<uint32_t>(layer));
+}
+
+size_t ProfileArena::FirstStale(uint32_t const id) const
+{
+	Span const* span = m_spans.Find(id);
+	return span != nullptr ? std::min(span->stale, span->count) : 0;
+}
+
+void ProfileArena::Validate(uint32_t const id)
+{
+	if (Span* span = m_spans.Find(id))
+		span->stale = span->count;
+}
+
+size_t ProfileArena::Bytes() const
+{
+	return (m_radius.capacity() + m_volume.capacity() + m_mass.capacity() + m_density.capacity() +
+		m_pressure.capacity() + m_enclosedMass.capacity() + m_enclosedVolume.capacity() + m_composition.capacity()) *
+		sizeof(double) + m_spans.Size() * sizeof(Span);
+}
+
+ProfileLayers ProfileArena::View(Span const& span)
+{
+	ProfileLayers layers{};
+	layers.radius = m_radius.data() + span.offset;
+	layers.volume = m_volume.data() + span.offset;
+	layers.mass = m_mass.data() + span.offset;
+	layers.density = m_density.data() + span.offset;
+	layers.pressure = m_pressure.data() + span.offset;
+	layers.enclosedMass = m_enclosedMass.data() + span.offset;
+	layers.enclosedVolume = m_enclosedVolume.data() + span.offset;
+	layers.composition = m_composition.data() + span.offset * m_elements;
+	layers.count = span.count;
+	layers.elements = m_elements;
+	return layers;
+}
+
+void ProfileArena::Compact()
+{
+	std::vector<double> radius(m_live), volume(m_live), mass(m_live), density(m_live), pressure(m_live);
+	std::vector<double> enclosedMass(m_live), enclosedVolume(m_live);
+	AlignedVector<double> composition(m_live * m_elements);
+
+	// Spans are in the order the last Retain aligned them to.
+	size_t offset = 0;
+	for (Span& span : m_spans)
+	{
+		std::copy_n(m_radius.begin() + span.offset, span.count, radius.begin() + offset);
+		std::copy_n(m_volume.begin() + span.offset, span.count, volume.begin() + offset);
+		std::copy_n(m_mass.begin() + span.offset, span.count, mass.begin() + offset);
+		std::copy_n(m_density.begin() + span.offset, span.count, density.begin() + offset);
+		std::copy_n(m_pressure.begin() + span.offset, span.count, pressure.begin() + offset);
+		std::copy_n(m_enclosedMass.begin() + span.offset, span.count, enclosedMass.begin() + offset);
+		std::copy_n(m_enclosedVolume.begin() + span.offset, span.count, enclosedVolume.begin() + offset);
+		std::copy_n(m_composition.begin() + span.offset * m_elements, span.count * m_elements,
+		            composition.begin() + offset * m_elements);
+
+		span.offset = static_cast<uint32_t>(offset);
+		offset += span.count;
+	}
+
+	m_radius.swap(radius);
+	m_volume.swap(volume);
+	m_mass.swap(mass);
+	m_density.swap(density);
+	m_pressure.swap(pressure);
+	m_enclosedMass.swap(enclosedMass);
+	m_enclosedVolume.swap(enclosedVolume);
+	m_composition.swap(composition);
+	m_size = offset;
+}
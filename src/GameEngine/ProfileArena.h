@@ -0,0 +1,135 @@
+#pragma once
+
+#include "Simd.h"
+#include "SlotMap.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// The layers of one body's density profile, innermost first, as pointers into a ProfileArena. Radius is in metres,
+// volume in m3, mass and the element masses in kg, density in kg/m3 and pressure in Pa. The enclosed mass and volume
+// of a layer are the prefix sums of the layers up to and including it.
+struct ProfileLayers
+{
+	double* radius;
+	double* volume;
+	double* mass;
+	double* density;
+	double* pressure;
+	double* enclosedMass;
+	double* enclosedVolume;
+	double* composition; // elements values per layer, the element masses and any padding
+	size_t count;
+	size_t elements;
+
+	[[nodiscard]] bool Empty() const { return count == 0; }
+
+	// Element masses of one layer.
+	[[nodiscard]] double* Elements(size_t const layer) const { return composition + layer * elements; }
+};
+
+// Density profiles of all bodies in one pool: every field of every layer is one array, each body owns a contiguous
+// span of layers in it, and the per-element masses are a block of their own so passes over the scalar fields don't
+// stream them. Spans are found by body id through a SlotMap.
+//
+// Every profile remembers the first layer whose derived fields are stale, so a refresh resumes from the enclosed sums
+// below it instead of the centre. Allocate makes all layers stale, EraseLayers the layers from the first erased one,
+// Invalidate any layer a caller changed.
+//
+// Replacing or erasing a profile leaves its old span dead; Retain drops the profiles of removed bodies and compacts
+// the arena into body order once the dead layers outgrow a quarter of it. Views are invalidated by Allocate and
+// Retain. EraseLayers, Invalidate and Validate touch only the span of their id and may run concurrently for different
+// ids.
+class ProfileArena
+{
+public:
+	explicit ProfileArena(size_t elements);
+
+	[[nodiscard]] bool Contains(uint32_t const id) const { return m_spans.Contains(id); }
+
+	// The layers of id, none if it has no profile.
+	[[nodiscard]] ProfileLayers Find(uint32_t id);
+
+	// Gives id a new zeroed profile of count layers, dropping the one it had.
+	ProfileLayers Allocate(uint32_t id, size_t count);
+
+	// Keeps the layers for which erase(layer) is false, in order. erase sees every layer once, innermost first, before
+	// any layer above it has moved. The span shrinks in place and its tail becomes dead.
+	template <typename Erase>
+	void EraseLayers(uint32_t const id, Erase const& erase)
+	{
+		Span* span = m_spans.Find(id);
+		if (span == nullptr)
+			return;
+
+		size_t kept = 0;
+		for (size_t l = 0; l < span->count; l++)
+		{
+			if (erase(l))
+			{
+				span->stale = std::min(span->stale, static_cast<uint32_t>(kept));
+				continue;
+			}
+
+			if (kept != l)
+				MoveLayer(span->offset + l, span->offset + kept);
+			kept++;
+		}
+
+		m_live -= span->count - kept;
+		span->count = static_cast<uint32_t>(kept);
+	}
+
+	void Erase(uint32_t id);
+
+	// Marks the layers of id from layer outward stale, after their mass, volume or density changed.
+	void Invalidate(uint32_t id, size_t layer);
+
+	// The first stale layer of id, its layer count when none is.
+	[[nodiscard]] size_t FirstStale(uint32_t id) const;
+
+	// Marks every layer of id refreshed.
+	void Validate(uint32_t id);
+
+	// Drops the profiles of bodies not among items, with keyOf giving the id of an item, and compacts in their order.
+	template <typename Items, typename KeyOf>
+	void Retain(Items const& items, KeyOf const& keyOf)
+	{
+		m_spans.Align(items, keyOf);
+
+		m_live = 0;
+		for (Span const& span : m_spans)
+			m_live += span.count;
+
+		if ((m_size - m_live) * 4 > m_size)
+			Compact();
+	}
+
+	[[nodiscard]] size_t Layers() const { return m_live; }
+	[[nodiscard]] size_t Bytes() const;
+
+private:
+	struct Span
+	{
+		uint32_t offset;
+		uint32_t count;
+		uint32_t stale; // first layer whose derived fields need a refresh
+	};
+
+	ProfileLayers View(Span const& span);
+	std::array<std::vector<double>*, 7> Fields(); // the scalar fields, one value per layer
+	void MoveLayer(size_t from, size_t to);
+	void Compact();
+
+	size_t m_elements;
+	size_t m_size = 0; // layers in use, dead ones included
+	std::atomic<size_t> m_live{0};
+
+	std::vector<double> m_radius, m_volume, m_mass, m_density, m_pressure, m_enclosedMass, m_enclosedVolume;
+	AlignedVector<double> m_composition; // aligned so that every layer's block is, for strides of whole registers
+	SlotMap<Span> m_spans;
+};
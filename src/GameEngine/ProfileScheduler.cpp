@@ -0,0 +1,93 @@
+#include "ProfileScheduler.h"
+
+#include "PhysicalConstants.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+	// How much more a body in focus weighs than one out of sight.
+	constexpr double VISIBILITY_WEIGHT = 8;
+
+	// Share of a frame's measured cost per layer taken into the prediction.
+	constexpr double COST_SMOOTHING = .25;
+}
+
+ProfileScheduler::ProfileScheduler(double const budget) :
+	m_budget(budget)
+{
+}
+
+double ProfileScheduler::Priority(ProfileCandidate const& candidate, double const waited) const
+{
+	const double mass = 1 + std::log10(1 + static_cast<double>(candidate.mass) / EARTH_MASS);
+	const double visibility = 1 + VISIBILITY_WEIGHT * static_cast<double>(candidate.visibility);
+	return waited * mass * visibility;
+}
+
+std::vector<ProfileStep> const& ProfileScheduler::Schedule(std::vector<ProfileCandidate> const& candidates,
+                                                          size_t const cursor, double const deltaTime)
+{
+	m_time += deltaTime;
+	m_steps.clear();
+	m_layers = 0;
+
+	// Bodies seen for the first time start from now, their profile was just made. The removed ones are dropped.
+	m_updated.Align(candidates, [](ProfileCandidate const& candidate) { return candidate.id; });
+
+	const size_t count = candidates.size();
+	m_priority.resize(count);
+	m_order.clear();
+	for (size_t i = 0; i < count; i++)
+	{
+		double const* updated = m_updated.Find(candidates[i].id);
+		if (updated == nullptr)
+			updated = &m_updated.Insert(candidates[i].id, m_time);
+
+		const double waited = m_time - *updated;
+		m_priority[i] = Priority(candidates[i], waited);
+		if (waited > 0 && i != cursor)
+			m_order.push_back(static_cast<uint32_t>(i));
+	}
+
+	const double budget = m_budget / m_layerCost;
+	auto take = [&](size_t const i)
+	{
+		double& updated = m_updated.At(candidates[i].id);
+		m_steps.push_back({static_cast<uint32_t>(i), m_time - updated});
+		m_layers += candidates[i].layers;
+		updated = m_time;
+	};
+
+	if (cursor < count && m_time > m_updated.At(candidates[cursor].id))
+		take(cursor);
+
+	// Only as many bodies as the budget could hold at the average layer count are ordered.
+	size_t layers = 0;
+	for (ProfileCandidate const& candidate : candidates)
+		layers += candidate.layers;
+	const double average = count > 0 ? std::max(1., static_cast<double>(layers) / count) : 1.;
+	const size_t ordered = std::min(m_order.size(), static_cast<size_t>(budget / average) * 2 + 16);
+
+	std::partial_sort(m_order.begin(), m_order.begin() + ordered, m_order.end(),
+	                  [this](uint32_t const a, uint32_t const b) { return m_priority[a] > m_priority[b]; });
+
+	for (size_t k = 0; k < ordered; k++)
+	{
+		const uint32_t i = m_order[k];
+		if (!m_steps.empty() && static_cast<double>(m_layers + candidates[i].layers) > budget)
+			break;
+
+		take(i);
+	}
+
+	return m_steps;
+}
+
+void ProfileScheduler::Complete(double const elapsed)
+{
+	m_elapsed = elapsed;
+	if (m_layers > 0)
+		m_layerCost += (elapsed / static_cast<double>(m_layers) - m_layerCost) * COST_SMOOTHING;
+}
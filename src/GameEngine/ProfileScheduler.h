@@ -0,0 +1,65 @@
+#pragma once
+
+#include "SlotMap.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// A body the scheduler may advance this frame. visibility is 0 for bodies out of sight up to 1 for the one in focus.
+struct ProfileCandidate
+{
+	uint32_t id;
+	float mass;
+	float visibility;
+	uint32_t layers;
+};
+
+// A body to advance, by its index among the candidates, over all the simulated time since its last update.
+struct ProfileStep
+{
+	uint32_t index;
+	double deltaTime;
+};
+
+// Picks which bodies' density profiles advance in a frame so that the work fits a wall clock budget whatever the
+// number of bodies. Every body remembers when it was last advanced and catches up over all the time since. The body
+// under the round-robin cursor always goes first, so none starves, and the rest follow by priority, the time waited
+// weighted by mass and visibility, until the predicted cost fills the budget. The cost per layer is learnt from the
+// measured time of the frames before.
+class ProfileScheduler
+{
+public:
+	explicit ProfileScheduler(double budget);
+
+	// Wall clock time in microseconds the scheduled updates may take per frame.
+	void SetBudget(double const budget) { m_budget = budget; }
+	[[nodiscard]] double Budget() const { return m_budget; }
+
+	// Advances the simulated time by deltaTime seconds and picks the bodies to update, cursor being the index of the
+	// candidate under the round-robin cursor, or any out of range index for none. The steps are valid until the next
+	// call.
+	std::vector<ProfileStep> const& Schedule(std::vector<ProfileCandidate> const& candidates, size_t cursor,
+	                                         double deltaTime);
+
+	// Tells the time in microseconds the scheduled updates took, to calibrate the predicted cost.
+	void Complete(double elapsed);
+
+	[[nodiscard]] size_t Scheduled() const { return m_steps.size(); }
+	[[nodiscard]] double Elapsed() const { return m_elapsed; }
+	[[nodiscard]] double LayerCost() const { return m_layerCost; }
+
+private:
+	double Priority(ProfileCandidate const& candidate, double waited) const;
+
+	double m_budget;
+	double m_time = 0; // simulated seconds since the scheduler started
+	double m_layerCost = 1; // predicted microseconds per layer
+	double m_elapsed = 0; // microseconds the last frame's updates took
+	size_t m_layers = 0; // layers scheduled in the last frame
+
+	SlotMap<double> m_updated; // simulated time of the last update of every body
+	std::vector<double> m_priority;
+	std::vector<uint32_t> m_order;
+	std::vector<ProfileStep> m_steps;
+};
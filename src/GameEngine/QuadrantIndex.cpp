@@ -0,0 +1,323 @@
+#include "QuadrantIndex.h"
+
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+namespace
+{
+	constexpr int RADIX_BITS = 8;
+	constexpr size_t RADIX = 1 << RADIX_BITS;
+	constexpr size_t BODIES_PER_TASK = 1024;
+	constexpr size_t CELLS_PER_TASK = 64;
+	constexpr uint32_t NO_CELL = ~0u;
+
+	uint64_t Spread(uint32_t const value)
+	{
+		uint64_t v = value & 0x1FFFFF;
+		v = (v | v << 32) & 0x1F00000000FFFF;
+		v = (v | v << 16) & 0x1F0000FF0000FF;
+		v = (v | v << 8) & 0x100F00F00F00F00F;
+		v = (v | v << 4) & 0x10C30C30C30C30C3;
+		v = (v | v << 2) & 0x1249249249249249;
+		return v;
+	}
+
+	uint32_t Compact(uint64_t v)
+	{
+		v &= 0x1249249249249249;
+		v = (v | v >> 2) & 0x10C30C30C30C30C3;
+		v = (v | v >> 4) & 0x100F00F00F00F00F;
+		v = (v | v >> 8) & 0x1F0000FF0000FF;
+		v = (v | v >> 16) & 0x1F00000000FFFF;
+		v = (v | v >> 32) & 0x1FFFFF;
+		return static_cast<uint32_t>(v);
+	}
+
+	uint64_t Mix(uint64_t const key)
+	{
+		const uint64_t h = key * 0x9E3779B97F4A7C15;
+		return h ^ h >> 32;
+	}
+}
+
+uint64_t MortonEncode(int32_t const x, int32_t const y, int32_t const z)
+{
+	const auto bias = [](int32_t const v)
+	{
+		return static_cast<uint32_t>(std::clamp(v, MORTON_MIN, MORTON_MAX) - MORTON_MIN);
+	};
+
+	return Spread(bias(x)) | Spread(bias(y)) << 1 | Spread(bias(z)) << 2;
+}
+
+void MortonDecode(uint64_t const key, int32_t& x, int32_t& y, int32_t& z)
+{
+	x = static_cast<int32_t>(Compact(key)) + MORTON_MIN;
+	y = static_cast<int32_t>(Compact(key >> 1)) + MORTON_MIN;
+	z = static_cast<int32_t>(Compact(key >> 2)) + MORTON_MIN;
+}
+
+QuadrantIndex::QuadrantIndex(double const cellSize) :
+	m_cellSize(cellSize)
+{
+}
+
+void QuadrantIndex::SetCellSize(double const cellSize)
+{
+	m_cellSize = cellSize;
+}
+
+int32_t QuadrantIndex::Coordinate(double const value) const
+{
+	const double cell = std::round(value / m_cellSize);
+	return static_cast<int32_t>(std::clamp(cell, static_cast<double>(MORTON_MIN), static_cast<double>(MORTON_MAX)));
+}
+
+uint64_t QuadrantIndex::Key(double const x, double const y, double const z) const
+{
+	return MortonEncode(Coordinate(x), Coordinate(y), Coordinate(z));
+}
+
+void QuadrantIndex::Build(GravityBodies const& bodies)
+{
+	const auto start = std::chrono::high_resolution_clock::now();
+	const size_t count = bodies.count;
+
+	m_keys.resize(count);
+	parallel_for(0, count, BODIES_PER_TASK, [&](size_t const i)
+	{
+		m_keys[i] = bodies.mass[i] != 0 && !std::isnan(bodies.x[i] + bodies.y[i] + bodies.z[i])
+			            ? Key(bodies.x[i], bodies.y[i], bodies.z[i])
+			            : EMPTY;
+	});
+
+	m_sortKeys.clear();
+	m_sortBodies.clear();
+	for (size_t i = 0; i < count; i++)
+	{
+		if (m_keys[i] == EMPTY)
+			continue;
+
+		m_sortKeys.push_back(m_keys[i]);
+		m_sortBodies.push_back(static_cast<uint32_t>(i));
+	}
+
+	Sort(m_sortKeys.size());
+	m_bodies = m_sortBodies;
+
+	m_cells.clear();
+	m_cellOf.assign(count, NO_CELL);
+	for (size_t k = 0; k < m_sortKeys.size(); k++)
+	{
+		if (k == 0 || m_sortKeys[k] != m_sortKeys[k - 1])
+			m_cells.push_back({m_sortKeys[k], static_cast<uint32_t>(k), 0});
+
+		m_cells.back().count++;
+		m_cellOf[m_bodies[k]] = static_cast<uint32_t>(m_cells.size() - 1);
+	}
+
+	Hash();
+
+	m_buildTime = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+void QuadrantIndex::Sort(size_t const count)
+{
+	if (count < 2)
+		return;
+
+	// Digits above the highest bit in which any two keys differ are the same for all of them and need no pass.
+	const uint64_t differ = parallel_reduce(0, count, BODIES_PER_TASK, uint64_t{0},
+	                                        [&](uint64_t const bits, size_t const k)
+	                                        {
+		                                        return bits | (m_sortKeys[k] ^ m_sortKeys[0]);
+	                                        },
+	                                        [](uint64_t const a, uint64_t const b) { return a | b; });
+
+	// Every block counts its digits, the offsets are laid out digit by digit and block by block and each block then
+	// scatters its own keys, which keeps the sort stable for any number of blocks.
+	const size_t blocks = std::clamp<size_t>(count / BODIES_PER_TASK, 1, 4 * g_threadPool.Size());
+	const size_t blockSize = (count + blocks - 1) / blocks;
+	std::vector<uint32_t> offsets(blocks * RADIX);
+
+	m_sortScratch.resize(count);
+	m_bodyScratch.resize(count);
+
+	for (int shift = 0; shift < 64 && differ >> shift != 0; shift += RADIX_BITS)
+	{
+		std::fill(offsets.begin(), offsets.end(), 0);
+
+		parallel_for(0, blocks, 1, [&](size_t const block)
+		{
+			uint32_t* histogram = &offsets[block * RADIX];
+			const size_t last = std::min(count, (block + 1) * blockSize);
+			for (size_t k = block * blockSize; k < last; k++)
+				histogram[m_sortKeys[k] >> shift & (RADIX - 1)]++;
+		});
+
+		uint32_t offset = 0;
+		for (size_t digit = 0; digit < RADIX; digit++)
+			for (size_t block = 0; block < blocks; block++)
+			{
+				const uint32_t n = offsets[block * RADIX + digit];
+				offsets[block * RADIX + digit] = offset;
+				offset += n;
+			}
+
+		parallel_for(0, blocks, 1, [&](size_t const block)
+		{
+			uint32_t* next = &offsets[block * RADIX];
+			const size_t last = std::min(count, (block + 1) * blockSize);
+			for (size_t k = block * blockSize; k < last; k++)
+			{
+				const uint32_t to = next[m_sortKeys[k] >> shift & (RADIX - 1)]++;
+				m_sortScratch[to] = m_sortKeys[k];
+				m_bodyScratch[to] = m_sortBodies[k];
+			}
+		});
+
+		m_sortKeys.swap(m_sortScratch);
+		m_sortBodies.swap(m_bodyScratch);
+	}
+}
+
+void QuadrantIndex::Hash()
+{
+	uint64_t slots = 1;
+	while (slots < 2 * m_cells.size())
+		slots <<= 1;
+
+	m_mask = slots - 1;
+	m_slots.assign(slots, NO_CELL);
+
+	for (uint32_t c = 0; c < m_cells.size(); c++)
+	{
+		uint64_t slot = Mix(m_cells[c].key) & m_mask;
+		while (m_slots[slot] != NO_CELL)
+			slot = (slot + 1) & m_mask;
+
+		m_slots[slot] = c;
+	}
+}
+
+QuadrantCell const* QuadrantIndex::Find(uint64_t const key) const
+{
+	if (m_cells.empty())
+		return nullptr;
+
+	for (uint64_t slot = Mix(key) & m_mask; m_slots[slot] != NO_CELL; slot = (slot + 1) & m_mask)
+	{
+		QuadrantCell const& cell = m_cells[m_slots[slot]];
+		if (cell.key == key)
+			return &cell;
+	}
+
+	return nullptr;
+}
+
+void QuadrantIndex::Aggregate(GravityBodies const& bodies)
+{
+	const auto start = std::chrono::high_resolution_clock::now();
+
+	m_moments.assign(m_cells.size(), {});
+	m_neighbourMass.assign(m_cells.size(), 0);
+
+	// Every cell sums its own bodies in sorted order, so the moments do not depend on the thread count.
+	parallel_for(0, m_cells.size(), CELLS_PER_TASK, [&](size_t const c)
+	{
+		QuadrantCell const& cell = m_cells[c];
+		QuadrantMoments& moments = m_moments[c];
+
+		for (uint32_t k = cell.first; k < cell.first + cell.count; k++)
+		{
+			const uint32_t i = m_bodies[k];
+			const double m = bodies.mass[i];
+
+			moments.mass += m;
+			moments.x += bodies.x[i] * m;
+			moments.y += bodies.y[i] * m;
+			moments.z += bodies.z[i] * m;
+		}
+
+		moments.x /= moments.mass;
+		moments.y /= moments.mass;
+		moments.z /= moments.mass;
+
+		for (uint32_t k = cell.first; k < cell.first + cell.count; k++)
+		{
+			const uint32_t i = m_bodies[k];
+			const double m = bodies.mass[i];
+			const double dx = bodies.x[i] - moments.x, dy = bodies.y[i] - moments.y, dz = bodies.z[i] - moments.z;
+			const double d2 = dx * dx + dy * dy + dz * dz;
+
+			moments.quadrupole[0] += m * (3 * dx * dx - d2);
+			moments.quadrupole[1] += m * (3 * dy * dy - d2);
+			moments.quadrupole[2] += m * (3 * dz * dz - d2);
+			moments.quadrupole[3] += m * 3 * dx * dy;
+			moments.quadrupole[4] += m * 3 * dx * dz;
+			moments.quadrupole[5] += m * 3 * dy * dz;
+		}
+	});
+
+	parallel_for(0, m_cells.size(), CELLS_PER_TASK, [&](size_t const c)
+	{
+		double mass = 0;
+		ForEachNeighbour(m_cells[c].key, [&](QuadrantCell const& cell) { mass += m_moments[&cell - m_cells.data()].mass; });
+		m_neighbourMass[c] = mass;
+	});
+
+	m_aggregateTime = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).
+		count();
+}
+
+void QuadrantIndex::FarField(double const x, double const y, double const z, uint64_t const key, double& ax,
+                             double& ay, double& az) const
+{
+	int32_t cx, cy, cz;
+	MortonDecode(key, cx, cy, cz);
+
+	double sx = 0, sy = 0, sz = 0;
+	for (size_t c = 0; c < m_cells.size(); c++)
+	{
+		int32_t ox, oy, oz;
+		MortonDecode(m_cells[c].key, ox, oy, oz);
+		if (std::abs(ox - cx) <= 1 && std::abs(oy - cy) <= 1 && std::abs(oz - cz) <= 1)
+			continue;
+
+		QuadrantMoments const& moments = m_moments[c];
+		const double* q = moments.quadrupole;
+		const double dx = x - moments.x, dy = y - moments.y, dz = z - moments.z;
+		const double r2 = dx * dx + dy * dy + dz * dz;
+		const double inv = 1 / std::sqrt(r2);
+		const double inv2 = inv * inv;
+		const double inv3 = inv * inv2;
+		const double inv5 = inv3 * inv2;
+
+		// a = -M d / r^3 + Q d / r^5 - 5/2 (d Q d) d / r^7, d pointing from the cell to the point.
+		const double qx = q[0] * dx + q[3] * dy + q[4] * dz;
+		const double qy = q[3] * dx + q[1] * dy + q[5] * dz;
+		const double qz = q[4] * dx + q[5] * dy + q[2] * dz;
+		const double radial = -moments.mass * inv3 - 2.5 * (dx * qx + dy * qy + dz * qz) * inv5 * inv2;
+
+		sx += radial * dx + qx * inv5;
+		sy += radial * dy + qy * inv5;
+		sz += radial * dz + qz * inv5;
+	}
+
+	ax += sx * G_SCREEN;
+	ay += sy * G_SCREEN;
+	az += sz * G_SCREEN;
+}
+
+double QuadrantIndex::NeighbourMassOf(size_t const i) const
+{
+	return i < m_cellOf.size() && m_cellOf[i] != NO_CELL ? m_neighbourMass[m_cellOf[i]] : 0;
+}
+
+QuadrantCell const* QuadrantIndex::CellOf(size_t const i) const
+{
+	return i < m_cellOf.size() && m_cellOf[i] != NO_CELL ? &m_cells[m_cellOf[i]] : nullptr;
+}
@@ -0,0 +1,129 @@
+#pragma once
+
+#include "GravitySolver.h"
+
+#include <cstdint>
+#include <vector>
+
+// Cell coordinates take 21 bits per axis, centred on the origin.
+constexpr int32_t MORTON_MIN = -(1 << 20);
+constexpr int32_t MORTON_MAX = (1 << 20) - 1;
+
+// Interleaves the bits of the three cell coordinates, x lowest, into a Z-order key; coordinates are clamped to
+// [MORTON_MIN, MORTON_MAX].
+uint64_t MortonEncode(int32_t x, int32_t y, int32_t z);
+void MortonDecode(uint64_t key, int32_t& x, int32_t& y, int32_t& z);
+
+// One occupied quadrant: the bodies of the cell are QuadrantIndex::Bodies()[first, first + count).
+struct QuadrantCell
+{
+	uint64_t key;
+	uint32_t first;
+	uint32_t count;
+};
+
+// Mass distribution of one cell about its centre of mass: the traceless quadrupole
+// Q_ij = sum m (3 d_i d_j - |d|^2 delta_ij) as xx, yy, zz, xy, xz, yz, positions in screen units and mass in kg.
+struct QuadrantMoments
+{
+	double mass = 0;
+	double x = 0, y = 0, z = 0;
+	double quadrupole[6] = {};
+};
+
+// Buckets the bodies with mass into cubic quadrants of g_quadrantSize around the origin, the cells the grid overlay
+// shows. Every Build computes the Morton key of each body, radix sorts the bodies by key in parallel and stores the
+// occupied cells in key order plus an open-addressing hash from key to cell, so finding a cell, its bodies or its
+// neighbours takes constant time. Cells are numbered like Planet::GetQuadrant did: the cell of a position p is round(p
+// / size) per axis.
+class QuadrantIndex
+{
+public:
+	// Edge length in screen units.
+	explicit QuadrantIndex(double cellSize);
+
+	void SetCellSize(double cellSize);
+	[[nodiscard]] double CellSize() const { return m_cellSize; }
+
+	void Build(GravityBodies const& bodies);
+
+	[[nodiscard]] int32_t Coordinate(double value) const;
+	[[nodiscard]] uint64_t Key(double x, double y, double z) const;
+
+	// Occupied cells in key order and the body indices they refer to.
+	[[nodiscard]] std::vector<QuadrantCell> const& Cells() const { return m_cells; }
+	[[nodiscard]] std::vector<uint32_t> const& Bodies() const { return m_bodies; }
+
+	// Cell of a key, nullptr if no body is in it.
+	[[nodiscard]] QuadrantCell const* Find(uint64_t key) const;
+
+	// Cell of body i in the last Build, nullptr for massless bodies.
+	[[nodiscard]] QuadrantCell const* CellOf(size_t i) const;
+
+	// Calls f(cell) for every occupied cell of the 27 around and including the cell of key.
+	template <typename F>
+	void ForEachNeighbour(uint64_t key, F const& f) const;
+
+	// Computes the moments of every cell and the mass of its neighbourhood from the bodies of the last Build, cell by
+	// cell in parallel.
+	void Aggregate(GravityBodies const& bodies);
+
+	// Per cell, in the order of Cells().
+	[[nodiscard]] std::vector<QuadrantMoments> const& Moments() const { return m_moments; }
+	[[nodiscard]] std::vector<double> const& NeighbourMass() const { return m_neighbourMass; }
+
+	// Mass of the 27 cells around body i, 0 for massless bodies.
+	[[nodiscard]] double NeighbourMassOf(size_t i) const;
+
+	// Adds the acceleration of all cells outside the neighbourhood of key at the point, from their moments up to the
+	// quadrupole, in screen units per second squared. Together with the pairwise forces inside the neighbourhood this
+	// replaces the full pairwise sum.
+	void FarField(double x, double y, double z, uint64_t key, double& ax, double& ay, double& az) const;
+
+	// ms
+	[[nodiscard]] double BuildTime() const { return m_buildTime; }
+	[[nodiscard]] double AggregateTime() const { return m_aggregateTime; }
+
+private:
+	static constexpr uint64_t EMPTY = ~0ull;
+
+	void Sort(size_t count);
+	void Hash();
+
+	double m_cellSize;
+	double m_buildTime = 0;
+	double m_aggregateTime = 0;
+
+	std::vector<uint64_t> m_keys; // per body, EMPTY when massless
+	std::vector<uint32_t> m_cellOf; // per body, index into m_cells
+	std::vector<uint32_t> m_bodies; // body indices sorted by key
+	std::vector<QuadrantCell> m_cells;
+	std::vector<QuadrantMoments> m_moments;
+	std::vector<double> m_neighbourMass;
+
+	std::vector<uint64_t> m_sortKeys, m_sortScratch;
+	std::vector<uint32_t> m_sortBodies, m_bodyScratch;
+
+	std::vector<uint32_t> m_slots; // index into m_cells, or UINT32_MAX
+	uint64_t m_mask = 0;
+};
+
+template <typename F>
+void QuadrantIndex::ForEachNeighbour(uint64_t const key, F const& f) const
+{
+	int32_t cx, cy, cz;
+	MortonDecode(key, cx, cy, cz);
+
+	for (int32_t dz = -1; dz <= 1; dz++)
+		for (int32_t dy = -1; dy <= 1; dy++)
+			for (int32_t dx = -1; dx <= 1; dx++)
+			{
+				const int32_t x = cx + dx, y = cy + dy, z = cz + dz;
+				if (x < MORTON_MIN || x > MORTON_MAX || y < MORTON_MIN || y > MORTON_MAX || z < MORTON_MIN ||
+					z > MORTON_MAX)
+					continue;
+
+				if (QuadrantCell const* cell = Find(MortonEncode(x, y, z)))
+					f(*cell);
+			}
+}
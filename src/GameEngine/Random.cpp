@@ -0,0 +1,223 @@
+#include "Random.h"
+
+#include "Simd.h"
+
+#include <algorithm>
+
+namespace
+{
+	constexpr uint32_t PHILOX_M0 = 0xD2511F53;
+	constexpr uint32_t PHILOX_M1 = 0xCD9E8D57;
+	constexpr uint32_t PHILOX_W0 = 0x9E3779B9;
+	constexpr uint32_t PHILOX_W1 = 0xBB67AE85;
+	constexpr int PHILOX_ROUNDS = 10;
+
+	// Blocks generated per batch by Fill.
+	constexpr size_t BATCH = 16;
+
+	const SimdLevel g_simdLevel = GetSimdLevel();
+
+	double ToDouble(uint32_t const high, uint32_t const low, double const min, double const range)
+	{
+		const uint64_t bits = (static_cast<uint64_t>(high) << 32 | low) >> 11;
+		return min + static_cast<double>(bits) * 0x1p-53 * range;
+	}
+
+	float ToFloat(uint32_t const word, float const min, float const range)
+	{
+		return min + static_cast<float>(word >> 8) * 0x1p-24f * range;
+	}
+
+#ifdef SIMD_X86
+	// 32 x 32 -> 64 bit products of all eight lanes, split into low and high halves.
+	SIMD_TARGET("avx2")
+	void MultiplyAVX2(__m256i const a, __m256i const m, __m256i& low, __m256i& high)
+	{
+		const __m256i even = _mm256_mul_epu32(a, m);
+		const __m256i odd = _mm256_mul_epu32(_mm256_srli_epi64(a, 32), m);
+		low = _mm256_blend_epi32(even, _mm256_slli_epi64(odd, 32), 0xAA);
+		high = _mm256_blend_epi32(_mm256_srli_epi64(even, 32), odd, 0xAA);
+	}
+
+	// Philox on eight consecutive counters at once, one block per 32 bit lane.
+	SIMD_TARGET("avx2")
+	void PhiloxAVX2(uint32_t const first, uint32_t const sequence, uint32_t const id, uint32_t const purpose,
+	                std::array<uint32_t, 2> const key, uint32_t* words)
+	{
+		const __m256i m0 = _mm256_set1_epi32(static_cast<int>(PHILOX_M0));
+		const __m256i m1 = _mm256_set1_epi32(static_cast<int>(PHILOX_M1));
+
+		__m256i c0 = _mm256_add_epi32(_mm256_set1_epi32(static_cast<int>(first)),
+		                              _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+		__m256i c1 = _mm256_set1_epi32(static_cast<int>(sequence));
+		__m256i c2 = _mm256_set1_epi32(static_cast<int>(id));
+		__m256i c3 = _mm256_set1_epi32(static_cast<int>(purpose));
+		uint32_t k0 = key[0], k1 = key[1];
+
+		for (int round = 0; round < PHILOX_ROUNDS; round++)
+		{
+			__m256i low0, high0, low1, high1;
+			MultiplyAVX2(c0, m0, low0, high0);
+			MultiplyAVX2(c2, m1, low1, high1);
+
+			c0 = _mm256_xor_si256(_mm256_xor_si256(high1, c1), _mm256_set1_epi32(static_cast<int>(k0)));
+			c1 = low1;
+			c2 = _mm256_xor_si256(_mm256_xor_si256(high0, c3), _mm256_set1_epi32(static_cast<int>(k1)));
+			c3 = low0;
+
+			k0 += PHILOX_W0;
+			k1 += PHILOX_W1;
+		}
+
+		alignas(32) uint32_t lanes[4][8];
+		_mm256_store_si256(reinterpret_cast<__m256i*>(lanes[0]), c0);
+		_mm256_store_si256(reinterpret_cast<__m256i*>(lanes[1]), c1);
+		_mm256_store_si256(reinterpret_cast<__m256i*>(lanes[2]), c2);
+		_mm256_store_si256(reinterpret_cast<__m256i*>(lanes[3]), c3);
+
+		for (int block = 0; block < 8; block++)
+			for (int word = 0; word < 4; word++)
+				words[block * 4 + word] = lanes[word][block];
+	}
+#endif
+}
+
+uint64_t splitmix64(uint64_t& state)
+{
+	uint64_t z = state += 0x9E3779B97F4A7C15;
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EB;
+	return z ^ (z >> 31);
+}
+
+Random::Random(uint64_t const seed, RandomStream const purpose, uint32_t const id, uint32_t const sequence) :
+	m_sequence(sequence),
+	m_id(id),
+	m_purpose(static_cast<uint32_t>(purpose))
+{
+	uint64_t state = seed;
+	const uint64_t key = splitmix64(state);
+	m_key = {static_cast<uint32_t>(key), static_cast<uint32_t>(key >> 32)};
+}
+
+Random::Block Random::Philox(Block counter, std::array<uint32_t, 2> key)
+{
+	for (int round = 0; round < PHILOX_ROUNDS; round++)
+	{
+		const uint64_t product0 = static_cast<uint64_t>(PHILOX_M0) * counter[0];
+		const uint64_t product1 = static_cast<uint64_t>(PHILOX_M1) * counter[2];
+
+		counter = {
+			static_cast<uint32_t>(product1 >> 32) ^ counter[1] ^ key[0],
+			static_cast<uint32_t>(product1),
+			static_cast<uint32_t>(product0 >> 32) ^ counter[3] ^ key[1],
+			static_cast<uint32_t>(product0)
+		};
+
+		key[0] += PHILOX_W0;
+		key[1] += PHILOX_W1;
+	}
+
+	return counter;
+}
+
+void Random::Blocks(uint64_t const first, size_t const count, uint32_t* words) const
+{
+	size_t block = 0;
+
+#ifdef SIMD_X86
+	if (g_simdLevel != SimdLevel::Scalar)
+	{
+		for (; block + 8 <= count; block += 8)
+			PhiloxAVX2(static_cast<uint32_t>(first + block), m_sequence, m_id, m_purpose, m_key, words + block * 4);
+	}
+#endif
+
+	for (; block < count; block++)
+	{
+		const Block values = Philox({static_cast<uint32_t>(first + block), m_sequence, m_id, m_purpose}, m_key);
+		std::copy(values.begin(), values.end(), words + block * 4);
+	}
+}
+
+void Random::Words(uint64_t const first, size_t const count, uint32_t* words) const
+{
+	uint32_t blocks[BATCH * 4];
+
+	size_t done = 0;
+	while (done < count)
+	{
+		const uint64_t position = first + done;
+		const uint64_t block = position / 4;
+		const size_t offset = static_cast<size_t>(position % 4);
+		const size_t blockCount = std::min(BATCH, (offset + count - done + 3) / 4);
+
+		Blocks(block, blockCount, blocks);
+
+		const size_t available = std::min(blockCount * 4 - offset, count - done);
+		std::copy(blocks + offset, blocks + offset + available, words + done);
+		done += available;
+	}
+}
+
+uint32_t Random::NextUInt()
+{
+	const uint64_t block = m_position / 4;
+	if (block != m_cachedBlock)
+	{
+		m_cache = Philox({static_cast<uint32_t>(block), m_sequence, m_id, m_purpose}, m_key);
+		m_cachedBlock = block;
+	}
+
+	return m_cache[m_position++ % 4];
+}
+
+double Random::Uniform(double const min, double const max)
+{
+	const uint32_t high = NextUInt();
+	const uint32_t low = NextUInt();
+	return ToDouble(high, low, min, max - min);
+}
+
+float Random::Uniform(float const min, float const max)
+{
+	return ToFloat(NextUInt(), min, max - min);
+}
+
+void Random::Fill(double* values, size_t count, double const min, double const max)
+{
+	uint32_t words[BATCH * 4];
+	const double range = max - min;
+
+	while (count > 0)
+	{
+		const size_t n = std::min(count, BATCH * 2);
+		Words(m_position, n * 2, words);
+		m_position += n * 2;
+
+		for (size_t i = 0; i < n; i++)
+			values[i] = ToDouble(words[i * 2], words[i * 2 + 1], min, range);
+
+		values += n;
+		count -= n;
+	}
+}
+
+void Random::Fill(float* values, size_t count, float const min, float const max)
+{
+	uint32_t words[BATCH * 4];
+	const float range = max - min;
+
+	while (count > 0)
+	{
+		const size_t n = std::min(count, BATCH * 4);
+		Words(m_position, n, words);
+		m_position += n;
+
+		for (size_t i = 0; i < n; i++)
+			values[i] = ToFloat(words[i], min, range);
+
+		values += n;
+		count -= n;
+	}
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+// What a stream is drawn for. Streams of different purposes never share a counter, so adding draws to one of them
+// does not shift the values any other one sees.
+enum class RandomStream : uint32_t
+{
+	General,
+	SolarSystem,
+	Composition,
+	Rotation,
+	DensityProfile,
+	Escape
+};
+
+// One SplitMix64 step: advances state and returns a well mixed 64 bit value.
+uint64_t splitmix64(uint64_t& state);
+
+// Philox4x32-10 counter based generator (Salmon et al., "Parallel random numbers: as easy as 1, 2, 3"). Word n of a
+// stream is a pure function of the seed, the stream (purpose, id, sequence) and n, with no state shared between
+// streams. A body can therefore own a stream per frame (id = body id, sequence = frame), any thread can draw from
+// it, and the same seed replays every run bit-exactly. Each stream holds 2^34 words.
+class Random
+{
+public:
+	explicit Random(uint64_t seed, RandomStream purpose = RandomStream::General, uint32_t id = 0,
+	                uint32_t sequence = 0);
+
+	uint32_t NextUInt();
+
+	// Uniform in [min, max): doubles use 53 bits from two words, floats 24 bits from one.
+	double Uniform(double min, double max);
+	float Uniform(float min, float max);
+
+	// The same values as count calls to Uniform, generated several Philox blocks at a time with AVX2 when available.
+	void Fill(double* values, size_t count, double min, double max);
+	void Fill(float* values, size_t count, float min, float max);
+
+	// Index of the next word, for splitting a stream between threads or replaying part of it.
+	[[nodiscard]] uint64_t Position() const { return m_position; }
+	void Seek(uint64_t position) { m_position = position; }
+
+	typedef std::array<uint32_t, 4> Block;
+
+	// Ten Philox rounds of counter under key.
+	static Block Philox(Block counter, std::array<uint32_t, 2> key);
+
+private:
+	// Words [first, first + count) of this stream.
+	void Words(uint64_t first, size_t count, uint32_t* words) const;
+	void Blocks(uint64_t first, size_t count, uint32_t* words) const;
+
+	std::array<uint32_t, 2> m_key;
+	uint32_t m_sequence;
+	uint32_t m_id;
+	uint32_t m_purpose;
+
+	uint64_t m_position = 0;
+
+	// Last block used by NextUInt.
+	uint64_t m_cachedBlock = UINT64_MAX;
+	Block m_cache{};
+};
@@ -0,0 +1,64 @@
+#include "Simd.h"
+
+#if defined(SIMD_X86) && defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace
+{
+	SimdLevel DetectSimdLevel()
+	{
+#if defined(SIMD_X86) && defined(_MSC_VER)
+		int info[4] = {};
+		__cpuid(info, 0);
+		if (info[0] < 7)
+			return SimdLevel::Scalar;
+
+		__cpuid(info, 1);
+		const bool fma = (info[2] & (1 << 12)) != 0;
+		const bool osxsave = (info[2] & (1 << 27)) != 0;
+		if (!fma || !osxsave)
+			return SimdLevel::Scalar;
+
+		// The OS has to save the ymm (and for AVX-512 the opmask and zmm) state on context switches.
+		const unsigned long long xcr0 = _xgetbv(0);
+		if ((xcr0 & 0x6) != 0x6)
+			return SimdLevel::Scalar;
+
+		__cpuidex(info, 7, 0);
+		const bool avx2 = (info[1] & (1 << 5)) != 0;
+		const bool avx512 = (info[1] & (1 << 16)) != 0;
+
+		if (avx512 && (xcr0 & 0xe6) == 0xe6)
+			return SimdLevel::AVX512;
+		if (avx2)
+			return SimdLevel::AVX2;
+		return SimdLevel::Scalar;
+#elif defined(SIMD_X86)
+		__builtin_cpu_init();
+		if (__builtin_cpu_supports("avx512f"))
+			return SimdLevel::AVX512;
+		if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+			return SimdLevel::AVX2;
+		return SimdLevel::Scalar;
+#else
+		return SimdLevel::Scalar;
+#endif
+	}
+}
+
+SimdLevel GetSimdLevel()
+{
+	static const SimdLevel level = DetectSimdLevel();
+	return level;
+}
+
+const char* GetSimdName(SimdLevel const level)
+{
+	switch (level)
+	{
+	case SimdLevel::AVX512: return "AVX-512";
+	case SimdLevel::AVX2: return "AVX2";
+	default: return "Scalar";
+	}
+}
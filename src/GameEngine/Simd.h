@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstddef>
+#include <limits>
+#include <new>
+#include <vector>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define SIMD_X86 1
+#include <immintrin.h>
+#endif
+
+// Kernels for a specific instruction set are compiled with that target enabled on GCC and Clang, MSVC accepts the
+// intrinsics without any annotation. Callers must check GetSimdLevel() before entering such a function.
+#if defined(SIMD_X86) && (defined(__GNUC__) || defined(__clang__))
+#define SIMD_TARGET(isa) __attribute__((target(isa)))
+#else
+#define SIMD_TARGET(isa)
+#endif
+
+enum class SimdLevel
+{
+	Scalar,
+	AVX2,
+	AVX512
+};
+
+// Highest instruction set supported by both the CPU and the operating system.
+SimdLevel GetSimdLevel();
+const char* GetSimdName(SimdLevel level);
+
+// Allocator handing out memory aligned to a full cache line (and therefore to any vector register width).
+template <typename T, size_t A = 64>
+struct AlignedAllocator
+{
+	typedef T value_type;
+
+	template <typename U>
+	struct rebind
+	{
+		typedef AlignedAllocator<U, A> other;
+	};
+
+	AlignedAllocator() noexcept = default;
+
+	template <typename U>
+	AlignedAllocator(const AlignedAllocator<U, A>&) noexcept
+	{
+	}
+
+	T* allocate(size_t const n)
+	{
+		if (n > std::numeric_limits<size_t>::max() / sizeof(T))
+			throw std::bad_array_new_length();
+
+		return static_cast<T*>(::operator new(n * sizeof(T), std::align_val_t(A)));
+	}
+
+	void deallocate(T* p, size_t) noexcept
+	{
+		::operator delete(p, std::align_val_t(A));
+	}
+
+	template <typename U>
+	bool operator==(const AlignedAllocator<U, A>&) const noexcept { return true; }
+
+	template <typename U>
+	bool operator!=(const AlignedAllocator<U, A>&) const noexcept { return false; }
+};
+
+template <typename T>
+using AlignedVector = std::vector<T, AlignedAllocator<T>>;
@@ -0,0 +1,164 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+// Keys of a SlotMap carry a slot index in the low SLOT_INDEX_BITS bits and a generation above them, so a key whose slot
+// has since been given to another value no longer finds anything.
+constexpr uint32_t SLOT_INDEX_BITS = 24;
+constexpr uint32_t SLOT_INDEX_MASK = (1u << SLOT_INDEX_BITS) - 1;
+
+// Values stored densely with O(1) access by key: a sparse table maps the slot index of a key to the value's position,
+// the values and their keys sit contiguously in two parallel arrays. Removal swaps the last value into the hole, and
+// Align puts the values in the order of another array, such as the bodies, so batch passes stream over them in body
+// order.
+//
+// Like a std::vector, inserting, erasing and aligning move values and invalidate pointers to them; lookups may run
+// concurrently with each other but not with changes.
+template <typename T>
+class SlotMap
+{
+public:
+	typedef uint32_t Key;
+
+	[[nodiscard]] size_t Size() const { return m_values.size(); }
+	[[nodiscard]] bool Empty() const { return m_values.empty(); }
+
+	[[nodiscard]] bool Contains(Key const key) const { return Position(key) != NONE; }
+
+	[[nodiscard]] T* Find(Key const key)
+	{
+		const uint32_t position = Position(key);
+		return position != NONE ? &m_values[position] : nullptr;
+	}
+
+	[[nodiscard]] T const* Find(Key const key) const
+	{
+		const uint32_t position = Position(key);
+		return position != NONE ? &m_values[position] : nullptr;
+	}
+
+	[[nodiscard]] T& At(Key const key)
+	{
+		T* value = Find(key);
+		if (value == nullptr)
+			throw std::out_of_range("No value for key");
+
+		return *value;
+	}
+
+	// The value of key, value-initialized first if there is none, like std::map::operator[].
+	T& operator[](Key const key)
+	{
+		T* value = Find(key);
+		return value != nullptr ? *value : Insert(key, T{});
+	}
+
+	// Stores value under key, replacing any value the key already has.
+	T& Insert(Key const key, T const& value)
+	{
+		if (T* existing = Find(key))
+		{
+			*existing = value;
+			return *existing;
+		}
+
+		const uint32_t slot = key & SLOT_INDEX_MASK;
+		if (slot >= m_slots.size())
+			m_slots.resize(slot + 1, NONE);
+
+		// A slot holds one key at a time; an older generation still in it is dropped.
+		if (m_slots[slot] != NONE)
+			Erase(m_keys[m_slots[slot]]);
+
+		m_slots[slot] = static_cast<uint32_t>(m_values.size());
+		m_keys.push_back(key);
+		m_values.push_back(value);
+		return m_values.back();
+	}
+
+	void Erase(Key const key)
+	{
+		const uint32_t position = Position(key);
+		if (position == NONE)
+			return;
+
+		const uint32_t last = static_cast<uint32_t>(m_values.size() - 1);
+		if (position != last)
+			Swap(position, last);
+
+		m_slots[key & SLOT_INDEX_MASK] = NONE;
+		m_keys.pop_back();
+		m_values.pop_back();
+	}
+
+	// Reorders the values to follow the keys keyOf gives for items and drops every value whose key is not among them, in
+	// one pass of swaps. Items without a value are skipped, so the values line up with items exactly when all of them
+	// have one.
+	template <typename Items, typename KeyOf>
+	void Align(Items const& items, KeyOf const& keyOf)
+	{
+		uint32_t placed = 0;
+		for (auto const& item : items)
+		{
+			const uint32_t position = Position(keyOf(item));
+			if (position == NONE || position < placed)
+				continue;
+
+			if (position != placed)
+				Swap(position, placed);
+			placed++;
+		}
+
+		for (size_t k = placed; k < m_keys.size(); k++)
+			m_slots[m_keys[k] & SLOT_INDEX_MASK] = NONE;
+
+		m_keys.resize(placed);
+		m_values.erase(m_values.begin() + placed, m_values.end());
+	}
+
+	void Clear()
+	{
+		m_values.clear();
+		m_keys.clear();
+		m_slots.clear();
+	}
+
+	// Values and their keys in storage order.
+	[[nodiscard]] T* Data() { return m_values.data(); }
+	[[nodiscard]] T const* Data() const { return m_values.data(); }
+	[[nodiscard]] std::vector<Key> const& Keys() const { return m_keys; }
+
+	typename std::vector<T>::iterator begin() { return m_values.begin(); }
+	typename std::vector<T>::iterator end() { return m_values.end(); }
+	typename std::vector<T>::const_iterator begin() const { return m_values.begin(); }
+	typename std::vector<T>::const_iterator end() const { return m_values.end(); }
+
+private:
+	static constexpr uint32_t NONE = ~0u;
+
+	uint32_t Position(Key const key) const
+	{
+		const uint32_t slot = key & SLOT_INDEX_MASK;
+		if (slot >= m_slots.size())
+			return NONE;
+
+		const uint32_t position = m_slots[slot];
+		return position != NONE && m_keys[position] == key ? position : NONE;
+	}
+
+	void Swap(uint32_t const a, uint32_t const b)
+	{
+		std::swap(m_values[a], m_values[b]);
+		std::swap(m_keys[a], m_keys[b]);
+		m_slots[m_keys[a] & SLOT_INDEX_MASK] = a;
+		m_slots[m_keys[b] & SLOT_INDEX_MASK] = b;
+	}
+
+	std::vector<T> m_values;
+	std::vector<Key> m_keys;
+	std::vector<uint32_t> m_slots; // position of the value of every slot index, NONE if empty
+};
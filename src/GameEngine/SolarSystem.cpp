@@ -0,0 +1,76 @@
+#include "SolarSystem.h"
+
+#include "PhysicalConstants.h"
+
+#include <cmath>
+
+SolarSystem::SolarSystem(uint64_t const seed) :
+	m_random(seed, RandomStream::SolarSystem)
+{
+}
+
+BodySeed SolarSystem::Star()
+{
+	BodySeed star{};
+	star.mass = SYSTEM_MASS;
+	star.density = 150000;
+	star.temperature = 15000000;
+	return star;
+}
+
+std::vector<BodySeed> SolarSystem::Planets(uint32_t const count, double const starRadius)
+{
+	std::vector<double> masses(count);
+	for (double& mass : masses)
+	{
+		if (m_random.Uniform(0., 1.) < .9)
+			mass = m_random.Uniform(MOON_MASS * .001, EARTH_MASS * 10);
+		else
+			mass = m_random.Uniform(EARTH_MASS * 10, EARTH_MASS * 100.);
+	}
+
+	const double maxDistance = starRadius * 20.;
+	const double boundary = starRadius * 1.5;
+
+	std::vector<BodySeed> planets(count);
+	for (uint32_t i = 0; i < count; i++)
+	{
+		BodySeed& planet = planets[i];
+		planet.mass = masses[i];
+		planet.density = sqrt(sqrt(planet.mass) / (planet.mass > 5e25 ? m_random.Uniform(6e5, 7e5) : m_random.Uniform(1e5, 2e5)));
+		planet.temperature = 1;
+		planet.velocity = m_random.Uniform(EARTH_SUN_VELOCITY * .01, EARTH_SUN_VELOCITY * 10.);
+
+		// A random point in the square, turned around the y axis, scaled and given a height within the star's radius.
+		double* position = planet.position;
+		double distance = 0;
+		while (distance <= boundary)
+		{
+			const double rotation = m_random.Uniform(0., 2. * PI);
+			const double scale = m_random.Uniform(-maxDistance, maxDistance);
+			const double x = m_random.Uniform(-1., 1.);
+			const double z = m_random.Uniform(-1., 1.);
+
+			position[0] = (x * cos(rotation) + z * sin(rotation)) * scale;
+			position[2] = (z * cos(rotation) - x * sin(rotation)) * scale;
+			position[1] = m_random.Uniform(-starRadius, starRadius);
+
+			distance = sqrt(position[0] * position[0] + position[1] * position[1] + position[2] * position[2]);
+		}
+
+		// Perpendicular to the star in the orbital plane, with a small vertical component.
+		planet.direction[0] = position[2] / distance;
+		planet.direction[1] = m_random.Uniform(-.05, .05);
+		planet.direction[2] = -position[0] / distance;
+	}
+
+	return planets;
+}
+
+double EstimateRadius(double const mass)
+{
+	double r = sqrt(mass) * MASS_RADIUS_NORM + MASS_RADIUS_OFFSET;
+	r -= ((pow(mass, 2) * G) / mass) * 1.861399E-11;
+
+	return r;
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include "Random.h"
+
+#include <cstdint>
+#include <vector>
+
+// Initial conditions of one body in SI units: position in metres, direction of motion and speed in m/s. These are the
+// arguments Game::CreatePlanet takes.
+struct BodySeed
+{
+	double mass = 0;
+	double density = 0;
+	double temperature = 0;
+	double position[3] = {};
+	double direction[3] = {};
+	double velocity = 0;
+};
+
+// Draws the initial solar system: a star at rest in the origin and planets on roughly tangential orbits in a thick disk
+// around it. Shared by Game::CreateSolarSystem and the headless runner so both start from the same distribution; the
+// same seed gives the same system.
+class SolarSystem
+{
+public:
+	explicit SolarSystem(uint64_t seed);
+
+	[[nodiscard]] static BodySeed Star();
+
+	// Planets outside 1.5 and within 20 star radii, the radius being whatever the star's density profile gave.
+	[[nodiscard]] std::vector<BodySeed> Planets(uint32_t count, double starRadius);
+
+private:
+	Random m_random;
+};
+
+// First guess of a body's radius in metres from its mass in kg, before a density profile is available.
+double EstimateRadius(double mass);
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+
+// CPU stages of a simulation frame, timed separately so their scaling with the thread count can be compared.
+enum class Stage
+{
+	CenterOfMass,
+	Quadrants,
+	Gravity,
+	Collision,
+	Drift,
+	Clean,
+	Escape,
+	Vertices,
+	Count
+};
+
+inline const char* GetStageName(Stage const stage)
+{
+	switch (stage)
+	{
+	case Stage::CenterOfMass: return "Center of mass";
+	case Stage::Quadrants: return "Quadrants";
+	case Stage::Gravity: return "Gravity";
+	case Stage::Collision: return "Collision";
+	case Stage::Drift: return "Drift";
+	case Stage::Clean: return "Clean";
+	case Stage::Escape: return "Escape";
+	case Stage::Vertices: return "Vertices";
+	default: return "";
+	}
+}
+
+// Wall clock time of the last run of every stage, in ms.
+struct StageTimes
+{
+	double time[static_cast<size_t>(Stage::Count)] = {};
+
+	double& operator[](Stage const stage) { return time[static_cast<size_t>(stage)]; }
+	double operator[](Stage const stage) const { return time[static_cast<size_t>(stage)]; }
+};
+
+// Records the time from construction to Stop or destruction, whichever comes first, as the time of one stage.
+class StageTimer
+{
+public:
+	StageTimer(StageTimes& times, Stage const stage) :
+		m_times(times),
+		m_stage(stage),
+		m_start(std::chrono::high_resolution_clock::now())
+	{
+	}
+
+	~StageTimer()
+	{
+		Stop();
+	}
+
+	void Stop()
+	{
+		if (m_stopped)
+			return;
+
+		m_times[m_stage] = std::chrono::duration<double, std::milli>(
+			std::chrono::high_resolution_clock::now() - m_start).count();
+		m_stopped = true;
+	}
+
+	StageTimer(const StageTimer&) = delete;
+	StageTimer& operator=(const StageTimer&) = delete;
+
+private:
+	StageTimes& m_times;
+	Stage m_stage;
+	std::chrono::high_resolution_clock::time_point m_start;
+	bool m_stopped = false;
+};
@@ -0,0 +1,170 @@
+#include "ThreadPool.h"
+
+ThreadPool g_threadPool;
+
+namespace
+{
+	// Pool and queue of the worker running on this thread, the shared queue is used by any other thread.
+	thread_local ThreadPool const* t_pool = nullptr;
+	thread_local size_t t_queue = 0;
+}
+
+ThreadPool::ThreadPool(size_t const threads)
+{
+	Start(threads);
+}
+
+ThreadPool::~ThreadPool()
+{
+	Stop();
+}
+
+void ThreadPool::Resize(size_t const threads)
+{
+	Stop();
+	Start(threads);
+}
+
+void ThreadPool::Start(size_t const threads)
+{
+	m_stop = false;
+
+	const size_t workers = std::max<size_t>(threads, 1) - 1;
+	for (size_t i = 0; i <= workers; i++)
+		m_queues.push_back(std::make_unique<Queue>());
+
+	for (size_t i = 0; i < workers; i++)
+		m_workers.emplace_back(&ThreadPool::Work, this, i);
+}
+
+void ThreadPool::Stop()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stop = true;
+	}
+	m_wake.notify_all();
+
+	for (std::thread& worker : m_workers)
+		worker.join();
+
+	m_workers.clear();
+	m_queues.clear();
+}
+
+size_t ThreadPool::CurrentQueue() const
+{
+	return t_pool == this ? t_queue : m_workers.size();
+}
+
+void ThreadPool::For(size_t const begin, size_t const end, size_t const grain, RangeFunction const& function)
+{
+	if (begin >= end)
+		return;
+
+	const size_t size = std::max<size_t>(grain, 1);
+	if (m_workers.empty() || end - begin <= size)
+	{
+		function(begin, end);
+		return;
+	}
+
+	std::atomic<size_t> remaining{end - begin};
+	const size_t queue = CurrentQueue();
+
+	Execute({&function, begin, end, size, &remaining}, queue);
+
+	// Help with whatever is queued until the last piece of this range has finished, so remaining outlives its users.
+	while (remaining.load(std::memory_order_acquire) > 0)
+	{
+		Range range;
+		if (Pop(queue, range) || Steal(queue, range))
+			Execute(range, queue);
+		else
+			std::this_thread::yield();
+	}
+}
+
+void ThreadPool::Execute(Range range, size_t const queue)
+{
+	while (range.end - range.begin > range.grain)
+	{
+		const size_t middle = range.begin + (range.end - range.begin) / 2;
+		Push(queue, {range.function, middle, range.end, range.grain, range.remaining});
+		range.end = middle;
+	}
+
+	(*range.function)(range.begin, range.end);
+	range.remaining->fetch_sub(range.end - range.begin, std::memory_order_acq_rel);
+}
+
+void ThreadPool::Push(size_t const queue, Range const& range)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_queues[queue]->mutex);
+		m_queues[queue]->ranges.push_back(range);
+	}
+	m_queued.fetch_add(1, std::memory_order_release);
+
+	// Taking the lock orders the increment before a sleeping worker's predicate check, so the wake-up cannot be lost.
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+	}
+	m_wake.notify_one();
+}
+
+bool ThreadPool::Pop(size_t const queue, Range& range)
+{
+	std::lock_guard<std::mutex> lock(m_queues[queue]->mutex);
+
+	std::deque<Range>& ranges = m_queues[queue]->ranges;
+	if (ranges.empty())
+		return false;
+
+	range = ranges.back();
+	ranges.pop_back();
+	m_queued.fetch_sub(1, std::memory_order_relaxed);
+	return true;
+}
+
+bool ThreadPool::Steal(size_t const queue, Range& range)
+{
+	const size_t queues = m_queues.size();
+	for (size_t i = 1; i < queues; i++)
+	{
+		Queue& victim = *m_queues[(queue + i) % queues];
+		std::lock_guard<std::mutex> lock(victim.mutex);
+
+		if (victim.ranges.empty())
+			continue;
+
+		range = victim.ranges.front();
+		victim.ranges.pop_front();
+		m_queued.fetch_sub(1, std::memory_order_relaxed);
+		return true;
+	}
+
+	return false;
+}
+
+void ThreadPool::Work(size_t const queue)
+{
+	t_pool = this;
+	t_queue = queue;
+
+	while (true)
+	{
+		Range range;
+		if (Pop(queue, range) || Steal(queue, range))
+		{
+			Execute(range, queue);
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_wake.wait(lock, [this] { return m_stop || m_queued.load(std::memory_order_acquire) > 0; });
+
+		if (m_stop)
+			return;
+	}
+}
@@ -0,0 +1,137 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// Work-stealing scheduler for the CPU simulation stages. Every worker owns a deque of index ranges. A thread working
+// on a range keeps splitting it in halves down to the grain size, pushes the upper halves to the back of its own deque
+// and runs the lowest piece; it then takes more work from the back of its own deque and, once that is empty, steals
+// from the front of another deque, where the largest ranges are. The thread calling For joins in until the whole
+// range is done, so For may be called from inside a running task.
+class ThreadPool
+{
+public:
+	typedef std::function<void(size_t begin, size_t end)> RangeFunction;
+
+	explicit ThreadPool(size_t threads = std::thread::hardware_concurrency());
+	~ThreadPool();
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	// Number of threads taking part in For, including the calling thread.
+	[[nodiscard]] size_t Size() const { return m_workers.size() + 1; }
+
+	// Must not be called while a For is running.
+	void Resize(size_t threads);
+
+	// Calls function on disjoint pieces of [begin, end) of at most grain indices and returns when all are done.
+	void For(size_t begin, size_t end, size_t grain, RangeFunction const& function);
+
+private:
+	struct Range
+	{
+		RangeFunction const* function;
+		size_t begin;
+		size_t end;
+		size_t grain;
+		std::atomic<size_t>* remaining;
+	};
+
+	struct Queue
+	{
+		std::mutex mutex;
+		std::deque<Range> ranges;
+	};
+
+	void Start(size_t threads);
+	void Stop();
+	void Work(size_t queue);
+	void Execute(Range range, size_t queue);
+	void Push(size_t queue, Range const& range);
+	bool Pop(size_t queue, Range& range);
+	bool Steal(size_t queue, Range& range);
+	[[nodiscard]] size_t CurrentQueue() const;
+
+	std::vector<std::thread> m_workers;
+	std::vector<std::unique_ptr<Queue>> m_queues; // one per worker, the last one is shared by all other threads
+
+	std::mutex m_mutex;
+	std::condition_variable m_wake;
+	std::atomic<size_t> m_queued{0};
+	bool m_stop = false;
+};
+
+extern ThreadPool g_threadPool;
+
+// Grain used when none is given: about eight pieces per thread.
+inline size_t default_grain(size_t const count)
+{
+	return std::max<size_t>(1, count / (8 * g_threadPool.Size()));
+}
+
+// Calls f(i) for every i in [begin, end) on g_threadPool, in pieces of at most grain indices (0 picks one).
+template <typename F>
+void parallel_for(size_t const begin, size_t const end, size_t const grain, F const& f)
+{
+	if (begin >= end)
+		return;
+
+	g_threadPool.For(begin, end, grain > 0 ? grain : default_grain(end - begin), [&f](size_t first, size_t last)
+	{
+		for (size_t i = first; i < last; i++)
+			f(i);
+	});
+}
+
+template <typename F>
+void parallel_for(size_t const begin, size_t const end, F const& f)
+{
+	parallel_for(begin, end, 0, f);
+}
+
+// Folds every chunk of grain indices of [begin, end) with accumulator = reduce(accumulator, i), starting from identity,
+// and combines the chunk results in index order. Accumulators are moved through reduce and combine, so containers
+// can be appended to in place. The chunks do not depend on the number of threads, so neither does
+// the result, floating point rounding included.
+template <typename T, typename Reduce, typename Combine>
+T parallel_reduce(size_t const begin, size_t const end, size_t const grain, T const& identity, Reduce const& reduce,
+                  Combine const& combine)
+{
+	if (begin >= end)
+		return identity;
+
+	const size_t size = std::max<size_t>(grain, 1);
+	const size_t chunks = (end - begin + size - 1) / size;
+	std::vector<T> partials(chunks, identity);
+
+	g_threadPool.For(0, chunks, 1, [&](size_t first, size_t last)
+	{
+		for (size_t chunk = first; chunk < last; chunk++)
+		{
+			T accumulator = identity;
+
+			const size_t stop = std::min(end, begin + (chunk + 1) * size);
+			for (size_t i = begin + chunk * size; i < stop; i++)
+				accumulator = reduce(std::move(accumulator), i);
+
+			partials[chunk] = std::move(accumulator);
+		}
+	});
+
+	T result = identity;
+	for (T const& partial : partials)
+		result = combine(std::move(result), partial);
+
+	return result;
+}
@@ -5,30 +5,6 @@
 #include <optional>
 #include "Utilities.h"
 
-double rand(double const min, double const max)
-{
-	const std::pair<int, int> values = std::minmax({rand(), rand()});
-	const double upperLimit = values.second;
-	const double value = values.first;
-
-	return value / upperLimit * (max - min) + min;
-}
-
-float rand(float const min, float const max)
-{
-	return rand(static_cast<double>(min), static_cast<double>(max));
-}
-
-DirectX::SimpleMath::Vector3 randv(double const min, double const max)
-{
-	return DirectX::SimpleMath::Vector3(
-		static_cast<float>(rand(min, max)),
-		static_cast<float>(rand(min, max)),
-		static_cast<float>(rand(min, max))
-	);
-}
-
-
 void split(const std::string& value, char seperator, std::vector<std::string>& values)
 {
 	std::string val;
@@ -2,17 +2,6 @@
 
 #include <optional>
 
-double rand(double min, double max);
-float rand(float min, float max);
-DirectX::SimpleMath::Vector3 randv(double min, double max);
-
-template <typename T>
-const T& rand(std::vector<T> const& data)
-{
-	uint32_t const index = static_cast<uint32_t>(ceil(rand(-1, data.size() - 1)));
-	return data[index];
-}
-
 void split(const std::string& value, char seperator, std::vector<std::string>& values);
 
 std::vector<double> euler(std::function<double(double v, double t, int32_t i)> const& _action,
@@ -0,0 +1,73 @@
+#include "AllocationCount.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+// Replaces the global operator new and delete to count allocations. The array and nothrow forms forward to these.
+
+namespace
+{
+	std::atomic<uint64_t> g_allocations{0};
+
+	void* AllocateAligned(std::size_t const size, std::size_t const alignment)
+	{
+#ifdef _MSC_VER
+		return _aligned_malloc(size, alignment);
+#else
+		return std::aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment);
+#endif
+	}
+
+	void FreeAligned(void* pointer)
+	{
+#ifdef _MSC_VER
+		_aligned_free(pointer);
+#else
+		std::free(pointer);
+#endif
+	}
+}
+
+uint64_t GetAllocationCount()
+{
+	return g_allocations.load(std::memory_order_relaxed);
+}
+
+void* operator new(std::size_t const size)
+{
+	g_allocations.fetch_add(1, std::memory_order_relaxed);
+	if (void* pointer = std::malloc(size > 0 ? size : 1))
+		return pointer;
+
+	throw std::bad_alloc();
+}
+
+void* operator new(std::size_t const size, std::align_val_t const alignment)
+{
+	g_allocations.fetch_add(1, std::memory_order_relaxed);
+	if (void* pointer = AllocateAligned(size > 0 ? size : 1, static_cast<std::size_t>(alignment)))
+		return pointer;
+
+	throw std::bad_alloc();
+}
+
+void operator delete(void* pointer) noexcept
+{
+	std::free(pointer);
+}
+
+void operator delete(void* pointer, std::size_t) noexcept
+{
+	std::free(pointer);
+}
+
+void operator delete(void* pointer, std::align_val_t) noexcept
+{
+	FreeAligned(pointer);
+}
+
+void operator delete(void* pointer, std::size_t, std::align_val_t) noexcept
+{
+	FreeAligned(pointer);
+}
@@ -0,0 +1,7 @@
+#pragma once
+
+#include <cstdint>
+
+// Heap allocations made through the global operator new since the program started, counted by the replacement
+// operators in AllocationCount.cpp.
+uint64_t GetAllocationCount();
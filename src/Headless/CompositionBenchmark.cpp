@@ -0,0 +1,110 @@
+#include "CompositionBenchmark.h"
+
+#include "AllocationCount.h"
+#include "Composition.h"
+#include "CompositionStore.h"
+#include "Random.h"
+
+#include <chrono>
+#include <vector>
+
+namespace
+{
+	// Eight major elements and traces a millionth of their mass in all others.
+	Composition<float> NarrowSpectrum(Random& random, float const mass)
+	{
+		Composition<float> composition = {};
+		random.Fill(composition.data(), Composition<float>::size(), 0.f, 1e-6f);
+		for (int k = 0; k < 8; k++)
+			composition.data()[random.NextUInt() % Composition<float>::size()] += random.Uniform(.01f, 1.f);
+
+		composition *= mass / composition.sum();
+		return composition;
+	}
+
+	void BenchmarkStore(CompositionBenchmark& benchmark, std::vector<float> const& masses, uint32_t const frames,
+	                    uint64_t const seed)
+	{
+		SlotMap<Composition<float>> dense;
+		CompositionStore store;
+		for (size_t i = 0; i < masses.size(); i++)
+		{
+			Random random(seed, RandomStream::Composition, static_cast<uint32_t>(i));
+			const Composition<float> composition = NarrowSpectrum(random, masses[i]);
+			dense.Insert(static_cast<uint32_t>(i + 1), composition);
+			store.Set(static_cast<uint32_t>(i + 1), composition);
+		}
+
+		benchmark.sparse = store.SparseCount();
+		benchmark.denseBytes = dense.Size() * (sizeof(Composition<float>) + sizeof(uint32_t));
+		benchmark.storeBytes = store.Bytes();
+
+		auto start = std::chrono::steady_clock::now();
+		for (uint32_t frame = 0; frame < frames; frame++)
+		{
+			for (size_t i = 0; i < masses.size(); i++)
+			{
+				Composition<float>& composition = dense[static_cast<uint32_t>(i + 1)];
+				composition *= masses[i] / composition.sum();
+				benchmark.checksum += composition.Hydrogen;
+			}
+		}
+		auto end = std::chrono::steady_clock::now();
+		benchmark.denseTime = std::chrono::duration<double, std::milli>(end - start).count() / frames;
+
+		start = std::chrono::steady_clock::now();
+		for (uint32_t frame = 0; frame < frames; frame++)
+		{
+			for (size_t i = 0; i < masses.size(); i++)
+			{
+				const auto id = static_cast<uint32_t>(i + 1);
+				store.Scale(id, masses[i] / store.Sum(id));
+				benchmark.checksum += store.Element(id, 0);
+			}
+		}
+		end = std::chrono::steady_clock::now();
+		benchmark.storeTime = std::chrono::duration<double, std::milli>(end - start).count() / frames;
+	}
+}
+
+CompositionBenchmark BenchmarkCompositions(size_t const bodies, uint32_t const frames, uint64_t const seed)
+{
+	std::vector<Composition<float>> compositions(bodies);
+	std::vector<float> masses(bodies);
+	for (size_t i = 0; i < bodies; i++)
+	{
+		Random random(seed, RandomStream::Composition, static_cast<uint32_t>(i));
+		random.Fill(compositions[i].data(), Composition<float>::size(), 0.f, 1.f);
+		masses[i] = random.Uniform(1e20f, 1e24f);
+		compositions[i] *= masses[i] / compositions[i].sum();
+	}
+
+	CompositionBenchmark benchmark;
+	benchmark.bodies = bodies;
+	if (bodies == 0 || frames == 0)
+		return benchmark;
+
+	const uint64_t allocations = GetAllocationCount();
+	const auto start = std::chrono::steady_clock::now();
+
+	for (uint32_t frame = 0; frame < frames; frame++)
+	{
+		for (size_t i = 0; i < bodies; i++)
+		{
+			Composition<double> values = compositions[i].As<double>();
+			values /= values.sum();
+
+			const Composition<double> merged = values + compositions[(i + 1) % bodies] * 1e-30f;
+			compositions[i] = (merged / merged.sum() * masses[i]).As<float>();
+
+			benchmark.checksum += compositions[i].Hydrogen;
+		}
+	}
+
+	const auto end = std::chrono::steady_clock::now();
+	benchmark.allocations = static_cast<double>(GetAllocationCount() - allocations) / frames;
+	benchmark.time = std::chrono::duration<double, std::milli>(end - start).count() / frames;
+
+	BenchmarkStore(benchmark, masses, frames, seed);
+	return benchmark;
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Cost of the composition arithmetic the game runs for its bodies every frame: the double precision copy that
+// GetColor and the density profile normalise, merging a neighbour's share as the collision merge does, and writing
+// the result back in single precision as Planet::Update does after escape.
+struct CompositionBenchmark
+{
+	size_t bodies = 0;
+	double allocations = 0; // heap allocations per frame
+	double time = 0; // ms per frame
+	double checksum = 0; // keeps the work from being optimised away
+
+	// Renormalising bodies whose mass sits in a few elements, as drawn by Composition::Randomize, kept all dense and
+	// kept in a CompositionStore.
+	size_t sparse = 0; // bodies the store keeps sparse
+	size_t denseBytes = 0, storeBytes = 0;
+	double denseTime = 0, storeTime = 0; // ms per frame
+};
+
+CompositionBenchmark BenchmarkCompositions(size_t bodies, uint32_t frames, uint64_t seed);
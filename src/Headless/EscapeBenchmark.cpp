@@ -0,0 +1,226 @@
+#include "EscapeBenchmark.h"
+
+#include "EscapeEngine.h"
+#include "Lanes.h"
+#include "PhysicalConstants.h"
+#include "ProfileArena.h"
+#include "ProfileScheduler.h"
+#include "Random.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <vector>
+
+namespace
+{
+	using Lane = Composition<double>;
+
+	constexpr size_t LAYERS = 24;
+
+	// A body of a log-uniform mass in shells of equal thickness, denser inside, with fields as
+	// Planet::RefreshDensityProfile leaves them.
+	void CreateProfiles(ProfileArena& arena, size_t const bodies, uint64_t const seed)
+	{
+		for (size_t b = 0; b < bodies; b++)
+		{
+			Random random(seed, RandomStream::DensityProfile, static_cast<uint32_t>(b));
+			ProfileLayers const profile = arena.Allocate(static_cast<uint32_t>(b + 1), LAYERS);
+
+			const double mass = std::pow(10., random.Uniform(20., 28.));
+			const double radius = std::cbrt(mass / 3000. / PI_CB);
+
+			double weights = 0;
+			for (size_t l = 0; l < LAYERS; l++)
+				weights += 1.5 - static_cast<double>(l) / LAYERS;
+
+			double usedMass = 0, usedVolume = 0;
+			for (size_t l = 0; l < LAYERS; l++)
+			{
+				profile.radius[l] = radius * static_cast<double>(l + 1) / LAYERS;
+				profile.volume[l] = std::pow(profile.radius[l], 3) * PI_CB - usedVolume;
+				profile.mass[l] = mass * (1.5 - static_cast<double>(l) / LAYERS) / weights;
+				profile.density[l] = profile.mass[l] / profile.volume[l];
+
+				usedMass += profile.mass[l];
+				usedVolume += profile.volume[l];
+				profile.pressure[l] = usedMass * G / std::pow(profile.radius[l], 2);
+
+				double* elements = profile.Elements(l);
+				for (size_t i = 0; i < Lane::size(); i++)
+					elements[i] = std::pow(10., random.Uniform(-60., 0.));
+
+				Lanes::Multiply(elements, profile.mass[l] / Lanes::Sum(elements, Lane::LANES), Lane::LANES);
+			}
+		}
+	}
+
+	// The model as Planet::Update ran it for one planet, element by element. Returns the mass lost to space.
+	double EvolveReference(ProfileLayers const& profile, Random& random, double const deltaTime)
+	{
+		const size_t elements = Lane::size();
+		std::vector<double> spread(profile.count * elements);
+		random.Fill(spread.data(), spread.size(), .5, 1.5);
+
+		Lane current = *reinterpret_cast<Lane*>(profile.Elements(0)), above{};
+
+		double lostToSpace = 0;
+		double insideMass = 0;
+		for (size_t j = 0; j < profile.count; j++)
+		{
+			double* layer = profile.Elements(j);
+			if (j + 1 < profile.count)
+				above = *reinterpret_cast<Lane*>(profile.Elements(j + 1));
+
+			insideMass += profile.mass[j];
+
+			double const pEscape = std::sqrt((2 * G * insideMass) / profile.radius[j]);
+
+			for (size_t i = 0; i < elements; i++)
+			{
+				double const layerParticleMass = current.data()[i];
+				if (layerParticleMass > 0)
+				{
+					double const nParticles = layerParticleMass / (ELEMENTAL_WEIGHT[i] / Na);
+					double const tParticle = (profile.pressure[j] * profile.volume[j]) / (nParticles * R);
+
+					double vParticle = std::sqrt(3 * (kB * tParticle / layerParticleMass));
+					vParticle *= spread[j * elements + i];
+
+					double escapeRatio = std::sqrt(std::abs(vParticle - pEscape) / std::max(vParticle, pEscape)) *
+						(deltaTime / 3600.);
+					escapeRatio = escapeRatio < 1 ? escapeRatio : 1;
+					const double change = layerParticleMass * escapeRatio;
+
+					if (vParticle > pEscape)
+					{
+						if (j < profile.count - 1)
+							profile.Elements(j + 1)[i] += change;
+						else lostToSpace += change;
+
+						layer[i] -= change;
+					}
+					else if (j > 0)
+					{
+						profile.Elements(j - 1)[i] += change;
+						layer[i] -= change;
+					}
+				}
+			}
+
+			current = above;
+		}
+
+		for (size_t j = profile.count - 1; j > 0; j--)
+		{
+			double* layer = profile.Elements(j);
+			for (size_t i = 0; i < elements; i++)
+			{
+				if (layer[i] < 0 || std::isnan(layer[i]))
+					layer[i] = 0;
+			}
+			profile.mass[j] = Lanes::Sum(layer, Lane::LANES);
+		}
+
+		return lostToSpace;
+	}
+
+	template <typename F>
+	double Time(uint32_t const steps, F const& step)
+	{
+		const auto start = std::chrono::steady_clock::now();
+		for (uint32_t s = 0; s < steps; s++)
+			step(s);
+		const auto end = std::chrono::steady_clock::now();
+		return std::chrono::duration<double, std::milli>(end - start).count() / steps;
+	}
+}
+
+EscapeBenchmark BenchmarkEscape(size_t const bodies, uint32_t const steps, double const deltaTime, double const budget,
+                                uint64_t const seed)
+{
+	EscapeBenchmark benchmark;
+	benchmark.bodies = bodies;
+	benchmark.layers = bodies * LAYERS;
+	benchmark.budget = budget;
+	if (bodies == 0 || steps == 0)
+		return benchmark;
+
+	const EscapeEngine engine(ELEMENTAL_WEIGHT);
+	ProfileArena reference(Lane::LANES), serial(Lane::LANES), parallel(Lane::LANES), scheduled(Lane::LANES);
+	for (ProfileArena* arena : {&reference, &serial, &parallel, &scheduled})
+		CreateProfiles(*arena, bodies, seed);
+
+	auto stream = [seed](size_t const b, uint32_t const s)
+	{
+		return Random(seed, RandomStream::Escape, static_cast<uint32_t>(b + 1), s);
+	};
+
+	// The first step from the same profiles, the reference twice to show the spread of its draws.
+	{
+		ProfileArena other(Lane::LANES);
+		CreateProfiles(other, bodies, seed);
+
+		for (size_t b = 0; b < bodies; b++)
+		{
+			const auto id = static_cast<uint32_t>(b + 1);
+			Random random = stream(b, 0), otherRandom = stream(b, 1);
+			benchmark.sampled[0] += EvolveReference(reference.Find(id), random, deltaTime);
+			benchmark.sampled[1] += EvolveReference(other.Find(id), otherRandom, deltaTime);
+			benchmark.escaped += engine.Evolve(serial.Find(id), deltaTime);
+		}
+	}
+
+	benchmark.referenceTime = Time(steps, [&](uint32_t const s)
+	{
+		for (size_t b = 0; b < bodies; b++)
+		{
+			Random random = stream(b, s + 1);
+			EvolveReference(reference.Find(static_cast<uint32_t>(b + 1)), random, deltaTime);
+		}
+	});
+
+	benchmark.serialTime = Time(steps, [&](uint32_t)
+	{
+		for (size_t b = 0; b < bodies; b++)
+			engine.Evolve(serial.Find(static_cast<uint32_t>(b + 1)), deltaTime);
+	});
+
+	benchmark.time = Time(steps, [&](uint32_t)
+	{
+		parallel_for(0, bodies, [&](size_t const b)
+		{
+			engine.Evolve(parallel.Find(static_cast<uint32_t>(b + 1)), deltaTime);
+		});
+	});
+
+	// The first body stands for the one in focus, the cursor walks over the others a step at a time.
+	std::vector<ProfileCandidate> candidates(bodies);
+	for (size_t b = 0; b < bodies; b++)
+	{
+		ProfileLayers const profile = scheduled.Find(static_cast<uint32_t>(b + 1));
+		const double mass = Lanes::Sum(profile.mass, profile.count);
+		candidates[b] = {
+			static_cast<uint32_t>(b + 1), static_cast<float>(mass), b == 0 ? 1.f : 0.f, static_cast<uint32_t>(LAYERS)
+		};
+	}
+
+	ProfileScheduler scheduler(budget);
+	size_t picked = 0;
+	benchmark.scheduledTime = Time(steps, [&](uint32_t const s)
+	{
+		std::vector<ProfileStep> const& picks = scheduler.Schedule(candidates, s % bodies, deltaTime);
+		picked += picks.size();
+
+		const auto start = std::chrono::steady_clock::now();
+		parallel_for(0, picks.size(), 1, [&](size_t const k)
+		{
+			engine.Evolve(scheduled.Find(candidates[picks[k].index].id), picks[k].deltaTime);
+		});
+		scheduler.Complete(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count());
+	});
+	benchmark.scheduled = static_cast<double>(picked) / steps;
+
+	return benchmark;
+}
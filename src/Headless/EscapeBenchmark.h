@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Cost of one atmospheric escape step for every body of a system, on synthetic density profiles whose element masses
+// span many orders of magnitude so that both directions of the model are taken. The per-element loop the game once
+// ran for the selected planet alone, drawing a uniform jitter of the particle speed for every element, is the
+// reference the expected flux of the EscapeEngine is compared and timed against. A ProfileScheduler run within a
+// microsecond budget shows the frame time the game sees, which stays flat as the bodies grow.
+struct EscapeBenchmark
+{
+	size_t bodies = 0;
+	size_t layers = 0;
+	double escaped = 0; // kg lost to space in the first step, EscapeEngine
+	double sampled[2] = {}; // kg lost to space in the first step, per-element reference with two different draws
+	double referenceTime = 0; // ms per step, per-element reference, one body after another
+	double serialTime = 0; // ms per step, EscapeEngine on one thread
+	double time = 0; // ms per step, EscapeEngine with the bodies in parallel
+	double scheduledTime = 0; // ms per step, the bodies the ProfileScheduler picks within budget, in parallel
+	double scheduled = 0; // bodies per step the ProfileScheduler picks
+	double budget = 0; // us per step given to the ProfileScheduler
+};
+
+EscapeBenchmark BenchmarkEscape(size_t bodies, uint32_t steps, double deltaTime, double budget, uint64_t seed);
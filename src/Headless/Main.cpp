@@ -0,0 +1,333 @@
+//
+// Main.cpp
+//
+// Steps the simulation without a window or Direct3D device and reports per-step timings, for profiling the physics on
+// machines that cannot run the game.
+//
+
+#include "CompositionBenchmark.h"
+#include "EscapeBenchmark.h"
+#include "EscapeEngine.h"
+#include "Lanes.h"
+#include "Simulation.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace
+{
+	struct Options
+	{
+		uint32_t planets = 400;
+		uint32_t steps = 100;
+		uint64_t seed = 1;
+		double speed = 1000;
+		double frameTime = 1 / 60.;
+		double profileBudget = 2000;
+		GravityMethod method = GravityMethod::BarnesHut;
+		IntegratorMethod integrator = IntegratorMethod::Euler;
+		uint32_t energy = 0;
+		std::vector<size_t> threads = {std::thread::hardware_concurrency()};
+		bool quiet = false;
+		bool cells = false;
+		bool compositions = false;
+		bool escape = false;
+	};
+
+	void PrintUsage()
+	{
+		std::printf(
+			"Usage: GameEngineHeadless [options]\n"
+			"  --planets N        planets around the star (400)\n"
+			"  --steps N          frames to simulate (100)\n"
+			"  --speed S          g_speed, simulated seconds per real second (1000)\n"
+			"  --frame-time T     real seconds per frame (1/60)\n"
+			"  --solver NAME      barnes-hut, direct, fmm or p3m (barnes-hut)\n"
+			"  --integrator NAME  euler, leapfrog, yoshida, hermite, block or wisdom-holman (euler)\n"
+			"  --energy N         measure the energy change of every Nth step (0, never)\n"
+			"  --threads A,B,...  thread counts to run one after another (all cores)\n"
+			"  --seed N           seed of the solar system (1)\n"
+			"  --quiet            summaries only, no per-step lines\n"
+			"  --cells            compare quadrant cell gravity with the full pairwise sum after the run\n"
+			"  --compositions     time the per-frame composition arithmetic for the surviving bodies after the run\n"
+			"  --escape           time atmospheric escape for the surviving bodies against the per-element model\n"
+			"  --profile-budget U microseconds per step the scheduled escape pass of --escape may take (2000)\n");
+	}
+
+	GravityMethod ParseMethod(std::string const& name)
+	{
+		if (name == "barnes-hut") return GravityMethod::BarnesHut;
+		if (name == "direct") return GravityMethod::DirectSum;
+		if (name == "fmm") return GravityMethod::FastMultipole;
+		if (name == "p3m") return GravityMethod::ParticleMesh;
+
+		throw std::invalid_argument("Unknown solver " + name);
+	}
+
+	IntegratorMethod ParseIntegrator(std::string const& name)
+	{
+		if (name == "euler") return IntegratorMethod::Euler;
+		if (name == "leapfrog") return IntegratorMethod::Leapfrog;
+		if (name == "yoshida") return IntegratorMethod::Yoshida;
+		if (name == "hermite") return IntegratorMethod::Hermite;
+		if (name == "block") return IntegratorMethod::Block;
+		if (name == "wisdom-holman") return IntegratorMethod::WisdomHolman;
+
+		throw std::invalid_argument("Unknown integrator " + name);
+	}
+
+	std::vector<size_t> ParseList(std::string const& list)
+	{
+		std::vector<size_t> values;
+
+		size_t start = 0;
+		while (start <= list.size())
+		{
+			size_t end = list.find(',', start);
+			if (end == std::string::npos)
+				end = list.size();
+
+			const unsigned long value = std::stoul(list.substr(start, end - start));
+			if (value == 0)
+				throw std::invalid_argument("Thread counts start at 1");
+
+			values.push_back(value);
+			start = end + 1;
+		}
+
+		return values;
+	}
+
+	Options ParseOptions(int const argc, char** argv)
+	{
+		Options options;
+
+		for (int i = 1; i < argc; i++)
+		{
+			const std::string option = argv[i];
+			if (option == "--quiet")
+			{
+				options.quiet = true;
+				continue;
+			}
+			if (option == "--cells")
+			{
+				options.cells = true;
+				continue;
+			}
+			if (option == "--compositions")
+			{
+				options.compositions = true;
+				continue;
+			}
+			if (option == "--escape")
+			{
+				options.escape = true;
+				continue;
+			}
+
+			const bool known = option == "--planets" || option == "--steps" || option == "--seed" ||
+				option == "--speed" || option == "--frame-time" || option == "--solver" || option == "--integrator" ||
+				option == "--energy" || option == "--threads" || option == "--profile-budget";
+			if (!known)
+				throw std::invalid_argument("Unknown option " + option);
+			if (i + 1 >= argc)
+				throw std::invalid_argument("Missing value for " + option);
+
+			const std::string value = argv[++i];
+			if (option == "--planets") options.planets = static_cast<uint32_t>(std::stoul(value));
+			else if (option == "--steps") options.steps = static_cast<uint32_t>(std::stoul(value));
+			else if (option == "--seed") options.seed = std::stoull(value);
+			else if (option == "--speed") options.speed = std::stod(value);
+			else if (option == "--frame-time") options.frameTime = std::stod(value);
+			else if (option == "--solver") options.method = ParseMethod(value);
+			else if (option == "--integrator") options.integrator = ParseIntegrator(value);
+			else if (option == "--energy") options.energy = static_cast<uint32_t>(std::stoul(value));
+			else if (option == "--profile-budget") options.profileBudget = std::stod(value);
+			else options.threads = ParseList(value);
+		}
+
+		return options;
+	}
+
+	double Total(StageTimes const& times)
+	{
+		double total = 0;
+		for (double const time : times.time)
+			total += time;
+
+		return total;
+	}
+
+	// Runs the whole simulation on the given number of threads and returns the summed stage times.
+	StageTimes Run(Options const& options, size_t const threads)
+	{
+		g_threadPool.Resize(threads);
+
+		Simulation simulation(options.planets, options.seed, options.method, options.integrator);
+		const double deltaTime = options.speed * options.frameTime;
+
+		std::printf("\n%s, %s on %zu threads, %zu bodies\n", simulation.Solver().Name(), simulation.Stepper().Name(),
+		            g_threadPool.Size(), simulation.Size());
+
+		if (!options.quiet)
+			std::printf("%6s %8s %10s %8s %14s %9s %9s %9s %9s %9s %9s\n", "step", "bodies", "collisions", "pairs",
+			            "mass (kg)", "com ms", "quadrant", "gravity", "collide", "clean", "total");
+
+		StageTimes sum{};
+		double evaluations = 0, shared = 0, gflops = 0, error = 0, worst = 0;
+		uint32_t deepest = 0, measured = 0;
+		for (uint32_t step = 0; step < options.steps; step++)
+		{
+			simulation.Step(deltaTime, options.energy);
+
+			// What the step cost against every body taking the shortest step of the frame.
+			IntegratorStats const& stepper = simulation.Stepper().Stats();
+			evaluations += static_cast<double>(stepper.bodyEvaluations);
+			shared += std::ldexp(static_cast<double>(simulation.Size()), static_cast<int>(stepper.deepestLevel));
+			deepest = std::max(deepest, stepper.deepestLevel);
+
+			GravityStats const& gravity = simulation.Solver().Stats();
+			gflops += gravity.gflops;
+			if (gravity.error > 0)
+			{
+				error += gravity.error;
+				worst = std::max(worst, gravity.error);
+				measured++;
+			}
+
+			StageTimes const& times = simulation.Times();
+			for (size_t s = 0; s < static_cast<size_t>(Stage::Count); s++)
+				sum.time[s] += times.time[s];
+
+			if (!options.quiet)
+				std::printf("%6u %8zu %10u %8zu %14.6e %9.3f %9.3f %9.3f %9.3f %9.3f %9.3f\n", step,
+				            simulation.Size(), simulation.StepCollisions(), simulation.PairStats().pairs,
+				            simulation.TotalMass(), times[Stage::CenterOfMass], times[Stage::Quadrants],
+				            times[Stage::Gravity], times[Stage::Collision], times[Stage::Clean], Total(times));
+		}
+
+		std::printf("bodies %zu, collisions %llu, total mass %.6e kg\n", simulation.Size(),
+		            static_cast<unsigned long long>(simulation.Collisions()), simulation.TotalMass());
+
+		const double steps = options.steps > 0 ? options.steps : 1;
+		std::printf("mean ms per step:");
+		for (size_t s = 0; s < static_cast<size_t>(Stage::Count); s++)
+		{
+			// The integrators drift within the gravity stage, and there are no density profiles to escape from.
+			const auto stage = static_cast<Stage>(s);
+			if (stage != Stage::Vertices && stage != Stage::Drift && stage != Stage::Escape)
+				std::printf(" %s %.3f,", GetStageName(stage), sum.time[s] / steps);
+		}
+		std::printf(" total %.3f\n", Total(sum) / steps);
+
+		// Only the solvers with a known operation count report a throughput.
+		if (gflops > 0)
+			std::printf("gravity: %s, %.2f GFLOP/s mean per step\n", simulation.Solver().Name(), gflops / steps);
+
+		// Approximate solvers measure themselves against direct summation on a sample of bodies.
+		if (measured > 0)
+			std::printf("gravity error: relative rms acceleration %.3e mean, %.3e worst over %u steps\n",
+			            error / measured, worst, measured);
+
+		std::printf("force evaluations per step: %.1f bodies, %.1f with one shared step of 1/%g frame\n",
+		            evaluations / steps, shared / steps, std::ldexp(1, static_cast<int>(deepest)));
+
+		IntegratorStats const& integrator = simulation.Stepper().Stats();
+		if (integrator.measured > 0)
+			std::printf("energy: last measured step %.3e, summed over %llu steps %.3e\n", integrator.energyError,
+			            static_cast<unsigned long long>(integrator.measured), integrator.energyDrift);
+
+		if (options.cells)
+		{
+			const CellBenchmark cells = simulation.BenchmarkCells();
+			std::printf("quadrant gravity: %zu cells, aggregate %.3f ms, cells %.3f ms, pairwise %.3f ms, error %.2e\n",
+			            cells.cells, cells.aggregateTime, cells.cellTime, cells.directTime, cells.error);
+		}
+
+		if (options.compositions)
+		{
+			const CompositionBenchmark compositions =
+				BenchmarkCompositions(simulation.Size(), options.steps, options.seed);
+			std::printf("compositions: %zu bodies, %.3f ms and %.1f heap allocations per frame (%s)\n",
+			            compositions.bodies, compositions.time, compositions.allocations, GetSimdName(Lanes::Level()));
+			std::printf("composition store: %zu of %zu sparse, %zu KiB and %.3f ms per frame (dense %zu KiB, %.3f ms)\n",
+			            compositions.sparse, compositions.bodies, compositions.storeBytes / 1024, compositions.storeTime,
+			            compositions.denseBytes / 1024, compositions.denseTime);
+		}
+
+		if (options.escape)
+		{
+			const EscapeBenchmark escape = BenchmarkEscape(simulation.Size(), options.steps,
+			                                               options.speed * options.frameTime, options.profileBudget,
+			                                               options.seed);
+			std::printf("escape: %zu bodies, %zu layers, %.3f ms per step on %u threads, %.3f ms on one (%s), "
+			            "per-element model %.3f ms\n", escape.bodies, escape.layers, escape.time,
+			            static_cast<unsigned>(g_threadPool.Size()), escape.serialTime, GetSimdName(EscapeEngine::Level()),
+			            escape.referenceTime);
+			std::printf("escape to space in the first step: expected flux %.4e kg, per-element draws %.4e and %.4e kg\n",
+			            escape.escaped, escape.sampled[0], escape.sampled[1]);
+			std::printf("escape within %.0f us: %.1f bodies per step, %.3f ms per step\n", escape.budget,
+			            escape.scheduled, escape.scheduledTime);
+		}
+
+		return sum;
+	}
+}
+
+int main(int const argc, char** argv)
+{
+	Options options;
+	try
+	{
+		options = ParseOptions(argc, argv);
+	}
+	catch (std::exception const& exception)
+	{
+		std::fprintf(stderr, "%s\n", exception.what());
+		PrintUsage();
+		return 1;
+	}
+
+	std::vector<StageTimes> runs;
+	for (size_t const threads : options.threads)
+		runs.push_back(Run(options, threads));
+
+	if (options.threads.size() > 1)
+	{
+		// Speedup over the first run of every stage the summaries show, then of the whole step.
+		auto speedup = [](double const first, double const time) { return time > 0 ? first / time : 0; };
+
+		std::printf("\n%-16s", "threads");
+		for (size_t const threads : options.threads)
+			std::printf(" %8zu", threads);
+		std::printf("\n");
+
+		for (size_t s = 0; s < static_cast<size_t>(Stage::Count); s++)
+		{
+			const auto stage = static_cast<Stage>(s);
+			if (stage == Stage::Vertices || stage == Stage::Drift || stage == Stage::Escape)
+				continue;
+
+			std::printf("%-16s", GetStageName(stage));
+			for (StageTimes const& run : runs)
+				std::printf(" %8.2f", speedup(runs[0].time[s], run.time[s]));
+			std::printf("\n");
+		}
+
+		std::printf("%-16s", "Total");
+		for (StageTimes const& run : runs)
+			std::printf(" %8.2f", speedup(Total(runs[0]), Total(run)));
+		std::printf("\n%-16s", "Total ms");
+		for (StageTimes const& run : runs)
+			std::printf(" %8.3f", Total(run));
+		std::printf("\n");
+	}
+
+	return 0;
+}
@@ -0,0 +1,270 @@
+#include "Simulation.h"
+
+#include "SolarSystem.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <stdexcept>
+
+namespace
+{
+	constexpr size_t BODIES_PER_TASK = 1024;
+
+	struct MassMoments
+	{
+		double x = 0;
+		double y = 0;
+		double z = 0;
+		double mass = 0;
+
+		MassMoments operator+(MassMoments const& other) const
+		{
+			return {x + other.x, y + other.y, z + other.z, mass + other.mass};
+		}
+	};
+}
+
+Simulation::Simulation(uint32_t const planets, uint64_t const seed, GravityMethod const method,
+                       IntegratorMethod const integrator) :
+	m_barnesHut(),
+	m_directSum(),
+	m_fastMultipole(),
+	m_particleMesh(QUADRANT_SIZE * S_NORM_INV),
+	m_solver(nullptr),
+	m_integrator(nullptr),
+	m_quadrants(QUADRANT_SIZE * S_NORM_INV)
+{
+	switch (method)
+	{
+	case GravityMethod::BarnesHut: m_solver = &m_barnesHut;
+		break;
+	case GravityMethod::DirectSum: m_solver = &m_directSum;
+		break;
+	case GravityMethod::FastMultipole: m_solver = &m_fastMultipole;
+		break;
+	case GravityMethod::ParticleMesh: m_solver = &m_particleMesh;
+		break;
+	default: throw std::invalid_argument("Only the CPU gravity solvers run without a device");
+	}
+
+	switch (integrator)
+	{
+	case IntegratorMethod::Euler: m_integrator = &m_euler;
+		break;
+	case IntegratorMethod::Leapfrog: m_integrator = &m_leapfrog;
+		break;
+	case IntegratorMethod::Yoshida: m_integrator = &m_yoshida;
+		break;
+	case IntegratorMethod::Hermite: m_integrator = &m_hermite;
+		break;
+	case IntegratorMethod::Block: m_integrator = &m_block;
+		break;
+	case IntegratorMethod::WisdomHolman: m_integrator = &m_wisdomHolman;
+		break;
+	default: throw std::invalid_argument("Unknown integrator");
+	}
+
+	const BodySeed star = SolarSystem::Star();
+	SolarSystem system(seed);
+
+	std::vector<BodySeed> seeds = {star};
+	for (BodySeed const& planet : system.Planets(planets, EstimateRadius(star.mass)))
+		seeds.push_back(planet);
+
+	m_bodies.Resize(seeds.size());
+	for (size_t i = 0; i < seeds.size(); i++)
+	{
+		BodySeed const& body = seeds[i];
+		const double speed = body.velocity * S_NORM_INV;
+
+		m_bodies.x[i] = static_cast<float>(body.position[0] * S_NORM_INV);
+		m_bodies.y[i] = static_cast<float>(body.position[1] * S_NORM_INV);
+		m_bodies.z[i] = static_cast<float>(body.position[2] * S_NORM_INV);
+		m_bodies.vx[i] = static_cast<float>(body.direction[0] * speed);
+		m_bodies.vy[i] = static_cast<float>(body.direction[1] * speed);
+		m_bodies.vz[i] = static_cast<float>(body.direction[2] * speed);
+		m_bodies.mass[i] = static_cast<float>(body.mass);
+		m_bodies.radius[i] = static_cast<float>(EstimateRadius(body.mass));
+		m_bodies.collision[i] = 0;
+	}
+}
+
+void Simulation::Step(double const deltaTime, uint32_t const energyInterval)
+{
+	{
+		StageTimer timer(m_times, Stage::CenterOfMass);
+		CenterOfMass();
+	}
+	{
+		StageTimer timer(m_times, Stage::Quadrants);
+		m_quadrants.Build(m_bodies.Gravity());
+		m_quadrants.Aggregate(m_bodies.Gravity());
+	}
+	{
+		// Kicks and drifts, so there is no separate drift stage; collisions are found at the new positions.
+		StageTimer timer(m_times, Stage::Gravity);
+		const bool measure = energyInterval != 0 && m_steps % energyInterval == 0;
+		m_integrator->Step(m_bodies, *m_solver, deltaTime, measure);
+		m_steps++;
+	}
+	{
+		StageTimer timer(m_times, Stage::Collision);
+		Collide();
+	}
+	{
+		StageTimer timer(m_times, Stage::Clean);
+		Clean();
+	}
+}
+
+CellBenchmark Simulation::BenchmarkCells()
+{
+	using Clock = std::chrono::high_resolution_clock;
+	const auto milliseconds = [](Clock::time_point const start)
+	{
+		return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+	};
+
+	// Both passes run on a copy so the flags and scratch of the simulation are left alone.
+	BodyStore store = m_bodies;
+	const GravityBodies bodies = store.Gravity();
+	const size_t count = store.Size();
+
+	CellBenchmark result;
+
+	auto start = Clock::now();
+	m_directSum.Accelerate(bodies);
+	result.directTime = milliseconds(start);
+
+	const std::vector<double> ax(store.ax.begin(), store.ax.end());
+	const std::vector<double> ay(store.ay.begin(), store.ay.end());
+	const std::vector<double> az(store.az.begin(), store.az.end());
+
+	QuadrantIndex quadrants(m_quadrants.CellSize());
+	start = Clock::now();
+	quadrants.Build(bodies);
+	quadrants.Aggregate(bodies);
+	result.aggregateTime = milliseconds(start);
+
+	start = Clock::now();
+	parallel_for(0, count, BODIES_PER_TASK, [&](size_t const i)
+	{
+		double sx = 0, sy = 0, sz = 0;
+
+		QuadrantCell const* own = quadrants.CellOf(i);
+		if (own != nullptr)
+		{
+			const double x = bodies.x[i], y = bodies.y[i], z = bodies.z[i];
+
+			quadrants.ForEachNeighbour(own->key, [&](QuadrantCell const& cell)
+			{
+				for (uint32_t k = cell.first; k < cell.first + cell.count; k++)
+				{
+					const uint32_t j = quadrants.Bodies()[k];
+					const double dx = bodies.x[j] - x, dy = bodies.y[j] - y, dz = bodies.z[j] - z;
+					const double r2 = dx * dx + dy * dy + dz * dz;
+					if (r2 == 0)
+						continue;
+
+					const double s = G_SCREEN * bodies.mass[j] / (r2 * std::sqrt(r2));
+					sx += dx * s;
+					sy += dy * s;
+					sz += dz * s;
+				}
+			});
+
+			quadrants.FarField(x, y, z, own->key, sx, sy, sz);
+		}
+
+		bodies.ax[i] = sx;
+		bodies.ay[i] = sy;
+		bodies.az[i] = sz;
+	});
+	result.cellTime = milliseconds(start);
+
+	double error = 0, norm = 0;
+	for (size_t i = 0; i < count; i++)
+	{
+		const double dx = bodies.ax[i] - ax[i], dy = bodies.ay[i] - ay[i], dz = bodies.az[i] - az[i];
+		error += dx * dx + dy * dy + dz * dz;
+		norm += ax[i] * ax[i] + ay[i] * ay[i] + az[i] * az[i];
+	}
+
+	result.cells = quadrants.Cells().size();
+	result.error = norm > 0 ? std::sqrt(error / norm) : 0;
+	return result;
+}
+
+double Simulation::TotalMass() const
+{
+	double total = 0;
+	for (float const mass : m_bodies.mass)
+		total += mass;
+
+	return total;
+}
+
+void Simulation::CenterOfMass()
+{
+	const MassMoments moments = parallel_reduce(0, Size(), BODIES_PER_TASK, MassMoments{},
+	                                            [this](MassMoments accumulator, size_t const i)
+	                                            {
+		                                            const double mass = m_bodies.mass[i];
+
+		                                            accumulator.x += m_bodies.x[i] * mass;
+		                                            accumulator.y += m_bodies.y[i] * mass;
+		                                            accumulator.z += m_bodies.z[i] * mass;
+		                                            accumulator.mass += mass;
+		                                            return accumulator;
+	                                            },
+	                                            [](MassMoments const& a, MassMoments const& b) { return a + b; });
+
+	if (moments.mass <= 0)
+		return;
+
+	const auto x = static_cast<float>(moments.x / moments.mass);
+	const auto y = static_cast<float>(moments.y / moments.mass);
+	const auto z = static_cast<float>(moments.z / moments.mass);
+
+	parallel_for(0, Size(), BODIES_PER_TASK, [&](size_t const i)
+	{
+		m_bodies.x[i] -= x;
+		m_bodies.y[i] -= y;
+		m_bodies.z[i] -= z;
+	});
+}
+
+void Simulation::Collide()
+{
+	// As in the game the broadphase alone decides which bodies collide.
+	std::fill(m_bodies.collision.begin(), m_bodies.collision.end(), 0u);
+	m_broadphase.Execute(m_bodies.Gravity());
+
+	m_stepCollisions = parallel_reduce(0, Size(), BODIES_PER_TASK, 0u,
+	                                   [this](uint32_t const count, size_t const i)
+	                                   {
+		                                   return count + (m_bodies.collision[i] != 0 ? 1u : 0u);
+	                                   },
+	                                   [](uint32_t const a, uint32_t const b) { return a + b; });
+
+	m_collisions += m_stepCollisions;
+
+	// Clears the flags and leaves the absorbed bodies massless for Clean.
+	m_resolver.Execute(m_bodies, m_broadphase.Pairs());
+}
+
+void Simulation::Clean()
+{
+	const double maxDistance = PLUTO_SUN_DIST * S_NORM_INV;
+
+	std::vector<uint8_t> erase(Size());
+	parallel_for(0, Size(), BODIES_PER_TASK, [&](size_t const i)
+	{
+		const double x = m_bodies.x[i], y = m_bodies.y[i], z = m_bodies.z[i];
+		erase[i] = m_bodies.mass[i] == 0 || std::isnan(x + y + z) || sqrt(x * x + y * y + z * z) >= maxDistance;
+	});
+
+	m_bodies.Erase(erase);
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include "BarnesHutSolver.h"
+#include "BodyStore.h"
+#include "Broadphase.h"
+#include "CollisionResolver.h"
+#include "DirectSumSolver.h"
+#include "FastMultipoleSolver.h"
+#include "Integrator.h"
+#include "ParticleMeshSolver.h"
+#include "QuadrantIndex.h"
+#include "StageTimer.h"
+
+#include <cstdint>
+
+// Cost of one pass of quadrant gravity, pairwise within the 27 neighbouring cells plus the far field of all other
+// cells from their moments, against the full pairwise sum.
+struct CellBenchmark
+{
+	size_t cells = 0;
+	double aggregateTime = 0; // ms, Build and Aggregate
+	double cellTime = 0; // ms
+	double directTime = 0; // ms
+	double error = 0; // relative rms acceleration error against the full sum
+};
+
+// The CPU side of PlanetRenderer::Update without a device: the solar system Game::CreateSolarSystem draws, advanced
+// with one of the CPU gravity solvers and integrators. Bodies carry mass and radius only, colliding bodies merge their
+// kinematics but nothing else: the compositions and density profiles the game keeps are not tracked here, though
+// CompositionStore, ProfileArena and EscapeEngine build into this target for the benchmarks of --compositions and
+// --escape.
+class Simulation
+{
+public:
+	Simulation(uint32_t planets, uint64_t seed, GravityMethod method, IntegratorMethod integrator);
+
+	// One frame of deltaTime simulated seconds, g_speed times the elapsed frame time in the game. The integrator
+	// measures the energy every energyInterval steps, never for 0.
+	void Step(double deltaTime, uint32_t energyInterval = 0);
+
+	[[nodiscard]] size_t Size() const { return m_bodies.Size(); }
+	[[nodiscard]] double TotalMass() const;
+
+	// Runs both passes on the current bodies without changing them.
+	[[nodiscard]] CellBenchmark BenchmarkCells();
+
+	// Bodies flagged as colliding in the last step and in all steps so far.
+	[[nodiscard]] uint32_t StepCollisions() const { return m_stepCollisions; }
+	[[nodiscard]] uint64_t Collisions() const { return m_collisions; }
+
+	// Overlapping pairs the broadphase found in the last step.
+	[[nodiscard]] BroadphaseStats const& PairStats() const { return m_broadphase.Stats(); }
+
+	[[nodiscard]] GravitySolver const& Solver() const { return *m_solver; }
+	[[nodiscard]] Integrator const& Stepper() const { return *m_integrator; }
+	[[nodiscard]] QuadrantIndex const& Quadrants() const { return m_quadrants; }
+	[[nodiscard]] StageTimes const& Times() const { return m_times; }
+
+private:
+	void CenterOfMass();
+	void Collide();
+	void Clean();
+
+	BodyStore m_bodies;
+
+	BarnesHutSolver m_barnesHut;
+	DirectSumSolver m_directSum;
+	FastMultipoleSolver m_fastMultipole;
+	ParticleMeshSolver m_particleMesh;
+	GravitySolver* m_solver;
+	EulerIntegrator m_euler;
+	LeapfrogIntegrator m_leapfrog;
+	YoshidaIntegrator m_yoshida;
+	HermiteIntegrator m_hermite;
+	BlockIntegrator m_block;
+	WisdomHolmanIntegrator m_wisdomHolman;
+	Integrator* m_integrator;
+	Broadphase m_broadphase;
+	CollisionResolver m_resolver;
+	QuadrantIndex m_quadrants;
+
+	StageTimes m_times;
+	uint32_t m_stepCollisions = 0;
+	uint64_t m_collisions = 0;
+	uint64_t m_steps = 0;
+};